@@ -261,6 +261,21 @@ void bigsea_close(struct cb_tranx_t *tdev, struct file *filp)
 	}
 }
 
+/* the slice of a core reserved by filp, -1 if it has none */
+int bigsea_core_slice(struct cb_tranx_t *tdev, struct file *filp)
+{
+	int id;
+	struct bigsea_t *tbigsea = tdev->modules[TR_MODULE_BIGSEA];
+
+	/* core_0 in slice_0, core_1 in slice_1 */
+	for (id = 0; id < BIGSEA_MAX_CORES; id++) {
+		if (tbigsea->core[id].filp == filp)
+			return id;
+	}
+
+	return -1;
+}
+
 /* wait core irq, BIGSEA_WAIT_TIMEOUT is timeout time. */
 static int bigsea_wait_ready(struct bigsea_t *tbigsea,
 				   struct core_desc *core,
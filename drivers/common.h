@@ -160,6 +160,7 @@ struct cb_tranx_t {
 	u32 reduce_strategy; /* reduce strategy when the temperature exceeds the threshold */
 	struct mutex reset_lock;
 	struct msix_entry msix_entries[MAX_MSIX_CNT];
+	struct dentry *debugfs; /* debugfs directory, for the module files */
 };
 
 struct cb_misc_tdev {
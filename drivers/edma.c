@@ -20,6 +20,14 @@
 #include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/vmalloc.h>
+#include <linux/kref.h>
+#include <linux/scatterlist.h>
+#include <linux/workqueue.h>
+#include <linux/eventfd.h>
+#include <linux/poll.h>
+#include <linux/math64.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "common.h"
 #include "edma.h"
@@ -196,6 +204,166 @@ struct dw_edma_llp {
 	u32 llp_high;
 };
 
+/*
+ * the max element count of one ddr link table; the space from NT_OFF is
+ * used by tcache, and the llp element and latency flag follow the table.
+ */
+#define EDMA_LT_MAX_CNT	\
+	((NT_OFF - 2 * sizeof(struct dw_edma_llp)) / sizeof(struct dma_link_table))
+
+/*
+ * default max bytes of one ddr link transfer; a larger transfer is sent in
+ * chunks, and frees its channel between them so that a small or LIVE
+ * transfer can go in between.
+ */
+#define EDMA_CHUNK_SIZE		0x200000
+
+/*
+ * default completion polling: transfers up to EDMA_POLL_SIZE bytes poll
+ * their channel for up to EDMA_POLL_US, then wait for the interrupt.
+ */
+#define EDMA_POLL_SIZE		0x4000
+#define EDMA_POLL_US		20
+
+/*
+ * the prio of a ddr transfer carries its enum TRANS_EDMA_POLL mode too,
+ * from bit 16.
+ */
+#define EDMA_XFER(prio, poll)	((prio) | ((u32)(poll) << 16))
+#define EDMA_XFER_PRIO(x)	((x) & 0xffff)
+#define EDMA_XFER_POLL(x)	((x) >> 16)
+
+/*
+ * preallocated scratch buffers, one per transfer in flight: 4 read and 4
+ * write channels. They are taken at probe, about 320KB each with the
+ * default scratch_pages.
+ */
+static unsigned int scratch_num = 8;
+
+module_param(scratch_num, uint, 0444);
+MODULE_PARM_DESC(scratch_num,
+	"edma scratch buffers of a device, 0:none; default is 8");
+
+/* page entries of a scratch buffer, 32MB: a 4K P010 frame fits */
+static unsigned int scratch_pages = 8192;
+
+module_param(scratch_pages, uint, 0444);
+MODULE_PARM_DESC(scratch_pages,
+	"page entries of an edma scratch buffer; default is 8192");
+
+/*
+ * the scratch buffers of one transfer: its pinned pages, their bus
+ * addresses and its link table. A transfer up to scratch_pages pages
+ * runs without vmalloc; a larger one, or one which finds every scratch
+ * buffer in use, falls back to vzalloc and is counted in scratch_stat.
+ */
+struct edma_scratch {
+	struct list_head list;
+	struct page **pages;
+	struct rc_addr_info *paddr;
+	struct dma_link_table *lt;
+};
+
+#define EDMA_SC(sc, f)	((sc) ? (sc)->f : NULL)
+
+static void edma_scratch_release(struct edma_t *tedma)
+{
+	struct edma_scratch *sc;
+	u32 i;
+
+	if (!tedma->scratch)
+		return;
+
+	for (i = 0; i < scratch_num; i++) {
+		sc = &tedma->scratch[i];
+		vfree(sc->pages);
+		vfree(sc->paddr);
+		vfree(sc->lt);
+	}
+	kfree(tedma->scratch);
+	tedma->scratch = NULL;
+}
+
+static int edma_scratch_init(struct edma_t *tedma)
+{
+	struct edma_scratch *sc;
+	u32 i;
+
+	INIT_LIST_HEAD(&tedma->scratch_free);
+	spin_lock_init(&tedma->scratch_lock);
+	if (!scratch_num || !scratch_pages)
+		return 0;
+	tedma->scratch = kcalloc(scratch_num, sizeof(*sc), GFP_KERNEL);
+	if (!tedma->scratch)
+		return -ENOMEM;
+
+	for (i = 0; i < scratch_num; i++) {
+		sc = &tedma->scratch[i];
+		sc->pages = vzalloc(sizeof(*sc->pages) * scratch_pages);
+		sc->paddr = vzalloc(sizeof(*sc->paddr) * scratch_pages);
+		sc->lt = vzalloc(sizeof(*sc->lt) * EDMA_LT_MAX_CNT);
+		if (!sc->pages || !sc->paddr || !sc->lt) {
+			edma_scratch_release(tedma);
+			return -ENOMEM;
+		}
+		list_add_tail(&sc->list, &tedma->scratch_free);
+	}
+
+	return 0;
+}
+
+/* take a free scratch buffer, NULL if they're all in use */
+static struct edma_scratch *edma_scratch_get(struct edma_t *tedma)
+{
+	struct edma_scratch *sc = NULL;
+
+	spin_lock(&tedma->scratch_lock);
+	if (!list_empty(&tedma->scratch_free)) {
+		sc = list_first_entry(&tedma->scratch_free,
+				      struct edma_scratch, list);
+		list_del(&sc->list);
+	}
+	spin_unlock(&tedma->scratch_lock);
+
+	return sc;
+}
+
+static void edma_scratch_put(struct edma_t *tedma, struct edma_scratch *sc)
+{
+	if (!sc)
+		return;
+
+	spin_lock(&tedma->scratch_lock);
+	list_add(&sc->list, &tedma->scratch_free);
+	spin_unlock(&tedma->scratch_lock);
+}
+
+/*
+ * get an array of n entries of size bytes for a transfer: the scratch
+ * array of max entries if there is one and n fits, else a new one.
+ * The content is undefined, free it with edma_array_put().
+ */
+static void *edma_array_get(struct edma_t *tedma, void *scratch, u32 max,
+			    u32 n, size_t size)
+{
+	if (scratch && n <= max) {
+		atomic64_inc(&tedma->scratch_stat.hits);
+		return scratch;
+	}
+
+	if (scratch)
+		atomic64_inc(&tedma->scratch_stat.oversize);
+	else
+		atomic64_inc(&tedma->scratch_stat.empty);
+	return vzalloc(n * size);
+}
+
+static void edma_array_put(void *array, void *scratch)
+{
+	if (array != scratch)
+		vfree(array);
+}
+
 void print_tc_debug_info(struct cb_tranx_t *tdev,
 				struct tcache_info *tc_info,
 				struct dma_link_table  *new_table, int c);
@@ -299,59 +467,79 @@ void dump_edma_regs(struct cb_tranx_t *tdev, char *dir, int channel)
 }
 
 /*
- * according transfer dircet, get a idle channel.
+ * take a free ddr channel of direct, rc2ep channel 0 and 3 are only for
+ * tcache. A VOD transfer doesn't take one while LIVE transfers wait.
+ * return value: the channel, or -1 if there is none for now.
+ */
+static int edma_try_get_channel(u8 direct, u32 prio, struct edma_t *tedma)
+{
+	struct edma_chn_sched *sch = &tedma->sched[direct];
+	spinlock_t *lock;
+	u8 *cs;
+	int i, first, last;
+
+	if (prio != TASK_LIVE && atomic_read(&sch->live_waiting))
+		return -1;
+
+	if (direct == RC2EP) {
+		lock = &tedma->rc2ep_cs_lock;
+		cs = tedma->rc2ep_cs;
+		first = 1;
+		last = 2;
+	} else {
+		lock = &tedma->ep2rc_cs_lock;
+		cs = tedma->ep2rc_cs;
+		first = 0;
+		last = 3;
+	}
+
+	spin_lock(lock);
+	for (i = first; i <= last; i++) {
+		if (cs[i] == EDMA_FREE) {
+			cs[i] = EDMA_BUSY;
+			sch->start[i] = ktime_get();
+			break;
+		}
+	}
+	spin_unlock(lock);
+
+	return (i <= last) ? i : -1;
+}
+
+/*
+ * according transfer dircet, get a idle channel. If there is none, wait
+ * for one like reserve_encoder(): the level of LIVE is higher than VOD,
+ * so the LIVE transfers get the freed channels first, until no LIVE
+ * transfer waits, VOD can get an idle channel.
  *
  * @direct: the transfer direct of request channel.
+ * @prio: TASK_LIVE or TASK_VOD.
  * @tedma: edma struct detail information.
  * return value: <0: failed; >=0 ok;
  */
-static int get_edma_channel(u8 direct, struct edma_t *tedma)
+static int get_edma_channel(u8 direct, u32 prio, struct edma_t *tedma)
 {
-	int i;
-
-	if (direct == RC2EP) {
-		if (down_interruptible(&tedma->rc2ep_sem))
-			return -ERESTARTSYS;
-		spin_lock(&tedma->rc2ep_cs_lock);
-		/* rc2ep channel 0 and 3 only for tcache. */
-		for (i = 1; i <= 2; i++) {
-			if (tedma->rc2ep_cs[i] == EDMA_FREE) {
-				tedma->rc2ep_cs[i] = EDMA_BUSY;
-				break;
-			}
-		}
-		spin_unlock(&tedma->rc2ep_cs_lock);
-		if (i == 3) {
-			trans_dbg(tedma->tdev, TR_NOTICE,
-				"edma: %s can't get valid channel\n", __func__);
-			return -EFAULT;
-		} else
-			return i;
-	} else if (direct == EP2RC) {
-		if (down_interruptible(&tedma->ep2rc_sem))
-			return -ERESTARTSYS;
-		spin_lock(&tedma->ep2rc_cs_lock);
-		for (i = 0; i <= 3; i++) {
-			if (tedma->ep2rc_cs[i] == EDMA_FREE) {
-				tedma->ep2rc_cs[i] = EDMA_BUSY;
-				break;
-			}
-		}
-		spin_unlock(&tedma->ep2rc_cs_lock);
+	struct edma_chn_sched *sch;
+	int c = -1;
 
-		if (i == 4) {
-			trans_dbg(tedma->tdev, TR_NOTICE,
-				"edma: %s can't get valid channel\n", __func__);
-			return -EFAULT;
-		} else
-			return i;
-	} else {
+	if (direct != RC2EP && direct != EP2RC) {
 		trans_dbg(tedma->tdev, TR_ERR,
 			"edma: %s, input direct:%d error.\n",
 			__func__, direct);
+		return -EFAULT;
 	}
+	sch = &tedma->sched[direct];
 
-	return -EFAULT;
+	if (prio == TASK_LIVE)
+		atomic_inc(&sch->live_waiting);
+	if (wait_event_interruptible(sch->wait,
+			(c = edma_try_get_channel(direct, prio, tedma)) >= 0))
+		c = -ERESTARTSYS;
+	/* the VOD transfers may go once no LIVE one waits */
+	if (prio == TASK_LIVE && atomic_dec_and_test(&sch->live_waiting))
+		wake_up_all(&sch->wait);
+
+	return c;
 }
 
 /*
@@ -365,12 +553,143 @@ static int get_edma_channel(u8 direct, struct edma_t *tedma)
 static void free_edma_channel(int channel, u8 direct,
 				    struct edma_t *tedma)
 {
+	struct edma_chn_sched *sch = &tedma->sched[direct];
+	spinlock_t *lock;
+	u8 *cs;
+
+	if (direct == RC2EP) {
+		lock = &tedma->rc2ep_cs_lock;
+		cs = tedma->rc2ep_cs;
+	} else {
+		lock = &tedma->ep2rc_cs_lock;
+		cs = tedma->ep2rc_cs;
+	}
+
+	spin_lock(lock);
+	sch->busy_us[channel] +=
+		ktime_to_us(ktime_sub(ktime_get(), sch->start[channel]));
+	cs[channel] = EDMA_FREE;
+	spin_unlock(lock);
+
+	wake_up_all(&sch->wait);
+}
+
+/* whether a ddr transfer of size bytes polls for its completion */
+static bool edma_use_poll(struct edma_t *tedma, u32 size, u32 prio)
+{
+	u32 poll_size;
+
+	switch (EDMA_XFER_POLL(prio)) {
+	case EDMA_POLL_ON:
+		return true;
+	case EDMA_POLL_OFF:
+		return false;
+	}
+	poll_size = READ_ONCE(tedma->poll_size);
+
+	return poll_size && size <= poll_size;
+}
+
+/*
+ * check whether the transfer of channel c is done. The done status is
+ * taken under edma_irq_lock, so edma_isr() can't report it once the
+ * channel is freed and used by the next transfer.
+ */
+static int edma_poll_done(struct cb_tranx_t *tdev, u8 direct, int c)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	u8 *condition;
+	u32 status_off, clear_off, val;
+	unsigned long flags;
+	int done;
+
 	if (direct == RC2EP) {
-		tedma->rc2ep_cs[channel] = EDMA_FREE;
-		up(&tedma->rc2ep_sem);
+		condition = tedma->wait_condition_r;
+		status_off = DMA_READ_INT_STATUS_OFF;
+		clear_off = DMA_READ_INT_CLEAR_OFF;
 	} else {
-		tedma->ep2rc_cs[channel] = EDMA_FREE;
-		up(&tedma->ep2rc_sem);
+		condition = tedma->wait_condition_w;
+		status_off = DMA_WRITE_INT_STATUS_OFF;
+		clear_off = DMA_WRITE_INT_CLEAR_OFF;
+	}
+
+	if (READ_ONCE(condition[c]))
+		return 1;
+
+	spin_lock_irqsave(&tedma->edma_irq_lock, flags);
+	val = edma_read(tdev, status_off);
+	if (val & DMA_DONE(c)) {
+		edma_write(tdev, clear_off, DMA_DONE(c));
+		condition[c] = 1;
+	}
+	done = condition[c];
+	spin_unlock_irqrestore(&tedma->edma_irq_lock, flags);
+
+	return done;
+}
+
+/* poll channel c for up to poll_us. return value: 1 if it's done */
+static int edma_poll_wait(struct cb_tranx_t *tdev, u8 direct, int c)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	ktime_t end = ktime_add_us(ktime_get(), READ_ONCE(tedma->poll_us));
+
+	do {
+		if (edma_poll_done(tdev, direct, c))
+			return 1;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), end));
+
+	return 0;
+}
+
+/* histogram slot of v, see struct edma_hist */
+static inline int edma_hist_slot(u64 v)
+{
+	return min_t(int, fls64(v), EDMA_HIST_SLOTS - 1);
+}
+
+/*
+ * account a ddr transfer done on channel c, submitted at submit and
+ * started at start.
+ */
+static void edma_hist_add(struct edma_t *tedma, u8 direct, int c,
+			  ktime_t submit, ktime_t start, u32 size)
+{
+	struct edma_hist *h = &tedma->hist[direct][c];
+	ktime_t now = ktime_get();
+
+	atomic64_inc(&h->queue[edma_hist_slot(ktime_us_delta(start, submit))]);
+	atomic64_inc(&h->xfer[edma_hist_slot(ktime_us_delta(now, start))]);
+	atomic64_inc(&h->total[edma_hist_slot(ktime_us_delta(now, submit))]);
+	atomic64_inc(&h->bytes[edma_hist_slot(size >> 10)]);
+	atomic64_inc(&h->cnt);
+}
+
+/* account the pinning of the rc pages of a request, started at start */
+static void edma_pin_add(struct edma_t *tedma, u8 direct, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	if (direct == RC2EP || direct == EP2RC)
+		atomic64_inc(&tedma->pin_hist[direct][edma_hist_slot(us)]);
+}
+
+/* account a transfer done in mode, started at start */
+static void edma_lat_add(struct edma_t *tedma, int mode, ktime_t start)
+{
+	struct edma_lat_stat *st = &tedma->lat[mode];
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	s64 max = atomic64_read(&st->max_ns);
+	s64 old;
+
+	atomic64_inc(&st->cnt);
+	atomic64_add(ns, &st->ns);
+	while (ns > max) {
+		old = atomic64_cmpxchg(&st->max_ns, max, ns);
+		if (old == max)
+			break;
+		max = old;
 	}
 }
 
@@ -553,6 +872,8 @@ static enum hrtimer_restart err_chk_timer_isr(struct hrtimer *t)
  *                  the channel is fixed, so when called this function,
  *                  channel has been selected by user application.
  * @tc_force: for tcache tranx, whether there is an error or not, enforce run
+ * @prio: TASK_LIVE or TASK_VOD, to get a ddr channel, with the poll mode
+ *        of EDMA_XFER().
  * return value:
  *       0:success    non-zero:failed.
  */
@@ -561,13 +882,17 @@ static int edma_tranx_rc2ep(struct dma_link_table *table_info,
 				struct cb_tranx_t *tdev,
 				u8 tcache,
 				int tcache_channel,
-				int tc_force)
+				int tc_force,
+				u32 prio)
 {
 	u32 ctl, i, val;
 	int ret, rv, c;
 	unsigned char done = 0;
 	unsigned long flags;
 	u32 tc_total_size = 0;
+	ktime_t submit = ktime_get();
+	ktime_t start;
+	int lat;
 
 	/* edma link table which are saved in ep side ddr */
 	struct dma_link_table __iomem *link_table;
@@ -590,7 +915,7 @@ static int edma_tranx_rc2ep(struct dma_link_table *table_info,
 		/* for ddr transfer, need to get a free channel and prepare
 		 * the link table.
 		 */
-		c = get_edma_channel(RC2EP, tedma);
+		c = get_edma_channel(RC2EP, EDMA_XFER_PRIO(prio), tedma);
 		if (c < 0) {
 			trans_dbg(tdev, TR_ERR,
 				"edma: get_edma_channel rc2ep failed:%d.\n", c);
@@ -686,6 +1011,7 @@ static int edma_tranx_rc2ep(struct dma_link_table *table_info,
 	tedma->wait_condition_r[c] = 0;
 
 	/* enable this channel */
+	start = ktime_get();
 	edma_write(tdev, DMA_READ_DOORBELL_OFF, c);
 	spin_unlock_irqrestore(&tedma->rc2ep_cfg_lock, flags);
 
@@ -697,8 +1023,16 @@ static int edma_tranx_rc2ep(struct dma_link_table *table_info,
 		return 0;
 	}
 
-	ret = wait_event_interruptible_timeout(tedma->queue_wait,
+	lat = edma_use_poll(tedma, edma_info->size, prio) ?
+		EDMA_LAT_POLL : EDMA_LAT_IRQ;
+	if (lat == EDMA_LAT_POLL && edma_poll_wait(tdev, RC2EP, c)) {
+		ret = 1;
+	} else {
+		if (lat == EDMA_LAT_POLL)
+			lat = EDMA_LAT_FALLBACK;
+		ret = wait_event_interruptible_timeout(tedma->queue_wait,
 				tedma->wait_condition_r[c], EDMA_TIMEOUT);
+	}
 	if (ret == 0) {
 		val = edma_read(tdev, DMA_READ_INT_STATUS_OFF);
 		ctl = edma_read(tdev, DMA_CHN(c) + DMA_CH_CTL1_RD_OFF);
@@ -739,6 +1073,8 @@ static int edma_tranx_rc2ep(struct dma_link_table *table_info,
 	} else {
 		done = 1;
 		atomic64_add(edma_info->size, &tedma->edma_perf.rc2ep_size);
+		edma_lat_add(tedma, lat, start);
+		edma_hist_add(tedma, RC2EP, c, submit, start, edma_info->size);
 	}
 	free_edma_channel(c, edma_info->direct, tedma);
 
@@ -753,16 +1089,22 @@ static int edma_tranx_rc2ep(struct dma_link_table *table_info,
  * @table_info: edma link table.
  * @edma_info: edma transfer info.
  * @tdev: core struct, record driver info.
+ * @prio: TASK_LIVE or TASK_VOD, to get a ddr channel, with the poll mode
+ *        of EDMA_XFER().
  * return value:
  *       0:success    non-zero:failed.
  */
 static int edma_tranx_ep2rc(struct dma_link_table *table_info,
 				 struct trans_pcie_edma *edma_info,
-				 struct cb_tranx_t *tdev)
+				 struct cb_tranx_t *tdev,
+				 u32 prio)
 {
 	u32 val, ctl, i;
 	int ret, rv, c;
 	unsigned char done = 0;
+	ktime_t submit = ktime_get();
+	ktime_t start;
+	int lat;
 
 	/* edma link table which are saved in ep side ddr */
 	struct dma_link_table __iomem *link_table;
@@ -777,7 +1119,7 @@ static int edma_tranx_ep2rc(struct dma_link_table *table_info,
 	if (tdev->hw_err_flag)
 		return -EFAULT;
 
-	c = get_edma_channel(EP2RC, tedma);
+	c = get_edma_channel(EP2RC, EDMA_XFER_PRIO(prio), tedma);
 	if (c < 0) {
 		trans_dbg(tdev, TR_ERR,
 			"edma: get_edma_channel ep2rc failed:%d\n", c);
@@ -850,12 +1192,21 @@ static int edma_tranx_ep2rc(struct dma_link_table *table_info,
 
 	tedma->wait_condition_w[c] = 0;
 	/* enable this channel */
+	start = ktime_get();
 	edma_write(tdev, DMA_WRITE_DOORBELL_OFF, c);
 	spin_unlock(&tedma->ep2rc_cfg_lock);
 
-	 ret = wait_event_interruptible_timeout(tedma->queue_wait,
+	lat = edma_use_poll(tedma, edma_info->size, prio) ?
+		EDMA_LAT_POLL : EDMA_LAT_IRQ;
+	if (lat == EDMA_LAT_POLL && edma_poll_wait(tdev, EP2RC, c)) {
+		ret = 1;
+	} else {
+		if (lat == EDMA_LAT_POLL)
+			lat = EDMA_LAT_FALLBACK;
+		ret = wait_event_interruptible_timeout(tedma->queue_wait,
 						tedma->wait_condition_w[c],
 						EDMA_TIMEOUT);
+	}
 	if (ret == 0) {
 		val = edma_read(tdev, DMA_WRITE_INT_STATUS_OFF);
 		ctl = edma_read(tdev, DMA_CHN(c)+DMA_CH_CTL1_WR_OFF);
@@ -897,6 +1248,8 @@ static int edma_tranx_ep2rc(struct dma_link_table *table_info,
 	} else {
 		done = 1;
 		atomic64_add(edma_info->size, &tedma->edma_perf.ep2rc_size);
+		edma_lat_add(tedma, lat, start);
+		edma_hist_add(tedma, EP2RC, c, submit, start, edma_info->size);
 	}
 	free_edma_channel(c, edma_info->direct, tedma);
 
@@ -915,7 +1268,7 @@ static int edma_tranx_ep2rc(struct dma_link_table *table_info,
  */
 static int edma_link_xfer(struct dma_link_table *table_info,
 			       struct trans_pcie_edma *edma_info,
-			       struct cb_tranx_t *tdev)
+			       struct cb_tranx_t *tdev, u32 prio)
 {
 	int ret = 0;
 
@@ -923,9 +1276,10 @@ static int edma_link_xfer(struct dma_link_table *table_info,
 		return tdev->hw_err_flag;
 
 	if (edma_info->direct == RC2EP) {
-		ret = edma_tranx_rc2ep(table_info, edma_info, tdev, 0, 0, 0);
+		ret = edma_tranx_rc2ep(table_info, edma_info, tdev, 0, 0, 0,
+				       prio);
 	} else if (edma_info->direct == EP2RC) {
-		ret = edma_tranx_ep2rc(table_info, edma_info, tdev);
+		ret = edma_tranx_ep2rc(table_info, edma_info, tdev, prio);
 	} else {
 		trans_dbg(tdev, TR_ERR, "edma: edma %s error.\n",
 			  edma_info->direct ? "ep2rc" : "rc2ep");
@@ -959,7 +1313,7 @@ int edma_normal_rc2ep_xfer(struct trans_pcie_edma *edma_info,
 	if (tdev->hw_err_flag)
 		return -EFAULT;
 
-	c = get_edma_channel(RC2EP, tedma);
+	c = get_edma_channel(RC2EP, TASK_LIVE, tedma);
 	if (c < 0) {
 		trans_dbg(tdev, TR_ERR, "edma: %s, get_edma_channel failed\n",
 			__func__);
@@ -1047,7 +1401,7 @@ int edma_normal_ep2rc_xfer(struct trans_pcie_edma *edma_info,
 	if (tdev->hw_err_flag)
 		return -EFAULT;
 
-	c = get_edma_channel(EP2RC, tedma);
+	c = get_edma_channel(EP2RC, TASK_LIVE, tedma);
 	if (c < 0) {
 		trans_dbg(tdev, TR_ERR, "edma: %s, get_edma_channel failed\n",
 			__func__);
@@ -1126,51 +1480,104 @@ unsigned int count_pages(unsigned long iov_base, size_t iov_len)
 	return last - first + 1;
 }
 
+/*
+ * pin page_cnt user pages from start, return 0 or -EFAULT.
+ * @longterm: the pages stay pinned after the request, as the registered
+ * buffers; they are pinned with FOLL_LONGTERM where the kernel has it,
+ * so the pages in CMA or ZONE_MOVABLE are migrated first.
+ */
+static int cb_pin_user_pages(struct cb_tranx_t *tdev, unsigned long start,
+				  u32 page_cnt, struct page **user_pages,
+				  bool longterm)
+{
+	long rv;
+	int i;
+	unsigned int flags = FOLL_FORCE | FOLL_WRITE;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0))
+	if (longterm) {
+		rv = pin_user_pages_fast(start, page_cnt,
+					 FOLL_WRITE | FOLL_LONGTERM, user_pages);
+		if (rv != page_cnt) {
+			trans_dbg(tdev, TR_ERR,
+				"edma: pin_user_pages failed:%ld\n", rv);
+			if (rv > 0)
+				unpin_user_pages(user_pages, rv);
+			return -EFAULT;
+		}
+		return 0;
+	}
+#endif
+
+	down_read(&current->mm->mmap_sem);
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 10, 0))
+	rv = get_user_pages(current, current->mm, start, page_cnt, 1, flags, user_pages, NULL);
+#else
+	rv = get_user_pages(start, page_cnt, flags, user_pages, NULL);
+#endif
+	up_read(&current->mm->mmap_sem);
+	if (rv != page_cnt) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: get_user_pages failed:%ld\n", rv);
+		for (i = 0 ; i < rv ; i++)
+			if (user_pages[i])
+				put_page(user_pages[i]);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+/* release the pages of cb_pin_user_pages(), dirty if the device wrote them */
+static void cb_unpin_user_pages(struct page **user_pages, u32 page_cnt,
+				     bool longterm, bool dirty)
+{
+	u32 i;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0))
+	if (longterm) {
+		unpin_user_pages_dirty_lock(user_pages, page_cnt, dirty);
+		return;
+	}
+#endif
+	for (i = 0; i < page_cnt; i++) {
+		if (dirty)
+			set_page_dirty_lock(user_pages[i]);
+		put_page(user_pages[i]);
+	}
+}
+
 /*
  * get the page information of a virtual address, then translet to physical
- * address array.
+ * address array. The page array is taken from sc if it fits.
  */
 static int cb_get_dma_addr(struct cb_tranx_t *tdev, unsigned long start,
-				u32 len, struct rc_addr_info *paddr_array)
+				u32 len, struct rc_addr_info *paddr_array,
+				struct edma_scratch *sc)
 {
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
 	u32 page_cnt;
 	long rv = -EFAULT;
 	int i, sg_cnt;
 	struct scatterlist *sg;
 	struct sg_table sgt;
 	struct page **user_pages;
-	unsigned int flags = FOLL_FORCE;
 
 	if (!len)
 		return -EFAULT;
 
 	page_cnt = count_pages(start, len);
-	user_pages = vzalloc(sizeof(struct page *) * page_cnt);
+	user_pages = edma_array_get(tedma, EDMA_SC(sc, pages),
+				    scratch_pages, page_cnt,
+				    sizeof(struct page *));
 	if (!user_pages) {
 		trans_dbg(tdev, TR_ERR, "edma: allocate user page failed\n");
 		goto out;
 	}
 
-	flags |= FOLL_WRITE;
-	down_read(&current->mm->mmap_sem);
-
-#if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 10, 0))
-	rv = get_user_pages(current, current->mm, start, page_cnt, 1, flags, user_pages, NULL);
-#else
-	rv = get_user_pages(start, page_cnt, flags, user_pages, NULL);
-#endif
-	up_read(&current->mm->mmap_sem);
-	if (rv != page_cnt) {
-		trans_dbg(tdev, TR_ERR,
-			"edma: get_user_pages failed:%ld\n", rv);
-		if (rv > 0) {
-			for (i = 0 ; i < rv ; i++)
-				if (user_pages[i])
-					put_page(user_pages[i]);
-		}
-		rv = -EFAULT;
+	rv = cb_pin_user_pages(tdev, start, page_cnt, user_pages, false);
+	if (rv)
 		goto out_free_page_mem;
-	}
 
 	rv = sg_alloc_table_from_pages(&sgt, user_pages, page_cnt,
 				       start & (PAGE_SIZE-1), len, GFP_KERNEL);
@@ -1201,8 +1608,135 @@ out_put_user_pages:
 		if (user_pages[i])
 			put_page(user_pages[i]);
 out_free_page_mem:
-	vfree(user_pages);
+	edma_array_put(user_pages, EDMA_SC(sc, pages));
+out:
+	return rv;
+}
+
+/* fill one link table element between a rc bus address and an ep address */
+static inline void edma_lt_fill(struct dma_link_table *lt, u32 direct,
+				u64 paddr, u64 ep, u32 len)
+{
+	lt->control = DMA_CB;
+	lt->size = len;
+	if (direct == RC2EP) {
+		lt->sar_high = QWORD_HI(paddr);
+		lt->sar_low = QWORD_LO(paddr);
+		lt->dst_high = QWORD_HI(ep);
+		lt->dst_low = QWORD_LO(ep);
+	} else {
+		lt->dst_high = QWORD_HI(paddr);
+		lt->dst_low = QWORD_LO(paddr);
+		lt->sar_high = QWORD_HI(ep);
+		lt->sar_low = QWORD_LO(ep);
+	}
+}
+
+/* bytes of the next element of a link transfer which has size bytes */
+static inline u32 edma_chunk_len(struct edma_t *tedma, u32 size, u32 len)
+{
+	u32 chunk = READ_ONCE(tedma->chunk_size);
+
+	if (chunk && size < chunk && len > chunk - size)
+		return chunk - size;
+	return len;
+}
+
+/* a link transfer of size bytes is cut here, to free its channel */
+static inline bool edma_chunk_full(struct edma_t *tedma, u32 size)
+{
+	u32 chunk = READ_ONCE(tedma->chunk_size);
+
+	return chunk && size >= chunk;
+}
+
+/*
+ * transfer rows of a pinned RC area by link tables. The RC area is given by
+ * its mapped segments; row r starts at offset off + r * rc_stride of the
+ * area and at ep_addr + r * ep_stride, and every row is split into elements
+ * by the segments it crosses. If the elements exceed one channel's link
+ * table or the bytes exceed chunk_size, they are sent in several link
+ * transfers.
+ */
+static int edma_segs_xfer(struct cb_tranx_t *tdev, u32 direct,
+			  struct rc_addr_info *segs, int seg_cnt,
+			  unsigned long off, u32 width, u32 height,
+			  u32 rc_stride, u64 ep_addr, u32 ep_stride, u32 prio,
+			  struct edma_scratch *sc)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct trans_pcie_edma edma_info;
+	struct dma_link_table *link_table;
+	unsigned long row_off, row_end, seg_start;
+	u64 ep, paddr;
+	u32 r, len, cnt;
+	int seg;
+	int rv = 0;
+
+	/* every row takes one element, plus one per segment boundary and
+	 * one cut at the chunk boundary
+	 */
+	cnt = min_t(u32, height + seg_cnt + 1, EDMA_LT_MAX_CNT);
+	link_table = edma_array_get(tedma, EDMA_SC(sc, lt), EDMA_LT_MAX_CNT,
+				    cnt, sizeof(*link_table));
+	if (!link_table) {
+		trans_dbg(tdev, TR_ERR, "edma: allocate link table failed.\n");
+		return -ENOMEM;
+	}
+
+	memset(&edma_info, 0, sizeof(edma_info));
+	edma_info.direct = direct;
+	seg = 0;
+	seg_start = 0;
+	cnt = 0;
+	for (r = 0; r < height; r++) {
+		row_off = off + (unsigned long)r * rc_stride;
+		row_end = row_off + width;
+		ep = ep_addr + (u64)r * ep_stride;
+		while (row_off < row_end) {
+			/* find the segment holding row_off, the rows go forward */
+			while (seg < seg_cnt &&
+			       row_off >= seg_start + segs[seg].size) {
+				seg_start += segs[seg].size;
+				seg++;
+			}
+			if (seg == seg_cnt) {
+				trans_dbg(tdev, TR_ERR,
+					"edma: %s, row %u out of pages\n",
+					__func__, r);
+				rv = -EFAULT;
+				goto out;
+			}
+			len = min_t(unsigned long, row_end,
+				    seg_start + segs[seg].size) - row_off;
+			len = edma_chunk_len(tedma, edma_info.size, len);
+			paddr = segs[seg].paddr + (row_off - seg_start);
+
+			edma_lt_fill(&link_table[cnt], direct, paddr, ep, len);
+			edma_info.size += len;
+			row_off += len;
+			ep += len;
+
+			if (++cnt == EDMA_LT_MAX_CNT ||
+			    edma_chunk_full(tedma, edma_info.size)) {
+				edma_info.element_size = cnt;
+				rv = edma_link_xfer(link_table, &edma_info, tdev,
+						    prio);
+				if (rv)
+					goto out;
+				edma_info.size = 0;
+				cnt = 0;
+			}
+		}
+	}
+
+	if (cnt) {
+		edma_info.element_size = cnt;
+		rv = edma_link_xfer(link_table, &edma_info, tdev, prio);
+	}
+
 out:
+	edma_array_put(link_table, EDMA_SC(sc, lt));
 	return rv;
 }
 
@@ -1211,14 +1745,15 @@ out:
  * generate link table, use edma link mode to transmit.
  */
 static int edma_tranx_viraddr_mode(struct trans_pcie_edma *edma_info,
-					   struct cb_tranx_t *tdev)
+					   struct cb_tranx_t *tdev, u32 prio)
 {
-	int j, page_cnt;
-	struct dma_link_table *link_table;
-	unsigned int ctl = DMA_CB;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_scratch *sc;
+	int page_cnt;
 	unsigned long vaddr, ep_addr;
 	struct rc_addr_info *paddr_array;
-	int rv = 0;
+	ktime_t pin;
+	int rv;
 
 	if (edma_info->direct == RC2EP) {
 		vaddr = edma_info->sar_high;
@@ -1232,58 +1767,962 @@ static int edma_tranx_viraddr_mode(struct trans_pcie_edma *edma_info,
 		vaddr = (vaddr<<32)|edma_info->dar_low;
 	}
 
+	sc = edma_scratch_get(tedma);
 	page_cnt = count_pages(vaddr, edma_info->size);
-	paddr_array = vzalloc(sizeof(*paddr_array) * page_cnt);
+	paddr_array = edma_array_get(tedma, EDMA_SC(sc, paddr),
+				     scratch_pages, page_cnt,
+				     sizeof(*paddr_array));
 	if (!paddr_array) {
 		trans_dbg(tdev, TR_ERR, "edma: allocate paddr_array failed\n");
+		rv = -ENOMEM;
 		goto out;
 	}
 
-	rv = cb_get_dma_addr(tdev, vaddr, edma_info->size, paddr_array);
+	pin = ktime_get();
+	rv = cb_get_dma_addr(tdev, vaddr, edma_info->size, paddr_array, sc);
+	edma_pin_add(tedma, edma_info->direct, pin);
 	if (rv < 0) {
 		trans_dbg(tdev, TR_ERR,
 			"edma: %s, get_user_pages failed.\n", __func__);
 		goto out_free_paddr_array;
 	}
 
-	link_table = vzalloc(rv * sizeof(*link_table));
-	if (!link_table) {
-		trans_dbg(tdev, TR_ERR, "edma: allocate link table failed.\n");
-		goto out_free_paddr_array;
-	}
-
-	/* create link table */
-	for (j = 0; j < rv; j++) {
-		if ((j+1) == rv)
-			ctl |= (DMA_LIE | DMA_RIE);
-		link_table[j].control = ctl;
-		link_table[j].size = paddr_array[j].size;
-		if (edma_info->direct == RC2EP) {
-			link_table[j].sar_high = QWORD_HI(paddr_array[j].paddr);
-			link_table[j].sar_low = QWORD_LO(paddr_array[j].paddr);
-			link_table[j].dst_high = QWORD_HI(ep_addr);
-			link_table[j].dst_low = QWORD_LO(ep_addr);
-		} else {
-			link_table[j].dst_high = QWORD_HI(paddr_array[j].paddr);
-			link_table[j].dst_low = QWORD_LO(paddr_array[j].paddr);
-			link_table[j].sar_high = QWORD_HI(ep_addr);
-			link_table[j].sar_low = QWORD_LO(ep_addr);
-		}
-		ep_addr += paddr_array[j].size;
-	}
-	edma_info->element_size = j;
-	rv = edma_link_xfer(link_table, edma_info, tdev);
-	vfree(link_table);
+	/* one element per segment, in chunks of at most chunk_size */
+	rv = edma_segs_xfer(tdev, edma_info->direct, paddr_array, rv, 0,
+			    edma_info->size, 1, 0, ep_addr, 0, prio, sc);
 
 out_free_paddr_array:
-	vfree(paddr_array);
+	edma_array_put(paddr_array, EDMA_SC(sc, paddr));
 out:
+	edma_scratch_put(tedma, sc);
 	return rv;
 }
 
-static int tcache_process_loop(struct tcache_info *tc_info)
+/*
+ * transfer a strided 2D area between RC virtual memory and EP memory. The
+ * pages of the whole RC area are got once, so a plane whose RC and EP
+ * strides differ is transferred by one link table instead of one edma
+ * transfer per row.
+ */
+static int edma_tranx_2d_mode(struct trans_pcie_edma_2d *info,
+				   struct cb_tranx_t *tdev, u32 prio)
 {
-	int rv, i;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_scratch *sc;
+	struct rc_addr_info *paddr_array;
+	unsigned long span;
+	int sg_cnt, page_cnt;
+	ktime_t pin;
+	int rv = -EFAULT;
+
+	if (!info->width || !info->height ||
+	    (info->direct != RC2EP && info->direct != EP2RC) ||
+	    (info->height > 1 && (info->rc_stride < info->width ||
+				  info->ep_stride < info->width))) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: %s, invalid w:%u h:%u rs:%u es:%u dir:%u\n",
+			__func__, info->width, info->height, info->rc_stride,
+			info->ep_stride, info->direct);
+		return -EINVAL;
+	}
+
+	span = (unsigned long)(info->height - 1) * info->rc_stride + info->width;
+	if (span > U32_MAX)
+		return -EINVAL;
+
+	sc = edma_scratch_get(tedma);
+	page_cnt = count_pages(info->rc_addr, span);
+	paddr_array = edma_array_get(tedma, EDMA_SC(sc, paddr),
+				     scratch_pages, page_cnt,
+				     sizeof(*paddr_array));
+	if (!paddr_array) {
+		trans_dbg(tdev, TR_ERR, "edma: allocate paddr_array failed\n");
+		edma_scratch_put(tedma, sc);
+		return -ENOMEM;
+	}
+
+	pin = ktime_get();
+	sg_cnt = cb_get_dma_addr(tdev, info->rc_addr, span, paddr_array, sc);
+	edma_pin_add(tedma, info->direct, pin);
+	if (sg_cnt <= 0) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: %s, get_user_pages failed.\n", __func__);
+		goto out_free_paddr_array;
+	}
+
+	rv = edma_segs_xfer(tdev, info->direct, paddr_array, sg_cnt, 0,
+			    info->width, info->height, info->rc_stride,
+			    info->ep_addr, info->ep_stride, prio, sc);
+
+out_free_paddr_array:
+	edma_array_put(paddr_array, EDMA_SC(sc, paddr));
+	edma_scratch_put(tedma, sc);
+	return rv;
+}
+
+/*
+ * a rc user area pinned and dma mapped for edma. The pages stay pinned
+ * until edma_umap_put(), so the area can be transferred later and from
+ * another context than the one which pinned it.
+ */
+struct edma_umap {
+	bool longterm; /* pinned with FOLL_LONGTERM */
+	u32 page_cnt;
+	struct page **pages;
+	struct sg_table sgt;
+	int seg_cnt;
+	struct rc_addr_info *segs;
+};
+
+/*
+ * pin and dma map size bytes of user memory from rc_addr.
+ * @longterm: the area stays mapped beyond the request, see
+ * cb_pin_user_pages().
+ */
+static int edma_umap_get(struct cb_tranx_t *tdev, u64 rc_addr, u32 size,
+			 struct edma_umap *um, bool longterm)
+{
+	struct scatterlist *sg;
+	int i, rv;
+
+	if (!size)
+		return -EINVAL;
+
+	um->page_cnt = count_pages(rc_addr, size);
+	um->pages = vzalloc(sizeof(struct page *) * um->page_cnt);
+	if (!um->pages)
+		return -ENOMEM;
+
+	um->longterm = longterm;
+	rv = cb_pin_user_pages(tdev, rc_addr, um->page_cnt, um->pages,
+			       longterm);
+	if (rv)
+		goto out_free_pages;
+
+	rv = sg_alloc_table_from_pages(&um->sgt, um->pages, um->page_cnt,
+				       rc_addr & (PAGE_SIZE-1), size,
+				       GFP_KERNEL);
+	if (rv) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: alloc sg_table failed:%d\n", rv);
+		goto out_put_pages;
+	}
+
+	um->seg_cnt = dma_map_sg(&tdev->pdev->dev, um->sgt.sgl,
+				 um->sgt.nents, DMA_BIDIRECTIONAL);
+	if (um->seg_cnt <= 0) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: dma_map_sg failed:%d\n", um->seg_cnt);
+		rv = -EFAULT;
+		goto out_free_sg_table;
+	}
+
+	um->segs = vzalloc(sizeof(*um->segs) * um->seg_cnt);
+	if (!um->segs) {
+		rv = -ENOMEM;
+		goto out_unmap_sg;
+	}
+	for_each_sg(um->sgt.sgl, sg, um->seg_cnt, i) {
+		um->segs[i].paddr = sg_dma_address(sg);
+		um->segs[i].size = sg_dma_len(sg);
+	}
+	return 0;
+
+out_unmap_sg:
+	dma_unmap_sg(&tdev->pdev->dev, um->sgt.sgl, um->sgt.nents,
+		     DMA_BIDIRECTIONAL);
+out_free_sg_table:
+	sg_free_table(&um->sgt);
+out_put_pages:
+	cb_unpin_user_pages(um->pages, um->page_cnt, longterm, false);
+out_free_pages:
+	vfree(um->pages);
+	um->pages = NULL;
+	return rv;
+}
+
+static void edma_umap_put(struct cb_tranx_t *tdev, struct edma_umap *um)
+{
+	if (!um->pages)
+		return;
+
+	dma_unmap_sg(&tdev->pdev->dev, um->sgt.sgl, um->sgt.nents,
+		     DMA_BIDIRECTIONAL);
+	sg_free_table(&um->sgt);
+	cb_unpin_user_pages(um->pages, um->page_cnt, um->longterm, true);
+	vfree(um->segs);
+	vfree(um->pages);
+	um->pages = NULL;
+}
+
+/* max segments of one vectored edma request */
+#define EDMA_VEC_SEG_MAX	64
+
+/*
+ * send the mapped segments of one direction of a vectored request. Their
+ * pages are chained into one link table, so they complete with one
+ * interrupt unless the elements exceed one channel's link table.
+ */
+static int edma_vec_dir_xfer(struct cb_tranx_t *tdev, u32 direct,
+			     struct trans_edma_seg *segs,
+			     struct edma_umap *maps, u32 seg_cnt, u32 prio)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct trans_pcie_edma edma_info;
+	struct dma_link_table *link_table;
+	struct edma_scratch *sc;
+	u32 i, total = 0, cnt = 0, left, len;
+	u64 ep, paddr;
+	int j;
+	int rv = 0;
+
+	for (i = 0; i < seg_cnt; i++) {
+		if (segs[i].direct == direct)
+			total += maps[i].seg_cnt;
+	}
+	if (!total)
+		return 0;
+
+	/* plus one element cut at the chunk boundary */
+	sc = edma_scratch_get(tedma);
+	link_table = edma_array_get(tedma, EDMA_SC(sc, lt), EDMA_LT_MAX_CNT,
+				    min_t(u32, total + 1, EDMA_LT_MAX_CNT),
+				    sizeof(*link_table));
+	if (!link_table) {
+		trans_dbg(tdev, TR_ERR, "edma: allocate link table failed.\n");
+		edma_scratch_put(tedma, sc);
+		return -ENOMEM;
+	}
+
+	memset(&edma_info, 0, sizeof(edma_info));
+	edma_info.direct = direct;
+	for (i = 0; i < seg_cnt; i++) {
+		if (segs[i].direct != direct)
+			continue;
+
+		ep = segs[i].ep_addr;
+		for (j = 0; j < maps[i].seg_cnt; j++) {
+			paddr = maps[i].segs[j].paddr;
+			left = maps[i].segs[j].size;
+			while (left) {
+				len = edma_chunk_len(tedma, edma_info.size, left);
+				edma_lt_fill(&link_table[cnt], direct, paddr, ep,
+					     len);
+				edma_info.size += len;
+				paddr += len;
+				ep += len;
+				left -= len;
+				if (++cnt < EDMA_LT_MAX_CNT &&
+				    !edma_chunk_full(tedma, edma_info.size))
+					continue;
+				edma_info.element_size = cnt;
+				rv = edma_link_xfer(link_table, &edma_info, tdev,
+						    prio);
+				if (rv)
+					goto out;
+				edma_info.size = 0;
+				cnt = 0;
+			}
+		}
+	}
+
+	if (cnt) {
+		edma_info.element_size = cnt;
+		rv = edma_link_xfer(link_table, &edma_info, tdev, prio);
+	}
+
+out:
+	edma_array_put(link_table, EDMA_SC(sc, lt));
+	edma_scratch_put(tedma, sc);
+	return rv;
+}
+
+/* send the mapped segments, one link table job per direction */
+static int edma_vec_xfer(struct cb_tranx_t *tdev, struct trans_edma_seg *segs,
+			 struct edma_umap *maps, u32 seg_cnt, u32 prio)
+{
+	int rv;
+
+	rv = edma_vec_dir_xfer(tdev, RC2EP, segs, maps, seg_cnt, prio);
+	if (!rv)
+		rv = edma_vec_dir_xfer(tdev, EP2RC, segs, maps, seg_cnt, prio);
+
+	return rv;
+}
+
+static void edma_vec_unmap(struct cb_tranx_t *tdev, struct edma_umap *maps,
+			   u32 seg_cnt)
+{
+	u32 i;
+
+	for (i = 0; i < seg_cnt; i++)
+		edma_umap_put(tdev, &maps[i]);
+	kfree(maps);
+}
+
+/*
+ * copy the segments of a vectored request from user space, then pin and
+ * map their rc pages. The caller frees *psegs and calls edma_vec_unmap().
+ */
+static int edma_vec_map(struct cb_tranx_t *tdev, u64 user_segs, u32 seg_cnt,
+			struct trans_edma_seg **psegs,
+			struct edma_umap **pmaps)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct trans_edma_seg *segs;
+	struct edma_umap *maps;
+	ktime_t pin;
+	u32 i;
+	int rv;
+
+	if (!seg_cnt || seg_cnt > EDMA_VEC_SEG_MAX) {
+		trans_dbg(tdev, TR_ERR, "edma: %s, invalid seg_cnt:%u\n",
+			  __func__, seg_cnt);
+		return -EINVAL;
+	}
+
+	segs = kcalloc(seg_cnt, sizeof(*segs), GFP_KERNEL);
+	maps = kcalloc(seg_cnt, sizeof(*maps), GFP_KERNEL);
+	if (!segs || !maps) {
+		rv = -ENOMEM;
+		goto out_free;
+	}
+	if (copy_from_user(segs, (void __user *)(uintptr_t)user_segs,
+			   seg_cnt * sizeof(*segs))) {
+		rv = -EFAULT;
+		goto out_free;
+	}
+
+	for (i = 0; i < seg_cnt; i++) {
+		if (!segs[i].size ||
+		    (segs[i].direct != RC2EP && segs[i].direct != EP2RC)) {
+			trans_dbg(tdev, TR_ERR,
+				"edma: %s, invalid segment %u size:0x%x dir:%u\n",
+				__func__, i, segs[i].size, segs[i].direct);
+			rv = -EINVAL;
+			goto out_unmap;
+		}
+		pin = ktime_get();
+		rv = edma_umap_get(tdev, segs[i].rc_addr, segs[i].size,
+				   &maps[i], false);
+		edma_pin_add(tedma, segs[i].direct, pin);
+		if (rv) {
+			trans_dbg(tdev, TR_ERR,
+				"edma: %s, map segment %u failed:%d\n",
+				__func__, i, rv);
+			goto out_unmap;
+		}
+	}
+
+	*psegs = segs;
+	*pmaps = maps;
+	return 0;
+
+out_unmap:
+	edma_vec_unmap(tdev, maps, i);
+	kfree(segs);
+	return rv;
+out_free:
+	kfree(maps);
+	kfree(segs);
+	return rv;
+}
+
+/*
+ * vectored transfer: the segments are sent as one link table job per
+ * direction, instead of one ioctl, channel and interrupt per segment.
+ */
+static int edma_tranx_vec_mode(struct trans_edma_vec *info,
+				    struct cb_tranx_t *tdev, u32 prio)
+{
+	struct trans_edma_seg *segs;
+	struct edma_umap *maps;
+	int rv;
+
+	rv = edma_vec_map(tdev, info->segs, info->seg_cnt, &segs, &maps);
+	if (rv)
+		return rv;
+
+	rv = edma_vec_xfer(tdev, segs, maps, info->seg_cnt, prio);
+
+	edma_vec_unmap(tdev, maps, info->seg_cnt);
+	kfree(segs);
+	return rv;
+}
+
+/* max async edma jobs of one file, in flight or not reaped yet */
+#define EDMA_ASYNC_JOB_MAX	64
+
+/* edma state of one file: its priority, poll mode and async jobs */
+struct edma_file {
+	struct list_head list;
+	struct file *filp;
+	/* TASK_LIVE or TASK_VOD, for the channels of its transfers */
+	u32 priority;
+	/* enum TRANS_EDMA_POLL, the completion of its transfers */
+	u32 poll;
+	/* finished jobs, in completion order */
+	struct list_head done;
+	/* jobs in flight or not reaped, and jobs in flight */
+	u32 job_cnt;
+	u32 running;
+	u64 last_id;
+	struct eventfd_ctx *efd;
+};
+
+/*
+ * an async vectored job. Its pages are pinned when it's submitted, a
+ * worker sends it and queues it to the done list of its file.
+ */
+struct edma_async_job {
+	struct list_head list;
+	struct work_struct work;
+	struct cb_tranx_t *tdev;
+	struct edma_file *ef;
+	u64 job_id;
+	int status;
+	u32 prio;
+	u32 seg_cnt;
+	struct trans_edma_seg *segs;
+	struct edma_umap *maps;
+};
+
+/* find the edma state of filp, tedma->efile_mutex is held */
+static struct edma_file *edma_file_find(struct edma_t *tedma,
+					      struct file *filp)
+{
+	struct edma_file *ef;
+
+	list_for_each_entry(ef, &tedma->efiles, list) {
+		if (ef->filp == filp)
+			return ef;
+	}
+
+	return NULL;
+}
+
+/* find or create the edma state of filp, tedma->efile_mutex is held */
+static struct edma_file *edma_file_get(struct edma_t *tedma,
+					     struct file *filp)
+{
+	struct edma_file *ef;
+
+	ef = edma_file_find(tedma, filp);
+	if (ef)
+		return ef;
+
+	ef = kzalloc(sizeof(*ef), GFP_KERNEL);
+	if (!ef)
+		return NULL;
+	ef->filp = filp;
+	ef->priority = TASK_LIVE;
+	INIT_LIST_HEAD(&ef->done);
+	list_add_tail(&ef->list, &tedma->efiles);
+
+	return ef;
+}
+
+/*
+ * the priority and poll mode of the transfers of filp, see EDMA_XFER().
+ * LIVE and EDMA_POLL_AUTO unless they're set.
+ */
+static u32 edma_file_prio(struct edma_t *tedma, struct file *filp)
+{
+	struct edma_file *ef;
+	u32 prio = EDMA_XFER(TASK_LIVE, EDMA_POLL_AUTO);
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_find(tedma, filp);
+	if (ef)
+		prio = EDMA_XFER(ef->priority, ef->poll);
+	mutex_unlock(&tedma->efile_mutex);
+
+	return prio;
+}
+
+/* override the poll mode of *prio by the one of a request, if it has one */
+static int edma_req_prio(struct cb_tranx_t *tdev, u32 *prio, u32 poll)
+{
+	if (poll > EDMA_POLL_OFF) {
+		trans_dbg(tdev, TR_ERR, "edma: poll mode:%u error\n", poll);
+		return -EINVAL;
+	}
+	if (poll != EDMA_POLL_AUTO)
+		*prio = EDMA_XFER(EDMA_XFER_PRIO(*prio), poll);
+
+	return 0;
+}
+
+static int edma_set_prio(struct file *filp, u32 prio,
+			      struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_file *ef;
+
+	if (prio > TASK_VOD) {
+		trans_dbg(tdev, TR_ERR,
+			  "edma: task_priority:%d error\n", prio);
+		return -EINVAL;
+	}
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_get(tedma, filp);
+	if (ef)
+		ef->priority = prio;
+	mutex_unlock(&tedma->efile_mutex);
+
+	return ef ? 0 : -ENOMEM;
+}
+
+static int edma_set_poll(struct file *filp, u32 poll,
+			      struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_file *ef;
+
+	if (poll > EDMA_POLL_OFF) {
+		trans_dbg(tdev, TR_ERR, "edma: poll mode:%u error\n", poll);
+		return -EINVAL;
+	}
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_get(tedma, filp);
+	if (ef)
+		ef->poll = poll;
+	mutex_unlock(&tedma->efile_mutex);
+
+	return ef ? 0 : -ENOMEM;
+}
+
+static void edma_async_work(struct work_struct *work)
+{
+	struct edma_async_job *job =
+		container_of(work, struct edma_async_job, work);
+	struct cb_tranx_t *tdev = job->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_file *ef = job->ef;
+
+	job->status = edma_vec_xfer(tdev, job->segs, job->maps, job->seg_cnt,
+				    job->prio);
+	if (job->status)
+		trans_dbg(tdev, TR_ERR, "edma: async job %llu failed:%d\n",
+			  job->job_id, job->status);
+	edma_vec_unmap(tdev, job->maps, job->seg_cnt);
+	kfree(job->segs);
+	job->maps = NULL;
+	job->segs = NULL;
+
+	mutex_lock(&tedma->efile_mutex);
+	list_add_tail(&job->list, &ef->done);
+	ef->running--;
+	if (ef->efd)
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(6, 8, 0))
+		eventfd_signal(ef->efd, 1);
+#else
+		eventfd_signal(ef->efd);
+#endif
+	mutex_unlock(&tedma->efile_mutex);
+
+	wake_up_all(&tedma->async_wait);
+}
+
+/* pin a vectored request and queue it, the job id is returned in info */
+static int edma_async_submit(struct file *filp,
+				  struct trans_edma_submit *info,
+				  struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_async_job *job;
+	struct edma_file *ef;
+	u32 prio = 0;
+	int rv;
+
+	/* validate the poll mode before pinning anything */
+	rv = edma_req_prio(tdev, &prio, info->poll);
+	if (rv)
+		return rv;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+	rv = edma_vec_map(tdev, info->segs, info->seg_cnt, &job->segs,
+			  &job->maps);
+	if (rv)
+		goto out_free_job;
+	job->seg_cnt = info->seg_cnt;
+	job->tdev = tdev;
+	INIT_WORK(&job->work, edma_async_work);
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_get(tedma, filp);
+	if (!ef) {
+		rv = -ENOMEM;
+		goto out_unlock;
+	}
+	if (ef->job_cnt >= EDMA_ASYNC_JOB_MAX) {
+		rv = -EBUSY;
+		goto out_unlock;
+	}
+	ef->job_cnt++;
+	ef->running++;
+	job->ef = ef;
+	job->job_id = ++ef->last_id;
+	job->prio = EDMA_XFER(ef->priority, ef->poll);
+	edma_req_prio(tdev, &job->prio, info->poll);
+	info->job_id = job->job_id;
+	mutex_unlock(&tedma->efile_mutex);
+
+	queue_work(tedma->async_wq, &job->work);
+	return 0;
+
+out_unlock:
+	mutex_unlock(&tedma->efile_mutex);
+	edma_vec_unmap(tdev, job->maps, job->seg_cnt);
+	kfree(job->segs);
+out_free_job:
+	kfree(job);
+	return rv;
+}
+
+/* return the finished jobs of filp, up to info->max; it never blocks */
+static int edma_async_reap(struct file *filp, struct trans_edma_reap *info,
+				struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_async_job *job, *tmp;
+	struct trans_edma_done *done;
+	struct edma_file *ef;
+	LIST_HEAD(reaped);
+	u32 max, cnt = 0;
+	int rv = 0;
+
+	max = min_t(u32, info->max, EDMA_ASYNC_JOB_MAX);
+	info->cnt = 0;
+	if (!max)
+		return 0;
+	done = kcalloc(max, sizeof(*done), GFP_KERNEL);
+	if (!done)
+		return -ENOMEM;
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_find(tedma, filp);
+	if (ef) {
+		list_for_each_entry_safe(job, tmp, &ef->done, list) {
+			if (cnt == max)
+				break;
+			list_move_tail(&job->list, &reaped);
+			cnt++;
+		}
+		ef->job_cnt -= cnt;
+	}
+	mutex_unlock(&tedma->efile_mutex);
+
+	cnt = 0;
+	list_for_each_entry_safe(job, tmp, &reaped, list) {
+		done[cnt].job_id = job->job_id;
+		done[cnt].status = job->status;
+		cnt++;
+		list_del(&job->list);
+		kfree(job);
+	}
+	if (cnt && copy_to_user((void __user *)(uintptr_t)info->done, done,
+				cnt * sizeof(*done)))
+		rv = -EFAULT;
+	info->cnt = cnt;
+
+	kfree(done);
+	return rv;
+}
+
+/* signal an eventfd on every job completion of filp, fd < 0 to stop */
+static int edma_async_eventfd(struct file *filp, int fd,
+				   struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct eventfd_ctx *efd = NULL, *old;
+	struct edma_file *ef;
+
+	if (fd >= 0) {
+		efd = eventfd_ctx_fdget(fd);
+		if (IS_ERR(efd))
+			return PTR_ERR(efd);
+	}
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_get(tedma, filp);
+	if (!ef) {
+		mutex_unlock(&tedma->efile_mutex);
+		if (efd)
+			eventfd_ctx_put(efd);
+		return -ENOMEM;
+	}
+	old = ef->efd;
+	ef->efd = efd;
+	mutex_unlock(&tedma->efile_mutex);
+
+	if (old)
+		eventfd_ctx_put(old);
+	return 0;
+}
+
+/* the file is readable when it has finished jobs to reap */
+__poll_t edma_poll(struct cb_tranx_t *tdev, struct file *filp,
+		   poll_table *wait)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_file *ef;
+	__poll_t mask = 0;
+
+	poll_wait(filp, &tedma->async_wait, wait);
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_find(tedma, filp);
+	if (ef && !list_empty(&ef->done))
+		mask = POLLIN | POLLRDNORM;
+	mutex_unlock(&tedma->efile_mutex);
+
+	return mask;
+}
+
+static bool edma_async_idle(struct edma_t *tedma, struct edma_file *ef)
+{
+	bool idle;
+
+	mutex_lock(&tedma->efile_mutex);
+	idle = (ef->running == 0);
+	mutex_unlock(&tedma->efile_mutex);
+
+	return idle;
+}
+
+/* wait for the async jobs of a closed file, and drop its edma state */
+static void edma_file_close(struct cb_tranx_t *tdev, struct file *filp)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_async_job *job, *tmp;
+	struct edma_file *ef;
+
+	mutex_lock(&tedma->efile_mutex);
+	ef = edma_file_find(tedma, filp);
+	if (ef)
+		list_del(&ef->list);
+	mutex_unlock(&tedma->efile_mutex);
+	if (!ef)
+		return;
+
+	wait_event(tedma->async_wait, edma_async_idle(tedma, ef));
+	list_for_each_entry_safe(job, tmp, &ef->done, list) {
+		list_del(&job->list);
+		kfree(job);
+	}
+	if (ef->efd)
+		eventfd_ctx_put(ef->efd);
+	kfree(ef);
+}
+
+/* max rc buffers one file can register for edma */
+#define EDMA_REG_BUF_MAX	64
+
+/*
+ * a rc buffer registered for edma. Its pages stay pinned and dma mapped
+ * until it's unregistered or the file is closed, so the transfers on it
+ * skip get_user_pages and the sg mapping.
+ */
+struct edma_reg_buf {
+	struct list_head list; /* in the buffers to release on close */
+	struct kref ref;
+	struct file *filp;
+	struct cb_tranx_t *tdev;
+	u32 handle;
+	u32 size;
+	struct edma_umap map;
+};
+
+static void edma_reg_buf_release(struct kref *ref)
+{
+	struct edma_reg_buf *buf = container_of(ref, struct edma_reg_buf, ref);
+
+	edma_umap_put(buf->tdev, &buf->map);
+	kfree(buf);
+}
+
+static int edma_reg_buf(struct file *filp, struct trans_edma_buf *info,
+			     struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_reg_buf *buf, *tmp;
+	int cnt = 0;
+	int id, rv;
+
+	if (!info->size)
+		return -EINVAL;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	rv = edma_umap_get(tdev, info->rc_addr, info->size, &buf->map, true);
+	if (rv) {
+		kfree(buf);
+		return rv;
+	}
+
+	kref_init(&buf->ref);
+	buf->filp = filp;
+	buf->tdev = tdev;
+	buf->size = info->size;
+
+	/* count and insert in one hold, so the threads of a file can't pass
+	 * the limit together.
+	 */
+	mutex_lock(&tedma->reg_mutex);
+	idr_for_each_entry(&tedma->reg_idr, tmp, id) {
+		if (tmp->filp == filp)
+			cnt++;
+	}
+	if (cnt >= EDMA_REG_BUF_MAX) {
+		mutex_unlock(&tedma->reg_mutex);
+		trans_dbg(tdev, TR_ERR,
+			"edma: %s, %d buffers registered already\n",
+			__func__, cnt);
+		kref_put(&buf->ref, edma_reg_buf_release);
+		return -ENOSPC;
+	}
+	/* handle 0 means no buffer; cyclic, so a freed handle isn't given
+	 * again soon and a live one never is.
+	 */
+	id = idr_alloc_cyclic(&tedma->reg_idr, buf, 1, 0, GFP_KERNEL);
+	if (id > 0)
+		buf->handle = id;
+	mutex_unlock(&tedma->reg_mutex);
+	if (id < 0) {
+		kref_put(&buf->ref, edma_reg_buf_release);
+		return id;
+	}
+
+	info->handle = buf->handle;
+	trans_dbg(tdev, TR_DBG,
+		"edma: register buffer %u, size:0x%x segments:%d\n",
+		buf->handle, buf->size, buf->map.seg_cnt);
+	return 0;
+}
+
+/* find a registered buffer of filp, and take a reference on it */
+static struct edma_reg_buf *edma_get_reg_buf(struct edma_t *tedma,
+						   struct file *filp,
+						   u32 handle)
+{
+	struct edma_reg_buf *buf;
+
+	mutex_lock(&tedma->reg_mutex);
+	buf = idr_find(&tedma->reg_idr, handle);
+	if (buf && buf->filp == filp)
+		kref_get(&buf->ref);
+	else
+		buf = NULL;
+	mutex_unlock(&tedma->reg_mutex);
+
+	return buf;
+}
+
+static int edma_unreg_buf(struct file *filp, u32 handle,
+			       struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_reg_buf *buf;
+
+	mutex_lock(&tedma->reg_mutex);
+	buf = idr_find(&tedma->reg_idr, handle);
+	if (!buf || buf->filp != filp) {
+		mutex_unlock(&tedma->reg_mutex);
+		return -EINVAL;
+	}
+	idr_remove(&tedma->reg_idr, handle);
+	mutex_unlock(&tedma->reg_mutex);
+
+	/* a running transfer keeps the buffer until it's done */
+	kref_put(&buf->ref, edma_reg_buf_release);
+	return 0;
+}
+
+static int edma_tranx_reg_buf(struct file *filp,
+				   struct trans_edma_buf_tranx *info,
+				   struct cb_tranx_t *tdev)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct device *dev = &tdev->pdev->dev;
+	struct edma_reg_buf *buf;
+	struct edma_scratch *sc;
+	int rv;
+
+	buf = edma_get_reg_buf(tedma, filp, info->handle);
+	if (!buf) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: %s, buffer %u is not registered\n",
+			__func__, info->handle);
+		return -EINVAL;
+	}
+
+	if (!info->size || info->offset > buf->size ||
+	    info->size > buf->size - info->offset ||
+	    (info->direct != RC2EP && info->direct != EP2RC)) {
+		trans_dbg(tdev, TR_ERR,
+			"edma: %s, invalid off:0x%x size:0x%x dir:%u of %u\n",
+			__func__, info->offset, info->size, info->direct,
+			info->handle);
+		rv = -EINVAL;
+		goto out;
+	}
+
+	if (info->direct == RC2EP)
+		dma_sync_sg_for_device(dev, buf->map.sgt.sgl,
+				       buf->map.sgt.nents, DMA_BIDIRECTIONAL);
+	sc = edma_scratch_get(tedma);
+	rv = edma_segs_xfer(tdev, info->direct, buf->map.segs,
+			    buf->map.seg_cnt, info->offset, info->size, 1, 0,
+			    info->ep_addr, 0, edma_file_prio(tedma, filp), sc);
+	edma_scratch_put(tedma, sc);
+	if (info->direct == EP2RC)
+		dma_sync_sg_for_cpu(dev, buf->map.sgt.sgl,
+				    buf->map.sgt.nents, DMA_BIDIRECTIONAL);
+
+out:
+	kref_put(&buf->ref, edma_reg_buf_release);
+	return rv;
+}
+
+/*
+ * a file is closed: wait for its async jobs and release the buffers it
+ * registered.
+ */
+void edma_close(struct cb_tranx_t *tdev, struct file *filp)
+{
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_reg_buf *buf, *tmp;
+	LIST_HEAD(release);
+	int id;
+
+	edma_file_close(tdev, filp);
+
+	mutex_lock(&tedma->reg_mutex);
+	idr_for_each_entry(&tedma->reg_idr, buf, id) {
+		if (buf->filp == filp) {
+			idr_remove(&tedma->reg_idr, id);
+			list_add_tail(&buf->list, &release);
+		}
+	}
+	mutex_unlock(&tedma->reg_mutex);
+
+	list_for_each_entry_safe(buf, tmp, &release, list) {
+		trans_dbg(tdev, TR_DBG, "edma: %s buffer:%u\n",
+			  __func__, buf->handle);
+		list_del(&buf->list);
+		kref_put(&buf->ref, edma_reg_buf_release);
+	}
+}
+
+static int tcache_process_loop(struct tcache_info *tc_info)
+{
+	int rv, i;
 	struct dma_link_table  *new_table;
 	struct trans_pcie_edma edma_info;
 	struct edma_t *tedma = tc_info->tedma;
@@ -1324,7 +2763,7 @@ static int tcache_process_loop(struct tcache_info *tc_info)
 					edma_info.direct = RC2EP;
 					tc_info->cur_element_cnt = edma_info.element_size;
 					/* start next tranx */
-					rv = edma_tranx_rc2ep(&new_table[tc_info->current_index], &edma_info, tedma->tdev, 1, c, 0);
+					rv = edma_tranx_rc2ep(&new_table[tc_info->current_index], &edma_info, tedma->tdev, 1, c, 0, TASK_LIVE);
 					if (rv == -EFAULT) { /* fatal error, set tcache error, stop timer */
 						trans_dbg(tedma->tdev, TR_ERR,
 							"edma: %s_%d tranx error!!!!!  cur_fram=%d next_index=%d.\n",
@@ -1429,6 +2868,7 @@ static int edma_tranx_tcache_mode(struct trans_pcie_edma *edma_info,
 	int rv;
 	unsigned int ctl = DMA_CB;
 	struct rc_addr_info paddr_array;
+	struct edma_scratch *sc;
 	int size;
 	unsigned long vaddr;
 	struct dma_link_table __iomem *user_table;
@@ -1459,16 +2899,18 @@ static int edma_tranx_tcache_mode(struct trans_pcie_edma *edma_info,
 #endif
 	edma_info->size = 0;
 	/* create a new link table */
+	sc = edma_scratch_get(tedma);
 	for (i = 0; i < edma_info->element_size; i++) {
 		vaddr = user_table[i].sar_high;
 		vaddr = (vaddr<<32)|user_table[i].sar_low;
 		size = user_table[i].size;
 
-		rv = cb_get_dma_addr(tdev, vaddr, size, &paddr_array);
+		rv = cb_get_dma_addr(tdev, vaddr, size, &paddr_array, sc);
 		if (rv != 1) {
 			trans_dbg(tdev, TR_ERR,
 				"edma: %s cb_get_dma_addr failed rv=%d\n",
 				__func__, rv);
+			edma_scratch_put(tedma, sc);
 			goto out;
 		}
 
@@ -1482,6 +2924,7 @@ static int edma_tranx_tcache_mode(struct trans_pcie_edma *edma_info,
 		new_table[i].dst_low = user_table[i].dst_low;
 		edma_info->size += new_table[i].size;
 	}
+	edma_scratch_put(tedma, sc);
 
 	tedma->tcache_link_size[edma_info->slice] = edma_info->element_size;
 
@@ -1492,7 +2935,7 @@ static int edma_tranx_tcache_mode(struct trans_pcie_edma *edma_info,
 	tedma->tc_info[edma_info->slice].cur_element_cnt = edma_info->element_size;
 	tcache_write(tedma->tdev, edma_info->slice, 0x131d, 0x3);
 #endif
-	rv = edma_tranx_rc2ep(new_table, edma_info, tdev, 1, c, 0);
+	rv = edma_tranx_rc2ep(new_table, edma_info, tdev, 1, c, 0, TASK_LIVE);
 #ifndef ENABLE_HANDSHAKE
 	if (rv == EDMA_ERROR_FLAG) {
 		trans_dbg(tedma->tdev, TR_NOTICE,
@@ -1506,7 +2949,7 @@ static int edma_tranx_tcache_mode(struct trans_pcie_edma *edma_info,
 				"edma: first %s, wait rc2ep reset, but timeout, rv=%d\n",
 				__func__, rv);
 
-		rv = edma_tranx_rc2ep(new_table, edma_info, tdev, 1, c, 1);
+		rv = edma_tranx_rc2ep(new_table, edma_info, tdev, 1, c, 1, TASK_LIVE);
 	}
 
 	writel(0x1, tvcd->core[edma_info->slice*2].hwregs + 0x4);
@@ -1522,6 +2965,113 @@ out:
 	return rv;
 }
 
+/* update the transfers per second of the channels, once a second */
+static void edma_hist_tick(struct edma_t *tedma)
+{
+	struct edma_hist *h;
+	u64 cnt;
+	int d, c;
+
+	for (d = 0; d < 2; d++) {
+		for (c = 0; c < 4; c++) {
+			h = &tedma->hist[d][c];
+			cnt = atomic64_read(&h->cnt);
+			/* cnt may have been reset since the last tick */
+			h->tps = cnt >= h->last_cnt ? cnt - h->last_cnt : cnt;
+			h->last_cnt = cnt;
+			if (h->tps > h->tps_max)
+				h->tps_max = h->tps;
+		}
+	}
+}
+
+static void edma_hist_reset(struct edma_t *tedma)
+{
+	struct edma_hist *h;
+	int d, c, i;
+
+	for (d = 0; d < 2; d++) {
+		for (i = 0; i < EDMA_HIST_SLOTS; i++)
+			atomic64_set(&tedma->pin_hist[d][i], 0);
+		for (c = 0; c < 4; c++) {
+			h = &tedma->hist[d][c];
+			for (i = 0; i < EDMA_HIST_SLOTS; i++) {
+				atomic64_set(&h->queue[i], 0);
+				atomic64_set(&h->xfer[i], 0);
+				atomic64_set(&h->total[i], 0);
+				atomic64_set(&h->bytes[i], 0);
+			}
+			atomic64_set(&h->cnt, 0);
+			h->tps_max = 0;
+		}
+	}
+}
+
+static void edma_hist_seq(struct seq_file *m, const char *name,
+			  atomic64_t *slot)
+{
+	int i;
+
+	seq_printf(m, "  %-9s", name);
+	for (i = 0; i < EDMA_HIST_SLOTS; i++)
+		seq_printf(m, " %lld", (long long)atomic64_read(&slot[i]));
+	seq_putc(m, '\n');
+}
+
+/* the histograms of the channels which did transfers */
+static int edma_hist_show(struct seq_file *m, void *v)
+{
+	static const char * const dir[2] = { "rc2ep", "ep2rc" };
+	struct edma_t *tedma = m->private;
+	struct edma_hist *h;
+	int d, c;
+
+	seq_printf(m, "# slot 0: <1, slot n: [2^(n-1), 2^n), slot %d: >=2^%d\n",
+		   EDMA_HIST_SLOTS - 1, EDMA_HIST_SLOTS - 2);
+	for (d = 0; d < 2; d++) {
+		seq_printf(m, "%s:\n", dir[d]);
+		edma_hist_seq(m, "pin_us:", tedma->pin_hist[d]);
+		for (c = 0; c < 4; c++) {
+			h = &tedma->hist[d][c];
+			if (!atomic64_read(&h->cnt) && !h->tps_max)
+				continue;
+			seq_printf(m, "%s ch%d: cnt:%lld tps:%u tps_max:%u\n",
+				   dir[d], c, (long long)atomic64_read(&h->cnt),
+				   h->tps, h->tps_max);
+			edma_hist_seq(m, "queue_us:", h->queue);
+			edma_hist_seq(m, "xfer_us:", h->xfer);
+			edma_hist_seq(m, "total_us:", h->total);
+			edma_hist_seq(m, "kbytes:", h->bytes);
+		}
+	}
+
+	return 0;
+}
+
+static int edma_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, edma_hist_show, inode->i_private);
+}
+
+/* any write resets the histograms */
+static ssize_t edma_hist_write(struct file *file, const char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct seq_file *m = file->private_data;
+
+	edma_hist_reset(m->private);
+	return count;
+}
+
+static const struct file_operations edma_hist_fops = {
+	.owner = THIS_MODULE,
+	.open = edma_hist_open,
+	.read = seq_read,
+	.write = edma_hist_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 #if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 15, 0))
 static void pcie_bw_timer_isr(unsigned long data)
 {
@@ -1538,6 +3088,7 @@ static void pcie_bw_timer_isr(struct timer_list *t)
 		atomic64_read(&tedma->edma_perf.rc2ep_size) / 1024 / 1024;
 	atomic64_set(&tedma->edma_perf.ep2rc_size, 0);
 	atomic64_set(&tedma->edma_perf.rc2ep_size, 0);
+	edma_hist_tick(tedma);
 }
 
 irqreturn_t edma_isr(int irq, void *data)
@@ -1547,6 +3098,7 @@ irqreturn_t edma_isr(int irq, void *data)
 	struct cb_tranx_t *tdev = data;
 	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
 
+	spin_lock(&tedma->edma_irq_lock);
 	val_r = edma_read(tdev, DMA_READ_INT_STATUS_OFF);
 	if (val_r & ABORT_INT_STATUS) {
 		trans_dbg(tdev, TR_ERR,
@@ -1573,6 +3125,7 @@ irqreturn_t edma_isr(int irq, void *data)
 		if ((val_w >> i) & 0x1)
 			tedma->wait_condition_w[i] = 0x1;
 	}
+	spin_unlock(&tedma->edma_irq_lock);
 	wake_up_interruptible_all(&tedma->queue_wait);
 
 	return IRQ_HANDLED;
@@ -1686,14 +3239,212 @@ static ssize_t edma_reset_store(struct device *dev,
 
 	return count;
 }
+/* display the busy time of every ddr channel since load, unit is us */
+static ssize_t edma_chn_busy_show(struct device *dev,
+				  struct device_attribute *attr,
+				  char *buf)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_chn_sched *sch;
+	spinlock_t *lock;
+	u8 *cs;
+	u64 busy;
+	int dir, c, first, last, pos = 0;
+
+	for (dir = RC2EP; dir <= EP2RC; dir++) {
+		sch = &tedma->sched[dir];
+		if (dir == RC2EP) {
+			lock = &tedma->rc2ep_cs_lock;
+			cs = tedma->rc2ep_cs;
+			first = 1;
+			last = 2;
+		} else {
+			lock = &tedma->ep2rc_cs_lock;
+			cs = tedma->ep2rc_cs;
+			first = 0;
+			last = 3;
+		}
+		for (c = first; c <= last; c++) {
+			spin_lock(lock);
+			busy = sch->busy_us[c];
+			/* count the running transfer too */
+			if (cs[c] == EDMA_BUSY)
+				busy += ktime_to_us(ktime_sub(ktime_get(),
+							      sch->start[c]));
+			spin_unlock(lock);
+			pos += sprintf(buf + pos, "%s c%d: %llu us%s\n",
+				       dir == RC2EP ? "rc2ep" : "ep2rc", c, busy,
+				       cs[c] == EDMA_BUSY ? " (busy)" : "");
+		}
+	}
+
+	return pos;
+}
+
+/* max bytes of one ddr link transfer, 0: larger transfers aren't split */
+static ssize_t edma_chunk_size_show(struct device *dev,
+				    struct device_attribute *attr,
+				    char *buf)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+
+	return sprintf(buf, "%u\n", READ_ONCE(tedma->chunk_size));
+}
+
+static ssize_t edma_chunk_size_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf,
+				     size_t count)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	u32 size;
+
+	if (kstrtou32(buf, 0, &size))
+		return -EINVAL;
+	/* a chunk takes at least a page */
+	if (size && size < PAGE_SIZE)
+		return -EINVAL;
+
+	WRITE_ONCE(tedma->chunk_size, size);
+	trans_dbg(tdev, TR_INF, "edma: chunk size:0x%x\n", size);
+
+	return count;
+}
+
+/* arrays of transfers taken from the scratch buffers, or allocated */
+static ssize_t edma_scratch_show(struct device *dev,
+				 struct device_attribute *attr,
+				 char *buf)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_scratch_stat *st = &tedma->scratch_stat;
+
+	return sprintf(buf, "hits:%lld empty:%lld oversize:%lld\n",
+		       (long long)atomic64_read(&st->hits),
+		       (long long)atomic64_read(&st->empty),
+		       (long long)atomic64_read(&st->oversize));
+}
+
+/* transfers up to edma_poll_size bytes poll, 0: none does */
+static ssize_t edma_poll_size_show(struct device *dev,
+				   struct device_attribute *attr,
+				   char *buf)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+
+	return sprintf(buf, "%u\n", READ_ONCE(tedma->poll_size));
+}
+
+static ssize_t edma_poll_size_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf,
+				    size_t count)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	u32 size;
+
+	if (kstrtou32(buf, 0, &size))
+		return -EINVAL;
+
+	WRITE_ONCE(tedma->poll_size, size);
+	trans_dbg(tdev, TR_INF, "edma: poll size:0x%x\n", size);
+
+	return count;
+}
+
+/* max time of a poll before waiting for the interrupt, in us */
+static ssize_t edma_poll_us_show(struct device *dev,
+				 struct device_attribute *attr,
+				 char *buf)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+
+	return sprintf(buf, "%u\n", READ_ONCE(tedma->poll_us));
+}
+
+static ssize_t edma_poll_us_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf,
+				  size_t count)
+{
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	u32 us;
+
+	/* it spins with the channel held, keep it short */
+	if (kstrtou32(buf, 0, &us) || us > 1000)
+		return -EINVAL;
+
+	WRITE_ONCE(tedma->poll_us, us);
+	trans_dbg(tdev, TR_INF, "edma: poll time:%uus\n", us);
+
+	return count;
+}
+
+/* latency of the ddr transfers by completion mode, in ns */
+static ssize_t edma_latency_show(struct device *dev,
+				 struct device_attribute *attr,
+				 char *buf)
+{
+	static const char * const name[EDMA_LAT_NUM] = {
+		"poll", "fallback", "irq"
+	};
+	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
+	struct cb_tranx_t *tdev = mtdev->tdev;
+	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
+	struct edma_lat_stat *st;
+	s64 cnt, ns;
+	int pos = 0;
+	int i;
+
+	for (i = 0; i < EDMA_LAT_NUM; i++) {
+		st = &tedma->lat[i];
+		cnt = atomic64_read(&st->cnt);
+		ns = atomic64_read(&st->ns);
+		pos += sprintf(buf + pos, "%s: cnt:%lld avg:%lld max:%lld\n",
+			       name[i], (long long)cnt,
+			       (long long)(cnt ? div64_s64(ns, cnt) : 0),
+			       (long long)atomic64_read(&st->max_ns));
+	}
+
+	return pos;
+}
+
 static DEVICE_ATTR_WO(edma_reset);
 static DEVICE_ATTR_RO(pcie_r_bw);
 static DEVICE_ATTR_RO(pcie_w_bw);
+static DEVICE_ATTR_RO(edma_chn_busy);
+static DEVICE_ATTR_RW(edma_chunk_size);
+static DEVICE_ATTR_RO(edma_scratch);
+static DEVICE_ATTR_RW(edma_poll_size);
+static DEVICE_ATTR_RW(edma_poll_us);
+static DEVICE_ATTR_RO(edma_latency);
 
 static struct attribute *trans_edma_sysfs_entries[] = {
 	&dev_attr_pcie_r_bw.attr,
 	&dev_attr_pcie_w_bw.attr,
 	&dev_attr_edma_reset.attr,
+	&dev_attr_edma_chn_busy.attr,
+	&dev_attr_edma_chunk_size.attr,
+	&dev_attr_edma_scratch.attr,
+	&dev_attr_edma_poll_size.attr,
+	&dev_attr_edma_poll_us.attr,
+	&dev_attr_edma_latency.attr,
 	NULL
 };
 
@@ -1785,7 +3536,7 @@ static enum hrtimer_restart tcache_timer_isr(struct hrtimer *t)
 				edma_info.direct = RC2EP;
 				tc_info->cur_element_cnt = edma_info.element_size;
 				/* start next tranx */
-				rv = edma_tranx_rc2ep(&new_table[tc_info->current_index], &edma_info, tedma->tdev, 1, c, 0);
+				rv = edma_tranx_rc2ep(&new_table[tc_info->current_index], &edma_info, tedma->tdev, 1, c, 0, TASK_LIVE);
 				if (rv == -EFAULT) { /* fatal error, set tcache error, stop timer */
 					trans_dbg(tedma->tdev, TR_ERR,
 						"edma: %s_%d tranx error!!!!!  cur_fram=%d next_index=%d.\n",
@@ -1948,14 +3699,35 @@ int edma_init(struct cb_tranx_t *tdev)
 #endif
 	add_timer(&tedma->perf_timer);
 
-	sema_init(&tedma->ep2rc_sem, 4);
-	sema_init(&tedma->rc2ep_sem, 2);
+	for (i = 0; i < 2; i++) {
+		init_waitqueue_head(&tedma->sched[i].wait);
+		atomic_set(&tedma->sched[i].live_waiting, 0);
+	}
+	tedma->chunk_size = EDMA_CHUNK_SIZE;
+	tedma->poll_size = EDMA_POLL_SIZE;
+	tedma->poll_us = EDMA_POLL_US;
+	spin_lock_init(&tedma->edma_irq_lock);
 	init_waitqueue_head(&tedma->queue_wait);
 
 	spin_lock_init(&tedma->rc2ep_cfg_lock);
 	spin_lock_init(&tedma->ep2rc_cfg_lock);
 	spin_lock_init(&tedma->rc2ep_cs_lock);
 	spin_lock_init(&tedma->ep2rc_cs_lock);
+	idr_init(&tedma->reg_idr);
+	mutex_init(&tedma->reg_mutex);
+	INIT_LIST_HEAD(&tedma->efiles);
+	mutex_init(&tedma->efile_mutex);
+	init_waitqueue_head(&tedma->async_wait);
+	/* one worker per channel, so async jobs run on all channels */
+	tedma->async_wq = alloc_workqueue("edma_async", WQ_UNBOUND, 6);
+	if (!tedma->async_wq) {
+		trans_dbg(tdev, TR_ERR, "edma: alloc async workqueue failed\n");
+		goto out_free_table;
+	}
+	if (edma_scratch_init(tedma)) {
+		trans_dbg(tdev, TR_ERR, "edma: alloc scratch buffers failed\n");
+		goto out_free_table;
+	}
 
 	ret = sysfs_create_group(&tdev->misc_dev->this_device->kobj,
 				&trans_edma_attribute_group);
@@ -2021,6 +3793,10 @@ int edma_init(struct cb_tranx_t *tdev)
 	init_waitqueue_head(&tedma->ep2rc_err_chk.chk_queue);
 	spin_lock_init(&tedma->ep2rc_err_chk.chk_lock);
 
+	/* debugfs is optional, its errors are ignored */
+	tedma->debugfs = debugfs_create_file("edma_hist", 0600, tdev->debugfs,
+					     tedma, &edma_hist_fops);
+
 	trans_dbg(tdev, TR_INF, "edma: module initialize done.\n");
 	return 0;
 
@@ -2028,6 +3804,9 @@ out_remove_sysnode:
 	sysfs_remove_group(&tdev->misc_dev->this_device->kobj,
 				&trans_edma_attribute_group);
 out_free_table:
+	edma_scratch_release(tedma);
+	if (tedma->async_wq)
+		destroy_workqueue(tedma->async_wq);
 	del_timer_sync(&tedma->perf_timer);
 	iounmap(tedma->vedma_lt);
 out_free_edma:
@@ -2046,6 +3825,7 @@ void edma_release(struct cb_tranx_t *tdev)
 {
 	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
 
+	debugfs_remove(tedma->debugfs);
 	del_timer_sync(&tedma->perf_timer);
 	sysfs_remove_group(&tdev->misc_dev->this_device->kobj,
 			   &trans_edma_attribute_group);
@@ -2072,6 +3852,11 @@ void edma_release(struct cb_tranx_t *tdev)
 	edma_free_irq(tdev);
 
 	vfree(tedma->tc_info[0].table_buffer);
+	destroy_workqueue(tedma->async_wq);
+	edma_scratch_release(tedma);
+	mutex_destroy(&tedma->efile_mutex);
+	idr_destroy(&tedma->reg_idr);
+	mutex_destroy(&tedma->reg_mutex);
 	kfree(tedma);
 	trans_dbg(tdev, TR_DBG, "edma: remove module done.\n");
 }
@@ -2084,7 +3869,14 @@ long edma_ioctl(struct file *filp, unsigned int cmd,
 	struct trans_pcie_edma edma_info;
 	unsigned int val, c, tl_s, ctl, slice;
 	struct trans_pcie_edma edma_trans;
+	struct trans_pcie_edma_2d edma_2d;
+	struct trans_edma_buf edma_buf;
+	struct trans_edma_buf_tranx edma_buf_tranx;
+	struct trans_edma_vec edma_vec;
+	struct trans_edma_submit edma_submit;
+	struct trans_edma_reap edma_reap;
 	unsigned long ep_addr;
+	u32 prio;
 	struct edma_t *tedma = tdev->modules[TR_MODULE_EDMA];
 	struct dma_link_table __iomem *new_table;
 	struct dma_link_table __iomem *user_table;
@@ -2115,7 +3907,7 @@ long edma_ioctl(struct file *filp, unsigned int cmd,
 			sizeof(u32) * 20;
 #endif
 		edma_trans.direct = RC2EP;
-		ret = edma_tranx_viraddr_mode(&edma_trans, tdev);
+		ret = edma_tranx_viraddr_mode(&edma_trans, tdev, TASK_LIVE);
 		if (ret) {
 			trans_dbg(tdev, TR_NOTICE,
 				"edma: get link table failed,ep:0x%x,rc:0x%lx size:0x%x\n",
@@ -2127,7 +3919,70 @@ long edma_ioctl(struct file *filp, unsigned int cmd,
 	case CB_TRANX_EDMA_TRANX:
 		if (copy_from_user(&edma_info, argp, sizeof(edma_info)))
 			return -EFAULT;
-		ret = edma_tranx_viraddr_mode(&edma_info, tdev);
+		ret = edma_tranx_viraddr_mode(&edma_info, tdev,
+					      edma_file_prio(tedma, filp));
+		break;
+	case CB_TRANX_EDMA_2D_TRANX:
+		if (copy_from_user(&edma_2d, argp, sizeof(edma_2d)))
+			return -EFAULT;
+		ret = edma_tranx_2d_mode(&edma_2d, tdev,
+					 edma_file_prio(tedma, filp));
+		break;
+	case CB_TRANX_EDMA_REG_BUF:
+		if (copy_from_user(&edma_buf, argp, sizeof(edma_buf)))
+			return -EFAULT;
+		ret = edma_reg_buf(filp, &edma_buf, tdev);
+		if (!ret && copy_to_user(argp, &edma_buf, sizeof(edma_buf))) {
+			edma_unreg_buf(filp, edma_buf.handle, tdev);
+			return -EFAULT;
+		}
+		break;
+	case CB_TRANX_EDMA_UNREG_BUF:
+		if (copy_from_user(&val, argp, sizeof(val)))
+			return -EFAULT;
+		ret = edma_unreg_buf(filp, val, tdev);
+		break;
+	case CB_TRANX_EDMA_BUF_TRANX:
+		if (copy_from_user(&edma_buf_tranx, argp, sizeof(edma_buf_tranx)))
+			return -EFAULT;
+		ret = edma_tranx_reg_buf(filp, &edma_buf_tranx, tdev);
+		break;
+	case CB_TRANX_EDMA_VEC_TRANX:
+		if (copy_from_user(&edma_vec, argp, sizeof(edma_vec)))
+			return -EFAULT;
+		prio = edma_file_prio(tedma, filp);
+		ret = edma_req_prio(tdev, &prio, edma_vec.poll);
+		if (!ret)
+			ret = edma_tranx_vec_mode(&edma_vec, tdev, prio);
+		break;
+	case CB_TRANX_EDMA_ASYNC_SUBMIT:
+		if (copy_from_user(&edma_submit, argp, sizeof(edma_submit)))
+			return -EFAULT;
+		ret = edma_async_submit(filp, &edma_submit, tdev);
+		if (!ret && copy_to_user(argp, &edma_submit, sizeof(edma_submit)))
+			return -EFAULT;
+		break;
+	case CB_TRANX_EDMA_ASYNC_REAP:
+		if (copy_from_user(&edma_reap, argp, sizeof(edma_reap)))
+			return -EFAULT;
+		ret = edma_async_reap(filp, &edma_reap, tdev);
+		if (copy_to_user(argp, &edma_reap, sizeof(edma_reap)))
+			return -EFAULT;
+		break;
+	case CB_TRANX_EDMA_ASYNC_EVENTFD:
+		if (copy_from_user(&val, argp, sizeof(val)))
+			return -EFAULT;
+		ret = edma_async_eventfd(filp, (int)val, tdev);
+		break;
+	case CB_TRANX_EDMA_SET_PRIO:
+		if (copy_from_user(&val, argp, sizeof(val)))
+			return -EFAULT;
+		ret = edma_set_prio(filp, val, tdev);
+		break;
+	case CB_TRANX_EDMA_SET_POLL:
+		if (copy_from_user(&val, argp, sizeof(val)))
+			return -EFAULT;
+		ret = edma_set_poll(filp, val, tdev);
 		break;
 	case CB_TRANX_EDMA_PHY_TRANX:
 		if (copy_from_user(&edma_info, argp, sizeof(edma_info)))
@@ -9,8 +9,17 @@
 #include <linux/types.h>
 #include <linux/ioctl.h>
 #include <linux/hrtimer.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/idr.h>
+#include <linux/poll.h>
+#include <linux/version.h>
 #include "common.h"
 
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(4, 16, 0))
+typedef unsigned int __poll_t;
+#endif
+
 #define TC_EDMA_RSV		0x00
 #define TC_EDMA_RUNNING		0x01
 #define TC_EDMA_ERROR		0x10
@@ -73,6 +82,86 @@ struct err_chk {
 	struct edma_t *tedma;
 };
 
+/*
+ * ddr channel scheduling of one direction. A freed channel goes to the
+ * LIVE transfers first, a VOD transfer gets one only when no LIVE waits.
+ * @wait: the transfers waiting for a channel.
+ * @live_waiting: LIVE transfers waiting for a channel.
+ * @start[4]: the time each busy channel was got.
+ * @busy_us[4]: total busy time of each channel, in us.
+ */
+struct edma_chn_sched {
+	wait_queue_head_t wait;
+	atomic_t live_waiting;
+	ktime_t start[4];
+	u64 busy_us[4];
+};
+
+struct edma_scratch;
+struct dentry;
+
+/* completion modes of the ddr transfers, for the latency report */
+enum {
+	EDMA_LAT_POLL,		/* done while polling */
+	EDMA_LAT_FALLBACK,	/* polled, then waited for the interrupt */
+	EDMA_LAT_IRQ,		/* waited for the interrupt */
+	EDMA_LAT_NUM,
+};
+
+/*
+ * latency of the transfers of one completion mode, from the doorbell
+ * to the completion seen by the driver.
+ * @cnt: transfers done.
+ * @ns: their total latency.
+ * @max_ns: the largest latency.
+ */
+struct edma_lat_stat {
+	atomic64_t cnt;
+	atomic64_t ns;
+	atomic64_t max_ns;
+};
+
+/*
+ * use of the preallocated scratch buffers.
+ * @hits: arrays taken from a scratch buffer.
+ * @empty: arrays allocated because every scratch buffer was in use.
+ * @oversize: arrays allocated because the transfer was too large.
+ */
+struct edma_scratch_stat {
+	atomic64_t hits;
+	atomic64_t empty;
+	atomic64_t oversize;
+};
+
+/* log2 slots of the edma histograms */
+#define EDMA_HIST_SLOTS		16
+
+/*
+ * histograms of the ddr transfers of one channel. Slot 0 counts values
+ * below 1 unit, slot n values in [2^(n-1), 2^n) units, the last slot the
+ * larger ones too. The slots are atomic, so the completion path updates
+ * them without a lock.
+ * @queue: submit to start, waiting for a channel and writing the link
+ *         table, in us.
+ * @xfer: start to done, in us.
+ * @total: submit to done, in us.
+ * @bytes: bytes of the transfers, in KB.
+ * @cnt: transfers done.
+ * @last_cnt: cnt at the last perf_timer tick.
+ * @tps: transfers done in the last second.
+ * @tps_max: the largest tps.
+ */
+struct edma_hist {
+	atomic64_t queue[EDMA_HIST_SLOTS];
+	atomic64_t xfer[EDMA_HIST_SLOTS];
+	atomic64_t total[EDMA_HIST_SLOTS];
+	atomic64_t bytes[EDMA_HIST_SLOTS];
+	atomic64_t cnt;
+	u64 last_cnt;
+	u32 tps;
+	u32 tps_max;
+};
+
 /*
  * The edma_t structure describes edma module.
  * @vedma_lt: edma link table virtual address.
@@ -83,17 +172,35 @@ struct err_chk {
  * @readback_w[4]: only is a flag, ensure link table has been write to ddr.
  * @rc2ep_cs[4]: record rc2ep channel status.
  * @ep2rc_cs[4]: record ep2rc channel status.
- * @ep2rc_sem: protect get/free edma channel, rc2ep direction.
- * @rc2ep_sem: protect get/free edma channel, ep2rc direction.
+ * @sched[2]: ddr channel scheduling, indexed by RC2EP/EP2RC.
  * @rc2ep_cs_lock: protect get/free edma channel, rc2ep direction.
  * @ep2rc_cs_lock: protect get/free edma channel, ep2rc direction.
  * @edma_perf: record edma performance data.
  * @perf_timer: it is a timer, calculate performance periodically.
  * @rc2ep_cfg_lock: protect setting rc2ep edma registers.
  * @ep2rc_cfg_lock: protect setting ep2rc edma registers.
- * @edma_irq_lock: used in edma interrupt handle.
+ * @edma_irq_lock: used in edma interrupt handle, and by the polling
+ *                 transfers which take the done status of their channel.
  * @tdev: record struct cb_tranx_t point.
  * @tc_info[2]: record tcache info.
+ * @chunk_size: max bytes of one link transfer, larger transfers are split
+ *              so that others can get the channel between the chunks.
+ * @reg_idr: rc buffers registered for edma, of all files, by handle.
+ * @reg_mutex: protect reg_idr.
+ * @efiles: edma state of the files, for priority and async jobs.
+ * @efile_mutex: protect efiles and the async jobs queued to them.
+ * @async_wait: woken up when an async job is done.
+ * @async_wq: workqueue which runs the async jobs.
+ * @scratch: the preallocated scratch buffers of the transfers.
+ * @scratch_free: the scratch buffers not in use.
+ * @scratch_lock: protect scratch_free.
+ * @scratch_stat: use of the scratch buffers.
+ * @poll_size: transfers up to poll_size bytes are polled, 0: none is.
+ * @poll_us: max time a transfer is polled before waiting for its irq.
+ * @lat[EDMA_LAT_NUM]: latency of the transfers, by completion mode.
+ * @hist[2][4]: histograms of the ddr transfers, by direction and channel.
+ * @pin_hist[2]: time to pin and map the rc pages of a request, in us.
+ * @debugfs: the edma_hist debugfs file.
  */
 struct edma_t {
 	void __iomem *vedma_lt;
@@ -105,8 +212,7 @@ struct edma_t {
 	u32 readback_w[4];
 	u8 rc2ep_cs[4];
 	u8 ep2rc_cs[4];
-	struct semaphore ep2rc_sem;
-	struct semaphore rc2ep_sem;
+	struct edma_chn_sched sched[2];
 	spinlock_t rc2ep_cs_lock;
 	spinlock_t ep2rc_cs_lock;
 	struct edma_perf edma_perf;
@@ -115,10 +221,33 @@ struct edma_t {
 	spinlock_t ep2rc_cfg_lock;
 	struct cb_tranx_t *tdev;
 	struct tcache_info tc_info[2];
+	u32 chunk_size;
 
 	struct err_chk rc2ep_err_chk;
 	struct err_chk ep2rc_err_chk;
 	int err_flag;
+
+	struct idr reg_idr;
+	struct mutex reg_mutex;
+
+	struct list_head efiles;
+	struct mutex efile_mutex;
+	wait_queue_head_t async_wait;
+	struct workqueue_struct *async_wq;
+
+	struct edma_scratch *scratch;
+	struct list_head scratch_free;
+	spinlock_t scratch_lock;
+	struct edma_scratch_stat scratch_stat;
+
+	spinlock_t edma_irq_lock;
+	u32 poll_size;
+	u32 poll_us;
+	struct edma_lat_stat lat[EDMA_LAT_NUM];
+
+	struct edma_hist hist[2][4];
+	atomic64_t pin_hist[2][EDMA_HIST_SLOTS];
+	struct dentry *debugfs;
 };
 
 long edma_ioctl(struct file *filp,
@@ -127,6 +256,9 @@ long edma_ioctl(struct file *filp,
 		   struct cb_tranx_t *tdev);
 int edma_init(struct cb_tranx_t *tdev);
 void edma_release(struct cb_tranx_t *tdev);
+void edma_close(struct cb_tranx_t *tdev, struct file *filp);
+__poll_t edma_poll(struct cb_tranx_t *tdev, struct file *filp,
+		   poll_table *wait);
 int edma_normal_rc2ep_xfer(struct trans_pcie_edma *edma_info,
 				  struct cb_tranx_t *tdev);
 irqreturn_t edma_isr(int irq, void *data);
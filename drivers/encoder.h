@@ -94,6 +94,7 @@ long vc8000e_ioctl(struct file *filp,
 int vc8000e_release(struct cb_tranx_t *tdev);
 int vc8000e_init(struct cb_tranx_t *tdev);
 void vce_close(struct cb_tranx_t *tdev, struct file *filp);
+int vce_core_slice(struct cb_tranx_t *tdev, struct file *filp);
 void vce_enable_clock(void *d, u32 core);
 irqreturn_t vce_isr(int irq, void *data);
 
@@ -106,6 +107,7 @@ long bigsea_ioctl(struct file *filp,
 		      unsigned long arg,
 		      struct cb_tranx_t *tdev);
 void bigsea_close(struct cb_tranx_t *tdev, struct file *filp);
+int bigsea_core_slice(struct cb_tranx_t *tdev, struct file *filp);
 void bigsea_enable_clock(void *data, int id);
 void check_bigsea_hwerr(struct cb_tranx_t *tdev, u32 status, int id);
 
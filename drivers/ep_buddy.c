@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Buddy allocator of ep ddr chunks.
+ * The chunks of a slice are split in blocks of 2^order chunks, aligned to
+ * their size from the slice start, and the free blocks are kept in one
+ * list per order. An allocation of n chunks takes the smallest free block
+ * which fits, splits it down to 2^order >= n chunks and gives back the
+ * unused tail, so it takes exactly n chunks. A freed range is split in
+ * aligned blocks again, each one merged with its free buddy. Allocation
+ * and free cost O(EP_BUDDY_MAX_ORDER^2) at most, whatever the occupancy.
+ */
+
+#include "ep_buddy.h"
+
+/* order of the largest aligned block at idx which fits in n chunks */
+static u32 ep_buddy_fit_order(u32 idx, u32 n)
+{
+	u32 order = 31 - __builtin_clz(n);
+
+	if (idx && (u32)__builtin_ctz(idx) < order)
+		order = __builtin_ctz(idx);
+	if (order > EP_BUDDY_MAX_ORDER)
+		order = EP_BUDDY_MAX_ORDER;
+
+	return order;
+}
+
+static void ep_buddy_list_add(struct ep_buddy *b, u32 idx, u32 order)
+{
+	struct ep_buddy_node *n = &b->nodes[idx];
+
+	n->state = EP_CHUNK_FREE;
+	n->order = order;
+	n->link.prev = EP_BUDDY_NIL;
+	n->link.next = b->head[order];
+	if (b->head[order] != EP_BUDDY_NIL)
+		b->nodes[b->head[order]].link.prev = idx;
+	b->head[order] = idx;
+	b->nr_free[order]++;
+}
+
+static void ep_buddy_list_del(struct ep_buddy *b, u32 idx)
+{
+	struct ep_buddy_node *n = &b->nodes[idx];
+
+	if (n->link.prev != EP_BUDDY_NIL)
+		b->nodes[n->link.prev].link.next = n->link.next;
+	else
+		b->head[n->order] = n->link.next;
+	if (n->link.next != EP_BUDDY_NIL)
+		b->nodes[n->link.next].link.prev = n->link.prev;
+	b->nr_free[n->order]--;
+	n->state = EP_CHUNK_NONE;
+}
+
+/* free the aligned block of 2^order chunks at idx, merged with its buddies */
+static void ep_buddy_free_block(struct ep_buddy *b, u32 idx, u32 order)
+{
+	struct ep_buddy_node *bn;
+	u32 buddy;
+
+	while (order < EP_BUDDY_MAX_ORDER) {
+		buddy = idx ^ (1U << order);
+		if (buddy >= b->chunks)
+			break;
+		bn = &b->nodes[buddy];
+		if (bn->state != EP_CHUNK_FREE || bn->order != order)
+			break;
+		ep_buddy_list_del(b, buddy);
+		idx &= ~(1U << order);
+		order++;
+	}
+	ep_buddy_list_add(b, idx, order);
+}
+
+/* free n chunks from idx, as the largest aligned blocks in the range */
+static void ep_buddy_free_range(struct ep_buddy *b, u32 idx, u32 n)
+{
+	u32 order;
+
+	while (n) {
+		order = ep_buddy_fit_order(idx, n);
+		ep_buddy_free_block(b, idx, order);
+		idx += 1U << order;
+		n -= 1U << order;
+	}
+}
+
+void ep_buddy_init(struct ep_buddy *b, struct ep_buddy_node *nodes,
+		   u32 chunks)
+{
+	u32 i;
+
+	b->nodes = nodes;
+	b->chunks = chunks;
+	b->free_chunks = chunks;
+	b->allocs = 0;
+	for (i = 0; i <= EP_BUDDY_MAX_ORDER; i++) {
+		b->head[i] = EP_BUDDY_NIL;
+		b->nr_free[i] = 0;
+	}
+	for (i = 0; i < chunks; i++)
+		nodes[i].state = EP_CHUNK_NONE;
+	ep_buddy_free_range(b, 0, chunks);
+}
+
+/*
+ * allocate n consecutive chunks for owner.
+ * return value: the first chunk, or EP_BUDDY_NIL if no free range fits.
+ */
+u32 ep_buddy_alloc(struct ep_buddy *b, u32 n, u32 owner)
+{
+	struct ep_buddy_node *node;
+	u32 order, o, idx;
+
+	if (!n || n > (1U << EP_BUDDY_MAX_ORDER))
+		return EP_BUDDY_NIL;
+
+	order = 31 - __builtin_clz(n);
+	if (n & (n - 1))
+		order++;
+	for (o = order; o <= EP_BUDDY_MAX_ORDER; o++) {
+		if (b->head[o] != EP_BUDDY_NIL)
+			break;
+	}
+	if (o > EP_BUDDY_MAX_ORDER)
+		return EP_BUDDY_NIL;
+
+	idx = b->head[o];
+	ep_buddy_list_del(b, idx);
+	while (o > order) {
+		o--;
+		ep_buddy_list_add(b, idx + (1U << o), o);
+	}
+	/* give back the tail the allocation doesn't use */
+	ep_buddy_free_range(b, idx + n, (1U << order) - n);
+
+	node = &b->nodes[idx];
+	node->state = EP_CHUNK_USED;
+	node->used.size = n;
+	node->used.owner = owner;
+	b->free_chunks -= n;
+	b->allocs++;
+
+	return idx;
+}
+
+/*
+ * free the allocation which starts at chunk idx.
+ * return value: its chunk count, 0 if idx isn't an allocation.
+ */
+int ep_buddy_free(struct ep_buddy *b, u32 idx)
+{
+	struct ep_buddy_node *node = ep_buddy_used(b, idx);
+	u32 n;
+
+	if (!node)
+		return 0;
+
+	n = node->used.size;
+	node->state = EP_CHUNK_NONE;
+	ep_buddy_free_range(b, idx, n);
+	b->free_chunks += n;
+	b->allocs--;
+
+	return n;
+}
+
+/* chunk count of the largest free block */
+u32 ep_buddy_largest(struct ep_buddy *b)
+{
+	int o;
+
+	for (o = EP_BUDDY_MAX_ORDER; o >= 0; o--) {
+		if (b->head[o] != EP_BUDDY_NIL)
+			return 1U << o;
+	}
+
+	return 0;
+}
+
+/*
+ * the first allocation from chunk idx, which is the first chunk of a block
+ * or of an allocation. It walks the blocks, not the chunks.
+ * return value: its first chunk, or EP_BUDDY_NIL.
+ */
+u32 ep_buddy_next_used(struct ep_buddy *b, u32 idx)
+{
+	struct ep_buddy_node *n;
+
+	while (idx < b->chunks) {
+		n = &b->nodes[idx];
+		if (n->state == EP_CHUNK_USED)
+			return idx;
+		if (n->state == EP_CHUNK_FREE)
+			idx += 1U << n->order;
+		else
+			idx++;
+	}
+
+	return EP_BUDDY_NIL;
+}
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Buddy allocator of the ep ddr chunks of one slice. It only manages chunk
+ * indexes, the caller maps them to bus addresses; it has no lock and
+ * allocates nothing, so memory.c and the userspace replay tool
+ * (mem_replay.c) build the same code.
+ */
+
+#ifndef _CB_EP_BUDDY_H_
+#define _CB_EP_BUDDY_H_
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+/* the largest buddy block is 2^EP_BUDDY_MAX_ORDER chunks, 256MB */
+#define EP_BUDDY_MAX_ORDER	16
+#define EP_BUDDY_NIL		0xffffffffU
+
+/* chunk state, only meaningful on the first chunk of a block */
+#define EP_CHUNK_NONE		0
+#define EP_CHUNK_FREE		1
+#define EP_CHUNK_USED		2
+
+/*
+ * one chunk. The first chunk of a free block links it in the free list of
+ * its order; the first chunk of an allocation records its size and owner.
+ */
+struct ep_buddy_node {
+	union {
+		struct {
+			u32 prev;
+			u32 next;
+		} link;
+		struct {
+			u32 size; /* chunk count */
+			u32 owner;
+		} used;
+	};
+	u8 order;
+	u8 state;
+};
+
+/*
+ * @nodes: one node per chunk, given by the caller.
+ * @chunks: chunk count of the slice.
+ * @free_chunks: chunks not allocated.
+ * @allocs: allocations in use.
+ * @head: free list of each order.
+ * @nr_free: free block count of each order.
+ */
+struct ep_buddy {
+	struct ep_buddy_node *nodes;
+	u32 chunks;
+	u32 free_chunks;
+	u32 allocs;
+	u32 head[EP_BUDDY_MAX_ORDER + 1];
+	u32 nr_free[EP_BUDDY_MAX_ORDER + 1];
+};
+
+void ep_buddy_init(struct ep_buddy *b, struct ep_buddy_node *nodes,
+		   u32 chunks);
+u32 ep_buddy_alloc(struct ep_buddy *b, u32 n, u32 owner);
+int ep_buddy_free(struct ep_buddy *b, u32 idx);
+u32 ep_buddy_largest(struct ep_buddy *b);
+u32 ep_buddy_next_used(struct ep_buddy *b, u32 idx);
+
+/* the allocation which starts at chunk idx, NULL if there is none */
+static inline struct ep_buddy_node *ep_buddy_used(struct ep_buddy *b,
+						  u32 idx)
+{
+	if (idx >= b->chunks || b->nodes[idx].state != EP_CHUNK_USED)
+		return NULL;
+	return &b->nodes[idx];
+}
+
+#endif /* _CB_EP_BUDDY_H_ */
@@ -0,0 +1,594 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2020 VeriSilicon Holdings Co., Ltd.
+ *
+ * Replay ep memory allocation traces on the buddy allocator of the driver
+ * (ep_buddy.c) and on a model of the former block allocator, to compare
+ * their failures, fragmentation and latency.
+ *
+ * A trace is recorded from the driver with print_level 3 (TR_DBG):
+ *     dmesg | grep "mem: trace" > trace.txt
+ * it has one line per event, any prefix before "mem: trace" is skipped:
+ *     mem: trace alloc id:<task> size:<bytes> addr:<addr>
+ *     mem: trace free id:<task> addr:<addr> size:<bytes>
+ *     mem: trace exit id:<task>
+ * "exit" is a freed task id, it frees all the memory of the task.
+ * The addresses only pair a free with its allocation.
+ *
+ * usage: mem_replay trace.txt       replay a trace, "-" for stdin
+ *        mem_replay -g tasks [seed] print a synthetic trace of a mix of
+ *                                   4K, 1080p and 480p decoding tasks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ep_buddy.h"
+
+#define CHUNK_SIZE 0x1000
+#define MAX_TASK 1024
+
+/* default slices of the driver, see memory.c */
+#define S0_START 0x4200000UL
+#define S0_END 0x70000000UL
+#define S1_START 0x84000000UL
+#define S1_END 0xF0000000UL
+
+enum { OP_ALLOC, OP_FREE, OP_EXIT };
+
+struct trace_op {
+    int op;
+    int task;
+    u32 size;
+    u64 addr; /* address in the trace */
+};
+
+/* an allocator to compare, addr is the replayed address */
+struct allocator {
+    const char *name;
+    void *(*create)(void);
+    void (*destroy)(void *ctx);
+    int (*alloc)(void *ctx, int task, u32 size, u64 *addr);
+    int (*free)(void *ctx, int task, u64 addr);
+    void (*exit)(void *ctx, int task);
+    /* free bytes, and the largest allocation which can succeed */
+    void (*stat)(void *ctx, u64 *free_bytes, u64 *max_alloc);
+};
+
+static const u64 slice_start[2] = { S0_START, S1_START };
+static const u64 slice_end[2] = { S0_END, S1_END };
+
+/* ---- buddy allocator of the driver ---- */
+
+struct buddy_ctx {
+    struct ep_buddy b[2];
+    struct ep_buddy_node *nodes;
+};
+
+static void *buddy_create(void)
+{
+    struct buddy_ctx *c = calloc(1, sizeof(*c));
+    u32 n0 = (S0_END - S0_START) / CHUNK_SIZE;
+    u32 n1 = (S1_END - S1_START) / CHUNK_SIZE;
+
+    c->nodes = calloc(n0 + n1, sizeof(*c->nodes));
+    ep_buddy_init(&c->b[0], c->nodes, n0);
+    ep_buddy_init(&c->b[1], c->nodes + n0, n1);
+    return c;
+}
+
+static void buddy_destroy(void *ctx)
+{
+    struct buddy_ctx *c = ctx;
+
+    free(c->nodes);
+    free(c);
+}
+
+static int buddy_alloc(void *ctx, int task, u32 size, u64 *addr)
+{
+    struct buddy_ctx *c = ctx;
+    u32 n = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    int first, s, i;
+    u32 idx;
+
+    /* the same balance as alloc_mem_ep() */
+    first = c->b[0].free_chunks >= c->b[1].free_chunks ? 0 : 1;
+    for (i = 0; i < 2; i++) {
+        s = i ? !first : first;
+        idx = ep_buddy_alloc(&c->b[s], n, task);
+        if (idx != EP_BUDDY_NIL) {
+            *addr = slice_start[s] + (u64)idx * CHUNK_SIZE;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int buddy_free(void *ctx, int task, u64 addr)
+{
+    struct buddy_ctx *c = ctx;
+    int s = addr >= S1_START;
+    u32 idx = (addr - slice_start[s]) / CHUNK_SIZE;
+    struct ep_buddy_node *node = ep_buddy_used(&c->b[s], idx);
+
+    if (!node || node->used.owner != (u32)task)
+        return -1;
+    ep_buddy_free(&c->b[s], idx);
+    return 0;
+}
+
+static void buddy_exit(void *ctx, int task)
+{
+    struct buddy_ctx *c = ctx;
+    u32 i, next;
+    int s;
+
+    for (s = 0; s < 2; s++) {
+        i = ep_buddy_next_used(&c->b[s], 0);
+        while (i != EP_BUDDY_NIL) {
+            next = ep_buddy_next_used(&c->b[s],
+                                      i + c->b[s].nodes[i].used.size);
+            if (c->b[s].nodes[i].used.owner == (u32)task)
+                ep_buddy_free(&c->b[s], i);
+            i = next;
+        }
+    }
+}
+
+static void buddy_stat(void *ctx, u64 *free_bytes, u64 *max_alloc)
+{
+    struct buddy_ctx *c = ctx;
+    u64 l0 = ep_buddy_largest(&c->b[0]), l1 = ep_buddy_largest(&c->b[1]);
+
+    *free_bytes = (u64)(c->b[0].free_chunks + c->b[1].free_chunks) *
+                  CHUNK_SIZE;
+    *max_alloc = (l0 > l1 ? l0 : l1) * CHUNK_SIZE;
+}
+
+/* ---- model of the former block allocator ---- */
+
+#define BLOCK_CNT 47
+
+struct block {
+    u64 start;
+    int task;
+    u32 chunks;
+    u32 free_chunks;
+    u32 *rsv; /* chunks reserved from each chunk, 0 if it's free */
+};
+
+struct block_ctx {
+    struct block bk[2][BLOCK_CNT];
+    u64 rev_size[2];
+};
+
+static void *block_create(void)
+{
+    struct block_ctx *c = calloc(1, sizeof(*c));
+    u64 blk_size;
+    int s, i;
+
+    for (s = 0; s < 2; s++) {
+        blk_size = ((slice_end[s] - slice_start[s]) / BLOCK_CNT) &
+                   ~(u64)(CHUNK_SIZE - 1);
+        for (i = 0; i < BLOCK_CNT; i++) {
+            c->bk[s][i].start = slice_start[s] + blk_size * i;
+            c->bk[s][i].chunks = blk_size / CHUNK_SIZE;
+            c->bk[s][i].free_chunks = c->bk[s][i].chunks;
+            c->bk[s][i].rsv = calloc(c->bk[s][i].chunks, sizeof(u32));
+        }
+    }
+    return c;
+}
+
+static void block_destroy(void *ctx)
+{
+    struct block_ctx *c = ctx;
+    int s, i;
+
+    for (s = 0; s < 2; s++)
+        for (i = 0; i < BLOCK_CNT; i++)
+            free(c->bk[s][i].rsv);
+    free(c);
+}
+
+/* first fit in a block, as get_chunks() did */
+static int block_get_chunks(struct block_ctx *c, int s, struct block *b,
+                            u32 n, u64 *addr)
+{
+    u32 i = 0, j;
+    int skip;
+
+    while (i < b->chunks) {
+        if (b->rsv[i]) {
+            i += b->rsv[i];
+            continue;
+        }
+        if (i + n > b->chunks)
+            break;
+        skip = 0;
+        for (j = i; j < i + n; j++) {
+            if (b->rsv[j]) {
+                skip = 1;
+                i = j + b->rsv[j];
+                break;
+            }
+        }
+        if (!skip) {
+            b->rsv[i] = n;
+            b->free_chunks -= n;
+            c->rev_size[s] += (u64)n * CHUNK_SIZE;
+            *addr = b->start + (u64)i * CHUNK_SIZE;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int block_alloc_in_slice(struct block_ctx *c, int s, int task, u32 n,
+                                u64 *addr, int new_block)
+{
+    int i;
+
+    for (i = 0; i < BLOCK_CNT; i++) {
+        if (c->bk[s][i].task != (new_block ? 0 : task))
+            continue;
+        if (!block_get_chunks(c, s, &c->bk[s][i], n, addr)) {
+            c->bk[s][i].task = task;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int block_alloc(void *ctx, int task, u32 size, u64 *addr)
+{
+    struct block_ctx *c = ctx;
+    u32 n = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    int first = c->rev_size[0] <= c->rev_size[1] ? 0 : 1;
+
+    /* its own blocks first, then a new block, as alloc_mem_ep() did */
+    if (!block_alloc_in_slice(c, first, task, n, addr, 0) ||
+        !block_alloc_in_slice(c, !first, task, n, addr, 0) ||
+        !block_alloc_in_slice(c, first, task, n, addr, 1) ||
+        !block_alloc_in_slice(c, !first, task, n, addr, 1))
+        return 0;
+    return -1;
+}
+
+static int block_free(void *ctx, int task, u64 addr)
+{
+    struct block_ctx *c = ctx;
+    int s = addr >= S1_START;
+    struct block *b = NULL;
+    u32 i;
+
+    for (i = 0; i < BLOCK_CNT; i++) {
+        if (addr >= c->bk[s][i].start &&
+            addr < c->bk[s][i].start + (u64)c->bk[s][i].chunks * CHUNK_SIZE)
+            b = &c->bk[s][i];
+    }
+    if (!b || b->task != task)
+        return -1;
+
+    /* free_mem_ep() looked the chunk up linearly */
+    for (i = 0; i < b->chunks; i++) {
+        if (b->start + (u64)i * CHUNK_SIZE == addr)
+            break;
+    }
+    if (i == b->chunks || !b->rsv[i])
+        return -1;
+    c->rev_size[s] -= (u64)b->rsv[i] * CHUNK_SIZE;
+    b->free_chunks += b->rsv[i];
+    b->rsv[i] = 0;
+    if (b->free_chunks == b->chunks)
+        b->task = 0;
+    return 0;
+}
+
+static void block_exit(void *ctx, int task)
+{
+    struct block_ctx *c = ctx;
+    struct block *b;
+    int s, i;
+    u32 j;
+
+    for (s = 0; s < 2; s++) {
+        for (i = 0; i < BLOCK_CNT; i++) {
+            b = &c->bk[s][i];
+            if (b->task != task)
+                continue;
+            for (j = 0; j < b->chunks; j++) {
+                if (b->rsv[j]) {
+                    c->rev_size[s] -= (u64)b->rsv[j] * CHUNK_SIZE;
+                    b->rsv[j] = 0;
+                }
+            }
+            b->free_chunks = b->chunks;
+            b->task = 0;
+        }
+    }
+}
+
+static void block_stat(void *ctx, u64 *free_bytes, u64 *max_alloc)
+{
+    struct block_ctx *c = ctx;
+    int s, i;
+
+    *free_bytes = 0;
+    *max_alloc = 0;
+    for (s = 0; s < 2; s++) {
+        for (i = 0; i < BLOCK_CNT; i++) {
+            *free_bytes += (u64)c->bk[s][i].free_chunks * CHUNK_SIZE;
+            /* a new task can only take a whole free block */
+            if (!c->bk[s][i].task)
+                *max_alloc = (u64)c->bk[s][i].chunks * CHUNK_SIZE;
+        }
+    }
+}
+
+static const struct allocator allocators[] = {
+    { "block", block_create, block_destroy, block_alloc, block_free,
+      block_exit, block_stat },
+    { "buddy", buddy_create, buddy_destroy, buddy_alloc, buddy_free,
+      buddy_exit, buddy_stat },
+};
+
+/* ---- trace ---- */
+
+static struct trace_op *ops;
+static int op_cnt, op_max;
+
+static void add_op(int op, int task, u32 size, u64 addr)
+{
+    if (op_cnt == op_max) {
+        op_max = op_max ? op_max * 2 : 4096;
+        ops = realloc(ops, op_max * sizeof(*ops));
+        if (!ops) {
+            printf("out of memory\n");
+            exit(1);
+        }
+    }
+    ops[op_cnt].op = op;
+    ops[op_cnt].task = task;
+    ops[op_cnt].size = size;
+    ops[op_cnt].addr = addr;
+    op_cnt++;
+}
+
+static int load_trace(FILE *fp)
+{
+    char line[512];
+    char *p;
+    int task;
+    unsigned int size;
+    unsigned long long addr;
+
+    while (fgets(line, sizeof(line), fp)) {
+        p = strstr(line, "mem: trace ");
+        if (!p)
+            continue;
+        p += strlen("mem: trace ");
+        if (sscanf(p, "alloc id:%d size:%x addr:%llx", &task, &size,
+                   &addr) == 3)
+            add_op(OP_ALLOC, task, size, addr);
+        else if (sscanf(p, "free id:%d addr:%llx", &task, &addr) == 2)
+            add_op(OP_FREE, task, 0, addr);
+        else if (sscanf(p, "exit id:%d", &task) == 1)
+            add_op(OP_EXIT, task, 0, 0);
+    }
+    return op_cnt;
+}
+
+/* replayed address of each trace allocation, 0 if it failed */
+struct live {
+    u64 addr;
+    u64 new_addr;
+    u64 size; /* chunk aligned */
+    int task;
+    int used;
+};
+
+static struct live *live_find(struct live *tab, int size, u64 addr)
+{
+    u32 h = (u32)((addr >> 12) * 2654435761u) % size;
+
+    while (tab[h].used && tab[h].addr != addr)
+        h = (h + 1) % size;
+    return &tab[h];
+}
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void replay(const struct allocator *a)
+{
+    void *ctx = a->create();
+    int tab_size = op_cnt * 2 + 1;
+    struct live *tab = calloc(tab_size, sizeof(*tab));
+    struct live *l;
+    u64 t, ns, alloc_ns = 0, alloc_max = 0, free_ns = 0, free_max = 0;
+    u64 used = 0, peak = 0, fail_bytes = 0, free_bytes, max_alloc;
+    u64 first_fail_free = 0, first_fail_max = 0;
+    int allocs = 0, frees = 0, fails = 0, i, j, ret;
+
+    for (i = 0; i < op_cnt; i++) {
+        struct trace_op *op = &ops[i];
+
+        switch (op->op) {
+        case OP_ALLOC:
+            l = live_find(tab, tab_size, op->addr);
+            t = now_ns();
+            ret = a->alloc(ctx, op->task, op->size, &l->new_addr);
+            ns = now_ns() - t;
+            alloc_ns += ns;
+            alloc_max = ns > alloc_max ? ns : alloc_max;
+            allocs++;
+            l->addr = op->addr;
+            l->task = op->task;
+            l->used = 1;
+            if (ret) {
+                l->new_addr = 0;
+                if (!fails++)
+                    a->stat(ctx, &first_fail_free, &first_fail_max);
+                fail_bytes += op->size;
+                break;
+            }
+            l->size = (op->size + CHUNK_SIZE - 1) & ~(u64)(CHUNK_SIZE - 1);
+            used += l->size;
+            peak = used > peak ? used : peak;
+            break;
+        case OP_FREE:
+            l = live_find(tab, tab_size, op->addr);
+            if (!l->used || !l->new_addr)
+                break;
+            t = now_ns();
+            ret = a->free(ctx, l->task, l->new_addr);
+            ns = now_ns() - t;
+            free_ns += ns;
+            free_max = ns > free_max ? ns : free_max;
+            frees++;
+            if (ret)
+                printf("%s: free of 0x%llx failed\n", a->name,
+                       (unsigned long long)l->new_addr);
+            /* a freed address can be allocated again in the trace */
+            l->new_addr = 0;
+            used -= l->size;
+            break;
+        case OP_EXIT:
+            a->exit(ctx, op->task);
+            for (j = 0; j < tab_size; j++) {
+                if (tab[j].used && tab[j].new_addr &&
+                    tab[j].task == op->task) {
+                    tab[j].new_addr = 0;
+                    used -= tab[j].size;
+                }
+            }
+            break;
+        }
+    }
+
+    a->stat(ctx, &free_bytes, &max_alloc);
+    printf("%s:\n", a->name);
+    printf("  allocs:%d failed:%d (%llu MB) frees:%d peak used:%llu MB\n",
+           allocs, fails, (unsigned long long)(fail_bytes >> 20), frees,
+           (unsigned long long)(peak >> 20));
+    printf("  alloc avg:%llu ns max:%llu ns, free avg:%llu ns max:%llu ns\n",
+           (unsigned long long)(allocs ? alloc_ns / allocs : 0),
+           (unsigned long long)alloc_max,
+           (unsigned long long)(frees ? free_ns / frees : 0),
+           (unsigned long long)free_max);
+    if (fails)
+        printf("  at the first failure: %llu MB free, largest alloc %llu MB\n",
+               (unsigned long long)(first_fail_free >> 20),
+               (unsigned long long)(first_fail_max >> 20));
+    printf("  at the end: %llu MB free, largest alloc %llu MB\n",
+           (unsigned long long)(free_bytes >> 20),
+           (unsigned long long)(max_alloc >> 20));
+
+    free(tab);
+    a->destroy(ctx);
+}
+
+/* ---- synthetic trace ---- */
+
+struct task_kind {
+    const char *name;
+    u32 frame; /* dpb frame size */
+    int frames;
+    u32 stream; /* stream buffer size */
+};
+
+static const struct task_kind kinds[] = {
+    { "4K", 3840 * 2160 * 3, 10, 8 << 20 },
+    { "1080p", 1920 * 1088 * 3 / 2, 8, 2 << 20 },
+    { "480p", 720 * 480 * 3 / 2, 6, 1 << 20 },
+};
+
+static void gen_trace(int tasks, unsigned int seed)
+{
+    u64 addr = 0x1000;
+    u64 *bufs = calloc(MAX_TASK * 32, sizeof(u64));
+    int live[MAX_TASK] = { 0 };
+    int id, i, n, round;
+    const struct task_kind *k;
+
+    srand(seed);
+    if (tasks >= MAX_TASK)
+        tasks = MAX_TASK - 1;
+    /* tasks start, churn their pp outputs and restart in random order */
+    for (round = 0; round < tasks * 8; round++) {
+        id = rand() % tasks + 1;
+        k = &kinds[rand() % 3];
+        if (live[id]) {
+            if (rand() % 4) {
+                /* free and reallocate a pp output */
+                i = rand() % live[id];
+                printf("mem: trace free id:%d addr:0x%llx\n", id,
+                       (unsigned long long)bufs[id * 32 + i]);
+                bufs[id * 32 + i] = addr;
+                printf("mem: trace alloc id:%d size:0x%x addr:0x%llx\n",
+                       id, k->frame, (unsigned long long)addr);
+                addr += 0x1000;
+            } else {
+                printf("mem: trace exit id:%d\n", id);
+                live[id] = 0;
+            }
+            continue;
+        }
+        n = k->frames + rand() % 8;
+        for (i = 0; i < n && i < 32; i++) {
+            bufs[id * 32 + i] = addr;
+            printf("mem: trace alloc id:%d size:0x%x addr:0x%llx\n", id,
+                   i ? k->frame : k->stream, (unsigned long long)addr);
+            addr += 0x1000;
+        }
+        live[id] = i;
+    }
+    free(bufs);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fp;
+    unsigned int i;
+
+    if (argc < 2) {
+        printf("usage: %s trace.txt|-\n", argv[0]);
+        printf("       %s -g tasks [seed]\n", argv[0]);
+        return -1;
+    }
+
+    if (!strcmp(argv[1], "-g")) {
+        if (argc < 3) {
+            printf("need the task count\n");
+            return -1;
+        }
+        gen_trace(atoi(argv[2]), argc > 3 ? strtoul(argv[3], 0, 0) : 1);
+        return 0;
+    }
+
+    fp = strcmp(argv[1], "-") ? fopen(argv[1], "r") : stdin;
+    if (!fp) {
+        printf("Failed to open %s\n", argv[1]);
+        return -1;
+    }
+    load_trace(fp);
+    if (fp != stdin)
+        fclose(fp);
+    printf("%d events\n", op_cnt);
+
+    for (i = 0; i < sizeof(allocators) / sizeof(allocators[0]); i++)
+        replay(&allocators[i]);
+
+    free(ops);
+    return 0;
+}
@@ -7,25 +7,29 @@
  * memory space. Every slice have 2GB DDR memory,
  * but low 64MB have same address mapping with Tcache, and high 256MB
  * will be used by DDR ECC, so the valid size that codec can use is 1728MB.
- * One slice memory will be divide into 16 blocks with same size(108MB),
- * and one block contain 27684 chunks, one chunk is 4KB. Block is the
- * minimum unit for video task, every block is only used by a task, so
- * one task will take one block at one time. Next allocation, task will
- * get free memory form itself block firstly, if no, it will get a new
- * block. When a block is not used, it will be freed. One block can’t
- * shared by different tasks.
- * When allocate memory from a block, it also check the first chunk(chunk
- * index is 0), if not be used, reserve it, and record reserved chunk
- * count in the chunk 0, so consecutive chunks will be reserved for this
- * allocation; next allocation, check chunk 0, it is used, get the reserved
- * chunk size(N), then check the chunk which index is N, if not be used,
- * reserved it, or else continue to check next, until get valid chunks,
- * if not, get a new block.
+ * The memory of a slice is divided in 4KB chunks, managed by a buddy
+ * allocator (ep_buddy.c): an allocation takes exactly the chunks it needs
+ * from the smallest free block which fits, and a free merges the chunks
+ * with their free buddies, both in O(log n) whatever the occupancy.
+ * The first chunk of an allocation records its size and its task id, so
+ * a free checks the owner. The allocations of a task are also linked in
+ * the list of the task, so freeing a task id frees its memory in a time
+ * proportional to its allocation count only.
  *
  * the memory in slice0 and slice1 will do a simple balance by used size,
  * when the memory size which is allocated from slice0 is greater than
  * slice1, then next time memory will be allocated from slice1; and the
  * allocation from slice0 is the other way round.
+ * An allocation can ask for a slice instead (enum TRANS_MEM_SLICE, with
+ * CB_TRANX_MEM_ALLOC_SLICE, or for all allocations of the task with
+ * CB_TRANX_MEM_SET_SLICE), so the buffers of a task are in the slice of
+ * the cores which access them. By default it follows the slice of the
+ * decoder or encoder core of the task.
+ *
+ * The memory of each task is accounted, shown in the mem_tasks debugfs
+ * file, and can be limited by a quota: an allocation over it fails with
+ * -EDQUOT. The quota is imposed by a privileged scheduler, a task can only
+ * lower its own.
  */
 
 #include <linux/module.h>
@@ -33,16 +37,23 @@
 #include <linux/pci.h>
 #include <linux/pagemap.h>
 #include <linux/vmalloc.h>
+#include <linux/slab.h>
+#include <linux/rbtree.h>
+#include <linux/idr.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/capability.h>
 
 #include "common.h"
 #include "memory.h"
+#include "ep_buddy.h"
 #include "transcoder.h"
+#include "vc8000d.h"
+#include "encoder.h"
 
 /* aggress as follows: the first slice is slice_0, another is slice_1 */
-#define MAX_TASK_NUM	128
 #define MIN_TASK_ID		1
-#define S0_BLOCK_CNT	47
-#define S1_BLOCK_CNT	47
+#define MAX_TASK_LIMIT	65535
 #define CHUNK_SIZE	0x1000
 
 #define SLICE0_INDEX	0
@@ -76,25 +87,66 @@ module_param(method, uint, 0644);
 MODULE_PARM_DESC(method,
 	"allocate mem method,0:use s0,1:use s1,2:balance s0/s1;default is 2");
 
-/* taskid status */
-#define ID_BUSY		0x1
-#define ID_FREE		0x0
+/* task ids are allocated on demand, from 1 to max_task_num */
+unsigned int max_task_num = 1024;
+
+module_param(max_task_num, uint, 0444);
+MODULE_PARM_DESC(max_task_num,
+	"max task id count of a device, up to 65535; default is 1024");
+
+/* default memory quota of a task, CB_TRANX_MEM_SET_QUOTA changes it */
+unsigned int task_quota;
+
+module_param(task_quota, uint, 0644);
+MODULE_PARM_DESC(task_quota,
+	"memory quota of a new task in MB, 0:no quota; default is 0");
 
-/* memory chunk information */
-struct hlina_chunk {
-	u64 bus_add; /* this chunk start physical address */
-	u32 ck_rsv; /* indicate this chunk whether be used or not */
+/* memory of one slice, from start to end */
+struct mem_slice {
+	unsigned long start;
+	unsigned long end;
+	struct ep_buddy buddy;
 };
 
-/* memory block information */
-struct mem_block {
-	u32 index; /* block index */
-	u64 start_addr; /*  the block start address; */
-	int task_id; /* this block be used by task_id */
-	u32 block_size; /* block size; */
-	u32 chunks; /* total chunk count */
-	u32 free_chunks; /* the chunks not used */
-	struct hlina_chunk *chk_inf;
+/* an allocation, in the list and the address tree of its task */
+struct mem_alloc {
+	struct list_head list;
+	struct rb_node node;
+	unsigned long addr;
+	u32 idx; /* first chunk in the slice */
+	u32 size; /* bytes, chunk aligned */
+	int slice;
+};
+
+/*
+ * a task id, allocated with the id. It's only freed with mem_mutex_ep
+ * held, so it can be used while holding the mutex.
+ * @filp: the file which got the id.
+ * @allocs: its allocations, protected by mem_mutex_ep.
+ * @addrs: the same allocations by address, to find one to free.
+ * @close: in the tasks to free of cb_mem_close().
+ * The accounting, in chunk aligned bytes, is protected by mem_mutex_ep:
+ * @used, @peak: current and peak memory.
+ * @alloc_cnt: allocation count.
+ * @largest: largest allocation.
+ * @quota: allocations over it fail, 0 for no quota.
+ * @quota_fail: allocations failed for the quota.
+ */
+struct mem_task {
+	int id;
+	u8 slice; /* enum TRANS_MEM_SLICE, the default of its allocations */
+	s8 core_slice; /* slice of the core last seen reserved, -1 if none */
+	struct file *filp;
+	struct list_head allocs;
+	struct rb_root addrs;
+	struct list_head close;
+
+	u64 used;
+	u64 peak;
+	u32 alloc_cnt;
+	u32 largest;
+	u64 quota;
+	u32 quota_fail;
 };
 
 /* The memory_t structure describes memory module */
@@ -103,321 +155,266 @@ struct memory_t {
 	struct mutex mem_mutex_ep;
 	struct mutex mem_mutex_rc;
 
-	struct mem_block *mem_s0_bk; /* memory slice0 block*/
-	struct mem_block *mem_s1_bk; /* memory slice1 block*/
-	u32 s0_rev_size; /* slice0_reserved_size */
-	u32 s1_rev_size; /* slice1_reserved_size */
-
+	struct mem_slice slice[2];
+	/* chunk nodes of both slices */
+	struct ep_buddy_node *nodes;
+	/*
+	 * allocations which asked for slice s: in slice s, and in the other
+	 * slice because s was full.
+	 */
+	u64 affine[2];
+	u64 cross[2];
+	u64 quota_fail; /* allocations failed for a quota */
+	struct dentry *debugfs; /* mem_tasks file */
+
+	/* protect task_idr and task_cnt */
 	spinlock_t taskid_lock;
-	int id_st[MAX_TASK_NUM + 1]; /* task id status */
-	struct file *id_filp[MAX_TASK_NUM + 1]; /* save owner who use the id */
+	struct idr task_idr; /* struct mem_task of each task id */
+	int task_cnt;
 };
 
-/* get a not used task id, maximun support 32 task, so total count of
- * task id is 32, from 1 to 32.
- */
-static int get_task_id(struct memory_t *tmem, struct file *filp)
+/* used bytes of slice s */
+static inline unsigned long slice_used(struct memory_t *tmem, int s)
+{
+	struct ep_buddy *b = &tmem->slice[s].buddy;
+
+	return (unsigned long)(b->chunks - b->free_chunks) * CHUNK_SIZE;
+}
+
+/* the task of an id, NULL if the id isn't used */
+static struct mem_task *find_task(struct memory_t *tmem, int id)
 {
-	int i;
+	struct mem_task *task;
 
+	if (id < MIN_TASK_ID)
+		return NULL;
 	spin_lock(&tmem->taskid_lock);
-	for (i = MIN_TASK_ID; i <= MAX_TASK_NUM; i++) {
-		if (tmem->id_st[i] == ID_FREE) {
-			tmem->id_st[i] = ID_BUSY;
-			tmem->id_filp[i] = filp;
-			break;
-		}
-	}
+	task = idr_find(&tmem->task_idr, id);
 	spin_unlock(&tmem->taskid_lock);
 
-	return (i <= MAX_TASK_NUM) ? i : -1;
+	return task;
 }
 
-/* if free a task id, will free all corresponding memory. */
-static void free_task_id(struct memory_t *tmem, int id)
+/* get a not used task id, from MIN_TASK_ID to max_task_num. */
+static int get_task_id(struct memory_t *tmem, struct file *filp)
 {
-	int i, j;
-	struct mem_block *sbk;
-	int mem_leak_flag_0 = 0;
-	int mem_leak_flag_1 = 0;
+	struct mem_task *task;
+	int id;
 
-	mutex_lock(&tmem->mem_mutex_ep);
+	task = kzalloc(sizeof(*task), GFP_KERNEL);
+	if (!task)
+		return -1;
+	task->filp = filp;
+	task->core_slice = -1;
+	task->quota = (u64)task_quota << 20;
+	INIT_LIST_HEAD(&task->allocs);
+	task->addrs = RB_ROOT;
 
+	idr_preload(GFP_KERNEL);
 	spin_lock(&tmem->taskid_lock);
-	tmem->id_st[id] = ID_FREE;
-	tmem->id_filp[id] = NULL;
-
-	for (i = 0; i < S0_BLOCK_CNT; i++) {
-		if (tmem->mem_s0_bk[i].task_id == id) {
-			sbk = &(tmem->mem_s0_bk[i]);
-			for (j = 0; j < sbk->chunks; j++) {
-				if (sbk->chk_inf[j].ck_rsv) {
-					mem_leak_flag_0++;
-					tmem->s0_rev_size -=
-					sbk->chk_inf[j].ck_rsv * CHUNK_SIZE;
-					sbk->chk_inf[j].ck_rsv = 0;
-					trans_dbg(tmem->tdev, TR_DBG,
-						"mem: mem leak,s0,blk:%d,id:%d,add=0x%llx\n",
-						i, id, sbk->chk_inf[j].bus_add);
-				}
-			}
-			sbk->task_id = 0;
-		}
+	id = idr_alloc(&tmem->task_idr, task, MIN_TASK_ID, max_task_num + 1,
+		       GFP_NOWAIT);
+	if (id >= 0) {
+		task->id = id;
+		tmem->task_cnt++;
 	}
-	for (i = 0; i < S1_BLOCK_CNT; i++) {
-		if (tmem->mem_s1_bk[i].task_id == id) {
-			sbk = &(tmem->mem_s1_bk[i]);
-			for (j = 0; j < sbk->chunks; j++) {
-				if (sbk->chk_inf[j].ck_rsv) {
-					mem_leak_flag_1++;
-					tmem->s1_rev_size -=
-					sbk->chk_inf[j].ck_rsv * CHUNK_SIZE;
-					sbk->chk_inf[j].ck_rsv = 0;
-					trans_dbg(tmem->tdev, TR_DBG,
-						"mem: mem leak,s1,blk:%d,id:%d,add=0x%llx\n",
-						i, id, sbk->chk_inf[j].bus_add);
-				}
-			}
-			sbk->task_id = 0;
-		}
-	}
-	if (mem_leak_flag_0)
-		trans_dbg(tmem->tdev, TR_NOTICE, "mem: mem leak in slice_0\n");
-	if (mem_leak_flag_1)
-		trans_dbg(tmem->tdev, TR_NOTICE, "mem: mem leak in slice_1\n");
-
 	spin_unlock(&tmem->taskid_lock);
-	mutex_unlock(&tmem->mem_mutex_ep);
-}
+	idr_preload_end();
 
-void cb_mem_close(struct cb_tranx_t *tdev, struct file *filp)
-{
-	int id;
-	struct memory_t *tmem = tdev->modules[TR_MODULE_MEMORY];
-
-	for (id = MIN_TASK_ID; id <= MAX_TASK_NUM; id++) {
-		if (tmem->id_filp[id] == filp) {
-			trans_dbg(tdev, TR_DBG, "%s id:%d\n", __func__, id);
-			free_task_id(tmem, id);
-		}
+	if (id < 0) {
+		kfree(task);
+		return -1;
 	}
+
+	return id;
 }
 
-/* Cycle through the buffers we have, give the first free one */
-static int get_chunks(int slice, int block_index, unsigned long *busaddr,
-			 unsigned int size, int task_id, struct memory_t *tmem)
+/*
+ * if free a task id, will free all corresponding memory.
+ * Only the file which got the id can free it.
+ * The id is released after its memory, so a new owner of the id can't
+ * allocate before; taskid_lock is only held to release it.
+ */
+static int free_task_id(struct memory_t *tmem, int id, struct file *filp)
 {
-	int i, j;
-	int ret = 0;
-	int bi = block_index;
-	struct mem_block *mb;
-	unsigned int skip_chunks = 0;
-	/* calculate how many chunks we need;round up to chunk boundary */
-	unsigned int alloc_chunks = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	struct mem_task *task;
+	struct mem_alloc *ma, *tmp;
+	int leak[2] = {0, 0};
+	int s;
 
-	if (slice > 1) {
-		trans_dbg(tmem->tdev, TR_ERR,
-			"mem: %s, slice id:%d is error\n", __func__, slice);
+	mutex_lock(&tmem->mem_mutex_ep);
+	task = find_task(tmem, id);
+	if (!task || task->filp != filp) {
+		mutex_unlock(&tmem->mem_mutex_ep);
 		return -EFAULT;
 	}
 
-	if (slice == 0)
-		mb = tmem->mem_s0_bk;
-	else
-		mb = tmem->mem_s1_bk;
-
-	*busaddr = 0;
-	/* run through the chunk table */
-	for (i = 0; i < mb[bi].chunks;) {
-		skip_chunks = 0;
-		/* if this chunk is available */
-		if (!mb[bi].chk_inf[i].ck_rsv) {
-			/* check that there is enough memory left */
-			if (i + alloc_chunks > mb[bi].chunks)
-				break;
-
-			/*
-			 * check that there is enough consecutive
-			 * chunks available.
-			 */
-			for (j = i; j < i + alloc_chunks; j++) {
-				if (mb[bi].chk_inf[j].ck_rsv) {
-					skip_chunks = 1;
-					/* skip the used chunks */
-					i = j + mb[bi].chk_inf[j].ck_rsv;
-					break;
-				}
-			}
-
-			/* if enough free memory found */
-			if (!skip_chunks) {
-				*busaddr = mb[bi].chk_inf[i].bus_add;
-				mb[bi].chk_inf[i].ck_rsv = alloc_chunks;
-				mb[bi].free_chunks -= alloc_chunks;
-
-				if (slice == 0)
-					tmem->s0_rev_size +=
-						alloc_chunks * CHUNK_SIZE;
-				else
-					tmem->s1_rev_size +=
-						alloc_chunks * CHUNK_SIZE;
-
-				break;
-			}
-		} else {
-			/* skip the used chunks */
-			i += mb[bi].chk_inf[i].ck_rsv;
-		}
+	list_for_each_entry_safe(ma, tmp, &task->allocs, list) {
+		trans_dbg(tmem->tdev, TR_DBG,
+			"mem: mem leak,s%d,id:%d,add=0x%lx\n",
+			ma->slice, id, ma->addr);
+		ep_buddy_free(&tmem->slice[ma->slice].buddy, ma->idx);
+		leak[ma->slice]++;
+		list_del(&ma->list);
+		kfree(ma);
 	}
+	for (s = SLICE0_INDEX; s <= SLICE1_INDEX; s++) {
+		if (leak[s])
+			trans_dbg(tmem->tdev, TR_NOTICE,
+				  "mem: mem leak in slice_%d\n", s);
+	}
+	trans_dbg(tmem->tdev, TR_DBG, "mem: trace exit id:%d\n", id);
 
-	if (*busaddr == 0) {
-		trans_dbg(tmem->tdev, TR_DBG,
-			"mem: get chunks failed in s:%d,block:%d,size:0x%x\n",
-			slice, bi, size);
-		ret = -EFAULT;
-	} else
-		trans_dbg(tmem->tdev, TR_DBG,
-			"mem: alloc ep s:%d block:%d,addr:0x%lx size:0x%x,task_id:%d\n",
-			slice, bi, *busaddr, size, task_id);
+	spin_lock(&tmem->taskid_lock);
+	idr_remove(&tmem->task_idr, id);
+	tmem->task_cnt--;
+	spin_unlock(&tmem->taskid_lock);
+	mutex_unlock(&tmem->mem_mutex_ep);
 
-	return ret;
+	kfree(task);
+	return 0;
 }
 
-/* allocate memory from a new block */
-int alloc_in_new_block(int slice, unsigned long *addr,
-			     unsigned int size, int task_id,
-			     struct memory_t *tmem)
+/*
+ * free the task ids of a closed file. No ioctl of the file can run now,
+ * so its tasks stay valid once collected.
+ */
+void cb_mem_close(struct cb_tranx_t *tdev, struct file *filp)
 {
-	int i, j, blk_cnt;
-	int ret = 0;
-	struct mem_block *mem_block;
-
-	if (slice == SLICE0_INDEX) {
-		mem_block = tmem->mem_s0_bk;
-		blk_cnt = S0_BLOCK_CNT;
-	} else if (slice == SLICE1_INDEX) {
-		mem_block = tmem->mem_s1_bk;
-		blk_cnt = S1_BLOCK_CNT;
-	} else {
-		trans_dbg(tmem->tdev, TR_ERR,
-			"mem: %s, slice id:%d is error\n", __func__, slice);
-		return -EFAULT;
+	int id;
+	struct memory_t *tmem = tdev->modules[TR_MODULE_MEMORY];
+	struct mem_task *task, *tmp;
+	LIST_HEAD(tasks);
+
+	spin_lock(&tmem->taskid_lock);
+	idr_for_each_entry(&tmem->task_idr, task, id) {
+		if (task->filp == filp)
+			list_add_tail(&task->close, &tasks);
 	}
+	spin_unlock(&tmem->taskid_lock);
 
-	*addr = 0;
-	/* traversal all blocks, get a new block. */
-	for (i = 0; i < blk_cnt; i++) {
-		if (mem_block[i].task_id == 0) {
-			ret = get_chunks(slice, i, addr, size, task_id, tmem);
-			if (ret) {
-				trans_dbg(tmem->tdev, TR_ERR,
-					"mem: the size:0x%x is very large, more than slice:%d block:%d size, task_id=%d\n",
-					size, slice, i, task_id);
-				for (j = 0; j < mem_block[i].chunks; j++) {
-					if (mem_block[i].chk_inf[j].ck_rsv)
-						trans_dbg(tmem->tdev, TR_ERR,
-							"mem: j:%d reserve_cnt:%d\n",
-							j, mem_block[i].chk_inf[j].ck_rsv);
-				}
-			} else {
-				mem_block[i].task_id = task_id;
-				break;
-			}
-		}
+	list_for_each_entry_safe(task, tmp, &tasks, close) {
+		trans_dbg(tdev, TR_DBG, "%s id:%d\n", __func__, task->id);
+		free_task_id(tmem, task->id, filp);
 	}
+}
 
-	/*  not has valid block, alloc failed. */
-	if (i == blk_cnt) {
-		trans_dbg(tmem->tdev, TR_DBG,
-			"mem: %s, not has valid block in slice%d.\n",
-			__func__, slice);
-		return -EFAULT;
+/* add an allocation to the address tree of its task */
+static void insert_alloc(struct mem_task *task, struct mem_alloc *ma)
+{
+	struct rb_node **p = &task->addrs.rb_node, *parent = NULL;
+	struct mem_alloc *cur;
+
+	while (*p) {
+		parent = *p;
+		cur = rb_entry(parent, struct mem_alloc, node);
+		if (ma->addr < cur->addr)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
 	}
+	rb_link_node(&ma->node, parent, p);
+	rb_insert_color(&ma->node, &task->addrs);
+}
 
-	return ret;
+/* the allocation of a task at addr, NULL if none */
+static struct mem_alloc *find_alloc(struct mem_task *task,
+				    unsigned long addr)
+{
+	struct rb_node *n = task->addrs.rb_node;
+	struct mem_alloc *ma;
+
+	while (n) {
+		ma = rb_entry(n, struct mem_alloc, node);
+		if (addr < ma->addr)
+			n = n->rb_left;
+		else if (addr > ma->addr)
+			n = n->rb_right;
+		else
+			return ma;
+	}
+	return NULL;
 }
 
 /*
  * get memory from a slice.
  * @s: slice id.
  * @id: task id
- * @check: check:1, only get memory from used block
- *         check:0, if can't get valid memory in used block, allocate from
- *                  a new block.
+ * @ma: filled with the allocation.
  */
 static int alloc_mem_in_slice(int s, unsigned long *addr,
 					unsigned int size, int id,
-					struct memory_t *tmem, int check)
+					struct mem_alloc *ma,
+					struct memory_t *tmem)
 {
-	int i, blk_cnt;
-	int ret = 0;
-	struct mem_block *mem_block;
-
-	if (s == SLICE0_INDEX) {
-		mem_block = tmem->mem_s0_bk;
-		blk_cnt = S0_BLOCK_CNT;
-	} else if (s == SLICE1_INDEX) {
-		mem_block = tmem->mem_s1_bk;
-		blk_cnt = S1_BLOCK_CNT;
-	} else {
-		trans_dbg(tmem->tdev, TR_ERR,
-			"mem: slice id:%d is error in alloc mem in slice\n", s);
-		return -EFAULT;
-	}
-	*addr = 0;
+	struct mem_slice *ms = &tmem->slice[s];
+	/* calculate how many chunks we need;round up to chunk boundary */
+	u32 chunks = DIV_ROUND_UP(size, CHUNK_SIZE);
+	u32 idx;
 
-	/* traversal all blocks,check itself block if it has valid memory */
-	for (i = 0; i < blk_cnt; i++) {
-		if (mem_block[i].task_id == id) {
-			ret = get_chunks(s, i, addr, size, id, tmem);
-			if (!ret)
-				break;
-		}
+	idx = ep_buddy_alloc(&ms->buddy, chunks, id);
+	if (idx == EP_BUDDY_NIL) {
+		trans_dbg(tmem->tdev, TR_DBG,
+			"mem: no 0x%x bytes in slice:%d, largest free:0x%lx\n",
+			size, s, (unsigned long)ep_buddy_largest(&ms->buddy) *
+			CHUNK_SIZE);
+		return -EFAULT;
 	}
 
-	/* not has valid memory in itself block */
-	if (i == blk_cnt) {
-		if (check == 1)
-			ret = -EFAULT;
-		else
-			/* get a new block; */
-			ret = alloc_in_new_block(s, addr, size, id, tmem);
-	}
+	*addr = ms->start + (unsigned long)idx * CHUNK_SIZE;
+	ma->addr = *addr;
+	ma->idx = idx;
+	ma->slice = s;
+	/* the trace lines can be replayed by mem_replay */
+	trans_dbg(tmem->tdev, TR_DBG,
+		"mem: trace alloc id:%d size:0x%x addr:0x%lx\n",
+		id, size, *addr);
 
-	return ret;
+	return 0;
 }
 
-/* allocate memory from its own used block */
-static int alloc_in_used_block(unsigned long *busaddr,
-				     unsigned int size,
-				     int task_id,
-				     struct memory_t *tmem)
+/* the slice of a decoder or encoder core reserved by filp, -1 if none */
+static int core_slice(struct memory_t *tmem, struct file *filp)
 {
-	int ret;
+	int s;
+
+	s = vcd_core_slice(tmem->tdev, filp);
+	if (s < 0)
+		s = vce_core_slice(tmem->tdev, filp);
+	if (s < 0)
+		s = bigsea_core_slice(tmem->tdev, filp);
+	return s;
+}
 
-	if (tmem->s0_rev_size <= tmem->s1_rev_size) {
-		/* check slice0 if there is valid used block */
-		ret = alloc_mem_in_slice(SLICE0_INDEX, busaddr, size,
-					 task_id, tmem, 1);
-		/* s0 not has valid used blocks for this id, check s1. */
-		if (ret) {
-			/* check slice1 if it has valid used block. */
-			ret = alloc_mem_in_slice(SLICE1_INDEX, busaddr, size,
-						 task_id, tmem, 1);
-		}
-	} else {
-		/* check slice1 if it has valid used block */
-		ret = alloc_mem_in_slice(SLICE1_INDEX, busaddr, size,
-					 task_id, tmem, 1);
-		/* s1 not has valid used blocks for this id, check s0. */
-		if (ret) {
-			/* check s0 if it has valid used block. */
-			ret = alloc_mem_in_slice(SLICE0_INDEX, busaddr, size,
-						 task_id, tmem, 1);
-		}
+/*
+ * the slice an allocation asks for, -1 for any.
+ * @hint: enum TRANS_MEM_SLICE of the allocation.
+ * Without a hint or a slice set on the task, the allocation follows the
+ * core reserved by the calling file, else the core a file of the task
+ * had reserved at a former allocation: the codec libraries reserve a
+ * core per picture, so it's often released when a buffer is allocated.
+ */
+static int want_slice(struct memory_t *tmem, struct file *filp,
+			 struct mem_task *task, u32 hint)
+{
+	int s;
+
+	if (hint == MEM_SLICE_DEFAULT)
+		hint = task->slice;
+
+	switch (hint) {
+	case MEM_SLICE_0:
+		return SLICE0_INDEX;
+	case MEM_SLICE_1:
+		return SLICE1_INDEX;
+	case MEM_SLICE_CORE:
+		return core_slice(tmem, filp);
 	}
 
-	return ret;
+	s = core_slice(tmem, filp);
+	if (s >= 0)
+		task->core_slice = s;
+	return task->core_slice;
 }
 
 /*
@@ -425,180 +422,222 @@ static int alloc_in_used_block(unsigned long *busaddr,
  * method is the allocation strategy.
  *	0: only use slice_0
  *	1: only use_slice_1
- *	2: balance s0 and s1 by used size.
+ *	2: balance s0 and s1 by used size, or the slice @want first when it
+ *	   isn't -1.
  */
 static int alloc_mem_ep(unsigned long *busaddr,
 			    unsigned int size,
-			    int task_id,
+			    int want,
+			    struct mem_task *task,
 			    struct memory_t *tmem)
 {
+	int task_id = task->id;
 	int ret = 0;
+	int first;
+	struct mem_alloc *ma;
+	u32 aligned = ALIGN(size, CHUNK_SIZE);
 	*busaddr = 0;
 
 	if (WARN_ON(method > 2)) {
 		trans_dbg(tmem->tdev, TR_ERR, "mem: %s, method:%d error\n",
-			  __func__);
+			  __func__, method);
 		return -EFAULT;
 	}
 
+	if (task->quota && task->used + aligned > task->quota) {
+		trans_dbg(tmem->tdev, TR_ERR,
+			"mem: id:%d over its quota, used:0x%llx size:0x%x quota:0x%llx\n",
+			task_id, task->used, size, task->quota);
+		task->quota_fail++;
+		tmem->quota_fail++;
+		return -EDQUOT;
+	}
+
+	ma = kmalloc(sizeof(*ma), GFP_KERNEL);
+	if (!ma) {
+		trans_dbg(tmem->tdev, TR_ERR, "mem: alloc mem_alloc failed\n");
+		return -ENOMEM;
+	}
+
 	/* alloc memory from slice 0  */
 	if (method == 0)
 		ret = alloc_mem_in_slice(SLICE0_INDEX, busaddr, size, task_id,
-					 tmem, 0);
+					 ma, tmem);
 
 	/* alloc memory from slice 1 */
 	else if (method == 1)
 		ret = alloc_mem_in_slice(SLICE1_INDEX, busaddr, size, task_id,
-					 tmem, 0);
+					 ma, tmem);
 
 	/* alloc memory from slice 0 and slice 1, a simple balance */
 	else {
-		if (alloc_in_used_block(busaddr, size, task_id, tmem)) {
-			if (tmem->s0_rev_size <= tmem->s1_rev_size) {
-				/* first alloc from s0 */
-				ret = alloc_in_new_block(SLICE0_INDEX,
-						busaddr, size, task_id, tmem);
-				if (ret)
-					ret = alloc_in_new_block(SLICE1_INDEX,
-								 busaddr, size,
-								 task_id, tmem);
-			} else {
-				/* first alloc from s1 */
-				ret = alloc_in_new_block(SLICE1_INDEX,
-						busaddr, size, task_id, tmem);
-				if (ret)
-					ret = alloc_in_new_block(SLICE0_INDEX,
-								 busaddr, size,
-								 task_id, tmem);
-			}
-		}
-
+		if (want >= 0)
+			first = want;
+		else
+			first = slice_used(tmem, SLICE0_INDEX) <=
+				slice_used(tmem, SLICE1_INDEX) ?
+				SLICE0_INDEX : SLICE1_INDEX;
+		ret = alloc_mem_in_slice(first, busaddr, size, task_id, ma,
+					 tmem);
+		if (ret)
+			ret = alloc_mem_in_slice(!first, busaddr, size,
+						 task_id, ma, tmem);
 	}
 
 	if (!*busaddr) {
 		trans_dbg(tmem->tdev, TR_DBG, "mem: alloc ep mem failed\n");
-		ret = -EFAULT;
+		kfree(ma);
+		return -EFAULT;
+	}
+	list_add_tail(&ma->list, &task->allocs);
+	insert_alloc(task, ma);
+
+	ma->size = aligned;
+	task->used += aligned;
+	if (task->used > task->peak)
+		task->peak = task->used;
+	task->alloc_cnt++;
+	if (aligned > task->largest)
+		task->largest = aligned;
+
+	if (method == 2 && want >= 0) {
+		if (ma->slice == want)
+			tmem->affine[want]++;
+		else
+			tmem->cross[want]++;
 	}
 
 	return ret;
 }
 
-/*
- * when free memory, will check the block which did this memory used
- * if this block is not used, free it.
- */
+/* free a memory allocated by alloc_mem_ep(), only its owner can free it */
 static int free_mem_ep(unsigned long busaddr,
 			   unsigned int size,
-			   int task_id,
+			   struct mem_task *task,
 			   struct memory_t *tmem)
 {
-	int i, ret = 0;
-	int slice, bi = 0; /* bi:block index */
-	struct mem_block *mb; /* memory block */
-	unsigned long tmp;
-	u32 rsv_size;
+	int task_id = task->id;
+	struct mem_slice *ms;
+	struct ep_buddy_node *node;
+	struct mem_alloc *ma;
+	int s;
+	u32 idx;
 
 	/* Find the slice it belongs to */
-	if ((busaddr >= s0_start) && (busaddr < s0_end)) {
-		slice = SLICE0_INDEX;
-		mb = tmem->mem_s0_bk;
-
-		/* Find the block it belongs to */
-		for (i = 0; i < S0_BLOCK_CNT; i++) {
-			tmp = mb[i].start_addr + mb[i].block_size;
-			if ((busaddr >= mb[i].start_addr) && (busaddr < tmp)) {
-				bi = i;
-				break;
-			}
-		}
-	} else if ((busaddr >= s1_start) && (busaddr < s1_end)) {
-		slice = SLICE1_INDEX;
-		mb = tmem->mem_s1_bk;
-
-		for (i = 0; i < S1_BLOCK_CNT; i++) {
-			tmp = mb[i].start_addr + mb[i].block_size;
-			if ((busaddr >= mb[i].start_addr) && (busaddr < tmp)) {
-				bi = i;
-				break;
-			}
-		}
-	} else {
+	for (s = SLICE0_INDEX; s <= SLICE1_INDEX; s++) {
+		ms = &tmem->slice[s];
+		if ((busaddr >= ms->start) && (busaddr < ms->end))
+			break;
+	}
+	if (s > SLICE1_INDEX || (busaddr - ms->start) % CHUNK_SIZE) {
 		trans_dbg(tmem->tdev, TR_ERR,
 			"mem: busaddr:0x%lx is invalid\n", busaddr);
-		ret = -EFAULT;
-		goto err;
+		return -EFAULT;
+	}
+
+	idx = (busaddr - ms->start) / CHUNK_SIZE;
+	node = ep_buddy_used(&ms->buddy, idx);
+	if (!node) {
+		trans_dbg(tmem->tdev, TR_ERR,
+			"mem: %s can't find the chunk,busaddr:0x%lx size:0x%x\n",
+			__func__, busaddr, size);
+		return -EFAULT;
 	}
 
-	if (mb[bi].task_id != task_id) {
+	if (node->used.owner != task_id) {
 		trans_dbg(tmem->tdev, TR_ERR,
-			"mem: %s Wrong task_id:%d on block:%d,expected id is %d\n",
-			__func__, task_id, bi, mb[bi].task_id);
+			"mem: %s Wrong task_id:%d on 0x%lx,expected id is %d\n",
+			__func__, task_id, busaddr, node->used.owner);
 		trans_dbg(tmem->tdev, TR_ERR,
 			"mem: %s Owner mismatch while freeing memory!\n",
 			__func__);
-		ret = -EFAULT;
-		goto err;
+		return -EFAULT;
 	}
 
-	trans_dbg(tmem->tdev, TR_DBG,
-		"mem: %s, busaddr:0x%lx, size:0x%x, in slice:%d block:%d.\n",
-		__func__, busaddr, size, slice, bi);
-
-	for (i = 0; i < mb[bi].chunks; i++) {
-		if (mb[bi].chk_inf[i].bus_add == busaddr) {
-			rsv_size = mb[bi].chk_inf[i].ck_rsv * CHUNK_SIZE;
-			if (slice == SLICE0_INDEX)
-				tmem->s0_rev_size -= rsv_size;
-			else
-				tmem->s1_rev_size -= rsv_size;
-
-			mb[bi].free_chunks += mb[bi].chk_inf[i].ck_rsv;
-			mb[bi].chk_inf[i].ck_rsv = 0;
-
-			if (mb[bi].free_chunks == mb[bi].chunks) {
-				trans_dbg(tmem->tdev, TR_DBG,
-					"mem: %s block:%d is free in slice:%d\n",
-					__func__, bi, slice);
-				mb[bi].task_id = 0;
-			}
-			break;
-		}
+	ma = find_alloc(task, busaddr);
+	if (WARN_ON(!ma)) {
+		trans_dbg(tmem->tdev, TR_ERR,
+			"mem: %s id:%d has no allocation at 0x%lx\n",
+			__func__, task_id, busaddr);
+		return -EFAULT;
 	}
 
-	if (i == mb[bi].chunks) {
+	trans_dbg(tmem->tdev, TR_DBG,
+		"mem: trace free id:%d addr:0x%lx size:0x%x\n",
+		task_id, busaddr, node->used.size * CHUNK_SIZE);
+	ep_buddy_free(&ms->buddy, idx);
+
+	task->used -= ma->size;
+	task->alloc_cnt--;
+	rb_erase(&ma->node, &task->addrs);
+	list_del(&ma->list);
+	kfree(ma);
+
+	return 0;
+}
+
+/*
+ * allocate size bytes for task_id, from the slice of hint.
+ * return 0, -EDQUOT over the quota of the task, or another error.
+ */
+static int alloc_task_mem(struct file *filp, int task_id, u32 size,
+			  u32 hint, unsigned long *addr,
+			  struct memory_t *tmem)
+{
+	struct mem_task *task;
+	int ret;
+
+	if (mutex_lock_interruptible(&tmem->mem_mutex_ep))
+		return -ERESTARTSYS;
+	/* under the mutex, so the id can't be freed meanwhile */
+	task = find_task(tmem, task_id);
+	if (!task) {
+		mutex_unlock(&tmem->mem_mutex_ep);
 		trans_dbg(tmem->tdev, TR_ERR,
-			"mem: %s can't find the chunk,busaddr:0x%lx size:0x%x\n",
-			__func__, busaddr, size);
-		ret = -EFAULT;
-		goto err;
+			"mem: get mem, id:%d is error\n", task_id);
+		return -EFAULT;
 	}
+	ret = alloc_mem_ep(addr, size, want_slice(tmem, filp, task, hint),
+			   task, tmem);
+	mutex_unlock(&tmem->mem_mutex_ep);
 
-err:
-	return ret;
+	if (ret) {
+		trans_dbg(tmem->tdev, TR_ERR, "mem: alloc memory failed.\n");
+		/* tell a quota from a lack of memory */
+		return ret == -EDQUOT ? ret : -EFAULT;
+	}
+
+	return 0;
 }
 
-/* Compute memory utilization */
+/* undo alloc_task_mem when the address can't be returned to the user */
+static void undo_task_mem(int task_id, unsigned long addr, u32 size,
+			  struct memory_t *tmem)
+{
+	struct mem_task *task;
+
+	trans_dbg(tmem->tdev, TR_ERR,
+		"mem: get mem, copy_to_user failed, then free it\n");
+	mutex_lock(&tmem->mem_mutex_ep);
+	task = find_task(tmem, task_id);
+	if (task)
+		free_mem_ep(addr, size, task, tmem);
+	mutex_unlock(&tmem->mem_mutex_ep);
+}
+
+/*
+ * Compute memory utilization; the blk_used fields report the allocation
+ * count of the slices, blocks are gone with the buddy allocator.
+ */
 static void mem_usage(struct cb_tranx_t *tdev,
 			 struct mem_used_info *info)
 {
-	int i;
-	u32 s0_used = 0, s1_used = 0;
 	struct memory_t *tmem = tdev->modules[TR_MODULE_MEMORY];
+	unsigned long s0_used = slice_used(tmem, SLICE0_INDEX);
+	unsigned long s1_used = slice_used(tmem, SLICE1_INDEX);
 
-	info->s0_blk_used = 0;
-	info->s1_blk_used = 0;
-	for (i = 0; i < S0_BLOCK_CNT; i++) {
-		if (tmem->mem_s0_bk[i].task_id) {
-			info->s0_blk_used++;
-			s0_used += tmem->mem_s0_bk[i].block_size;
-		}
-	}
-	for (i = 0; i < S1_BLOCK_CNT; i++) {
-		if (tmem->mem_s1_bk[i].task_id) {
-			info->s1_blk_used++;
-			s1_used += tmem->mem_s1_bk[i].block_size;
-		}
-	}
+	info->s0_blk_used = tmem->slice[SLICE0_INDEX].buddy.allocs;
+	info->s1_blk_used = tmem->slice[SLICE1_INDEX].buddy.allocs;
 
 	info->s0_used = s0_used / 1024 / 1024;
 	info->s0_free = (s0_end - s0_start - s0_used) / 1024 / 1024;
@@ -614,14 +653,13 @@ static ssize_t mem_info_show(struct device *dev,
 	struct cb_misc_tdev *mtdev = dev_get_drvdata(dev);
 	struct cb_tranx_t *tdev = mtdev->tdev;
 	struct memory_t *tmem = tdev->modules[TR_MODULE_MEMORY];
-	struct mem_block *s0_bk = tmem->mem_s0_bk;
-	struct mem_block *s1_bk = tmem->mem_s1_bk;
-	u32 max_len = 16, i, j;
-	u32 cnt = S0_BLOCK_CNT/max_len, remainder = S0_BLOCK_CNT%max_len;
+	struct ep_buddy *b;
 	struct mem_used_info info;
 	u32 s0_total = (s0_end - s0_start)/1024/1024;
 	u32 s1_total = (s1_end - s1_start)/1024/1024;
+	int s, o;
 
+	mutex_lock(&tmem->mem_mutex_ep);
 	mem_usage(tdev, &info);
 	pos += sprintf(buf + pos, "S0:  %d MB used   %d MB free   %d.%02d%% used\n",
 		info.s0_used, info.s0_free,
@@ -630,42 +668,66 @@ static ssize_t mem_info_show(struct device *dev,
 		info.s1_used, info.s1_free,
 		(info.s1_used*10000)/(s1_total)/100, (info.s1_used*10000)/(s1_total)%100);
 
-	for (j = 0; j < cnt; j++) {
-		pos += sprintf(buf + pos, "block:");
-		for (i = 0; i < max_len; i++)
-			pos += sprintf(buf + pos, "  %2d", i+j*max_len);
+	pos += sprintf(buf + pos, "tasks: %d of %u   quota failures: %llu\n",
+		       tmem->task_cnt, max_task_num,
+		       (unsigned long long)tmem->quota_fail);
+
+	/* the free blocks by order show the fragmentation */
+	for (s = SLICE0_INDEX; s <= SLICE1_INDEX; s++) {
+		b = &tmem->slice[s].buddy;
+		pos += sprintf(buf + pos,
+			       "S%d:  %u allocations   largest free %u KB\n",
+			       s, b->allocs,
+			       ep_buddy_largest(b) * (CHUNK_SIZE / 1024));
+		pos += sprintf(buf + pos,
+			       "   %llu allocations asked for it, %llu in the other slice\n",
+			       (unsigned long long)(tmem->affine[s] + tmem->cross[s]),
+			       (unsigned long long)tmem->cross[s]);
+		pos += sprintf(buf + pos, "   free blocks of 4KB<<order:");
+		for (o = 0; o <= EP_BUDDY_MAX_ORDER; o++)
+			pos += sprintf(buf + pos, " %d:%u", o, b->nr_free[o]);
 		pos += sprintf(buf + pos, "\n");
+	}
+	mutex_unlock(&tmem->mem_mutex_ep);
 
-		pos += sprintf(buf + pos, "   S0:");
-		for (i = 0; i < max_len; i++)
-			pos += sprintf(buf + pos, "  %2d", s0_bk[i+j*max_len].task_id);
-		pos += sprintf(buf + pos, "\n");
+	return pos;
+}
 
-		pos += sprintf(buf + pos, "   S1:");
-		for (i = 0; i < max_len; i++)
-			pos += sprintf(buf + pos, "  %2d", s1_bk[i+j*max_len].task_id);
-		pos += sprintf(buf + pos, "\n");
-	}
-	if (remainder) {
-		pos += sprintf(buf + pos, "block:");
-		for (i = 0; i < remainder; i++)
-			pos += sprintf(buf + pos, "  %2d", i+j*max_len);
-		pos += sprintf(buf + pos, "\n");
 
-		pos += sprintf(buf + pos, "   S0:");
-		for (i = 0; i < remainder; i++)
-			pos += sprintf(buf + pos, "  %2d", s0_bk[i+j*max_len].task_id);
-		pos += sprintf(buf + pos, "\n");
+/* the memory of each task, in KB */
+static int mem_tasks_show(struct seq_file *m, void *v)
+{
+	struct memory_t *tmem = m->private;
+	struct mem_task *task;
+	int id;
 
-		pos += sprintf(buf + pos, "   S1:");
-		for (i = 0; i < remainder; i++)
-			pos += sprintf(buf + pos, "  %2d", s1_bk[i+j*max_len].task_id);
-		pos += sprintf(buf + pos, "\n");
+	seq_puts(m, "id     used_kb    peak_kb  allocs largest_kb   quota_kb quota_fail\n");
+	mutex_lock(&tmem->mem_mutex_ep);
+	spin_lock(&tmem->taskid_lock);
+	idr_for_each_entry(&tmem->task_idr, task, id) {
+		seq_printf(m, "%-5d %9llu %10llu %7u %10u %10llu %10u\n",
+			   id, task->used >> 10, task->peak >> 10,
+			   task->alloc_cnt, task->largest >> 10,
+			   task->quota >> 10, task->quota_fail);
 	}
+	spin_unlock(&tmem->taskid_lock);
+	mutex_unlock(&tmem->mem_mutex_ep);
 
-	return pos;
+	return 0;
 }
 
+static int mem_tasks_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mem_tasks_show, inode->i_private);
+}
+
+static const struct file_operations mem_tasks_fops = {
+	.owner = THIS_MODULE,
+	.open = mem_tasks_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
 
 static DEVICE_ATTR_RO(mem_info);
 
@@ -682,13 +744,20 @@ static struct attribute_group transmem_attribute_group = {
 int cb_mem_init(struct cb_tranx_t *tdev)
 {
 	int ret = -EFAULT;
-	u32 blk_size, i, j;
-	void *block;
-	void *hlina_chunks;
-	struct mem_block *mem_s0_bk;
-	struct mem_block *mem_s1_bk;
-	u64 tmp_addr;
 	struct memory_t *tmem;
+	struct mem_slice *ms;
+	u32 s0_chunks, s1_chunks;
+
+	if (s0_end <= s0_start || s1_end <= s1_start ||
+	    (s0_start | s1_start) % CHUNK_SIZE) {
+		trans_dbg(tdev, TR_ERR, "mem: invalid slice address\n");
+		goto out;
+	}
+	if (!max_task_num || max_task_num > MAX_TASK_LIMIT) {
+		trans_dbg(tdev, TR_ERR, "mem: invalid max_task_num:%u\n",
+			  max_task_num);
+		goto out;
+	}
 
 	tmem = kzalloc(sizeof(struct memory_t), GFP_KERNEL);
 	if (!tmem) {
@@ -698,92 +767,52 @@ int cb_mem_init(struct cb_tranx_t *tdev)
 	tdev->modules[TR_MODULE_MEMORY] = tmem;
 	tmem->tdev = tdev;
 
-	block = kzalloc(
-		sizeof(struct mem_block) * (S0_BLOCK_CNT + S1_BLOCK_CNT),
-		GFP_KERNEL);
-	if (!block) {
-		trans_dbg(tdev, TR_ERR, "mem: alloc block error\n");
+	s0_chunks = (s0_end - s0_start) / CHUNK_SIZE;
+	s1_chunks = (s1_end - s1_start) / CHUNK_SIZE;
+	tmem->nodes = vzalloc((s0_chunks + s1_chunks) *
+			      sizeof(struct ep_buddy_node));
+	if (!tmem->nodes) {
+		trans_dbg(tdev, TR_ERR, "mem: alloc chunk nodes failed\n");
 		goto out_free_dev;
 	}
 
-	hlina_chunks = vzalloc((s0_end - s0_start + s1_end - s1_start)
-				/ CHUNK_SIZE * sizeof(struct hlina_chunk));
-	if (!hlina_chunks) {
-		trans_dbg(tdev, TR_ERR, "mem: alloc hlina_chunks failed\n");
-		goto out_free_slice;
-	}
-
-	mem_s0_bk = block;
-	blk_size = ((s0_end - s0_start) / S0_BLOCK_CNT) & (~(CHUNK_SIZE - 1));
+	ms = &tmem->slice[SLICE0_INDEX];
+	ms->start = s0_start;
+	ms->end = s0_start + (unsigned long)s0_chunks * CHUNK_SIZE;
+	ep_buddy_init(&ms->buddy, tmem->nodes, s0_chunks);
 	trans_dbg(tdev, TR_DBG,
-		"memory : s0_start:0x%08lx s0_size:0x%lx block_cnt:%d, block_size:0x%lx,chunks:%ld.\n",
-		s0_start, s0_end - s0_start, S0_BLOCK_CNT,
-		blk_size, blk_size * S0_BLOCK_CNT / CHUNK_SIZE);
-	for (i = 0; i < S0_BLOCK_CNT; i++) {
-		mem_s0_bk[i].index = i;
-		mem_s0_bk[i].task_id = 0;
-		mem_s0_bk[i].block_size = blk_size;
-		mem_s0_bk[i].start_addr = s0_start + blk_size * i;
-		mem_s0_bk[i].chunks = mem_s0_bk[i].block_size / CHUNK_SIZE;
-		mem_s0_bk[i].free_chunks = mem_s0_bk[i].chunks;
-		mem_s0_bk[i].chk_inf = hlina_chunks;
-		hlina_chunks +=
-			sizeof(struct hlina_chunk) * mem_s0_bk[i].chunks;
-		tmp_addr = mem_s0_bk[i].start_addr;
-		for (j = 0; j < mem_s0_bk[i].chunks; j++) {
-			mem_s0_bk[i].chk_inf[j].bus_add = tmp_addr;
-			mem_s0_bk[i].chk_inf[j].ck_rsv = 0;
-			tmp_addr += CHUNK_SIZE;
-		}
-	}
+		"memory : s0_start:0x%08lx s0_size:0x%lx chunks:%u.\n",
+		s0_start, s0_end - s0_start, s0_chunks);
 
-	mem_s1_bk = block + sizeof(struct mem_block) * S0_BLOCK_CNT;
-	blk_size = ((s1_end - s1_start) / S1_BLOCK_CNT) & (~(CHUNK_SIZE - 1));
+	ms = &tmem->slice[SLICE1_INDEX];
+	ms->start = s1_start;
+	ms->end = s1_start + (unsigned long)s1_chunks * CHUNK_SIZE;
+	ep_buddy_init(&ms->buddy, tmem->nodes + s0_chunks, s1_chunks);
 	trans_dbg(tdev, TR_DBG,
-		"memory : s1_start:0x%08lx s1_size:0x%lx block_cnt:%d, block_size:0x%lx,chunks:%ld.\n",
-		s1_start, s1_end - s1_start, S1_BLOCK_CNT,
-		blk_size, blk_size * S0_BLOCK_CNT / CHUNK_SIZE);
-	for (i = 0; i < S1_BLOCK_CNT; i++) {
-		mem_s1_bk[i].index = i;
-		mem_s1_bk[i].task_id = 0;
-		mem_s1_bk[i].block_size = blk_size;
-		mem_s1_bk[i].start_addr = s1_start + blk_size * i;
-		mem_s1_bk[i].chunks = mem_s1_bk[i].block_size / CHUNK_SIZE;
-		mem_s1_bk[i].free_chunks = mem_s1_bk[i].chunks;
-		mem_s1_bk[i].chk_inf = hlina_chunks;
-		hlina_chunks +=
-			sizeof(struct hlina_chunk) * mem_s1_bk[i].chunks;
-		tmp_addr = mem_s1_bk[i].start_addr;
-		for (j = 0; j < mem_s1_bk[i].chunks; j++) {
-			mem_s1_bk[i].chk_inf[j].bus_add = tmp_addr;
-			mem_s1_bk[i].chk_inf[j].ck_rsv = 0;
-			tmp_addr += CHUNK_SIZE;
-		}
-	}
-
-	tmem->mem_s0_bk = mem_s0_bk;
-	tmem->mem_s1_bk = mem_s1_bk;
-	tmem->s0_rev_size = 0;
-	tmem->s1_rev_size = 0;
+		"memory : s1_start:0x%08lx s1_size:0x%lx chunks:%u.\n",
+		s1_start, s1_end - s1_start, s1_chunks);
 
 	mutex_init(&tmem->mem_mutex_ep);
 	mutex_init(&tmem->mem_mutex_rc);
 	spin_lock_init(&tmem->taskid_lock);
+	idr_init(&tmem->task_idr);
 
 	ret = sysfs_create_group(&tdev->misc_dev->this_device->kobj,
 				 &transmem_attribute_group);
 	if (ret) {
 		trans_dbg(tdev, TR_ERR, "mem: failed to create sysfs entry\n");
-		goto out_free_chunk;
+		goto out_free_nodes;
 	}
 
+	/* debugfs is optional, its errors are ignored */
+	tmem->debugfs = debugfs_create_file("mem_tasks", 0400, tdev->debugfs,
+					    tmem, &mem_tasks_fops);
+
 	trans_dbg(tdev, TR_INF, "mem: module initialize done.\n");
 	return 0;
 
-out_free_chunk:
-	vfree(tmem->mem_s0_bk[0].chk_inf);
-out_free_slice:
-	kfree(block);
+out_free_nodes:
+	vfree(tmem->nodes);
 out_free_dev:
 	kfree(tmem);
 out:
@@ -794,12 +823,21 @@ out:
 int cb_mem_release(struct cb_tranx_t *tdev)
 {
 	struct memory_t *tmem = tdev->modules[TR_MODULE_MEMORY];
+	struct mem_task *task;
+	struct mem_alloc *ma, *tmp;
+	int id;
 
+	debugfs_remove(tmem->debugfs);
 	mutex_destroy(&tmem->mem_mutex_ep);
 	mutex_destroy(&tmem->mem_mutex_rc);
 
-	vfree(tmem->mem_s0_bk[0].chk_inf);
-	kfree(tmem->mem_s0_bk);
+	idr_for_each_entry(&tmem->task_idr, task, id) {
+		list_for_each_entry_safe(ma, tmp, &task->allocs, list)
+			kfree(ma);
+		kfree(task);
+	}
+	idr_destroy(&tmem->task_idr);
+	vfree(tmem->nodes);
 
 	sysfs_remove_group(&tdev->misc_dev->this_device->kobj,
 			   &transmem_attribute_group);
@@ -810,14 +848,6 @@ int cb_mem_release(struct cb_tranx_t *tdev)
 	return 0;
 }
 
-static int check_task_id(struct memory_t *tmem, int task_id)
-{
-	if ((task_id > MAX_TASK_NUM) || (task_id < MIN_TASK_ID)
-	    || (tmem->id_st[task_id] == ID_FREE)) {
-		return -EFAULT;
-	} else
-		return 0;
-}
 long cb_mem_ioctl(struct file *filp,
 		      unsigned int cmd,
 		      unsigned long arg,
@@ -825,8 +855,11 @@ long cb_mem_ioctl(struct file *filp,
 {
 	int ret = 0;
 	int id;
+	struct mem_task *task;
 	struct mem_used_info info;
 	struct mem_info memp;
+	struct mem_slice_info slicep;
+	struct mem_quota_info quotap;
 	unsigned long addr;
 	void __user *argp = (void __user *)arg;
 	struct memory_t *tmem = tdev->modules[TR_MODULE_MEMORY];
@@ -851,26 +884,39 @@ long cb_mem_ioctl(struct file *filp,
 				"mem: get mem - mem_location error.\n");
 			return -EFAULT;
 		}
-		if (check_task_id(tmem, memp.task_id)) {
-			trans_dbg(tdev, TR_ERR,
-				"mem: get mem, id:%d is error\n", memp.task_id);
+
+		/* the padding of mem_info is garbage, use the task slice */
+		ret = alloc_task_mem(filp, memp.task_id, memp.size,
+				     MEM_SLICE_DEFAULT, &addr, tmem);
+		if (ret)
+			return ret;
+		memp.phy_addr = addr;
+		if (__copy_to_user(argp, &memp, sizeof(memp))) {
+			undo_task_mem(memp.task_id, addr, memp.size, tmem);
 			return -EFAULT;
 		}
 
-		if (mutex_lock_interruptible(&tmem->mem_mutex_ep))
-			return -ERESTARTSYS;
-		ret = alloc_mem_ep(&addr, memp.size, memp.task_id, tmem);
-		mutex_unlock(&tmem->mem_mutex_ep);
-
-		if (ret) {
-			trans_dbg(tdev, TR_ERR, "mem: alloc memory failed.\n");
+		break;
+	case CB_TRANX_MEM_ALLOC_SLICE:
+		if (copy_from_user(&slicep, argp, sizeof(slicep))) {
+			trans_dbg(tdev, TR_ERR,
+				"mem: get slice mem - copy_from_user failed.\n");
 			return -EFAULT;
 		}
-		memp.phy_addr = addr;
-		if (__copy_to_user(argp, &memp, sizeof(memp))) {
+		if (slicep.slice > MEM_SLICE_CORE || slicep.reserved) {
 			trans_dbg(tdev, TR_ERR,
-				"mem: get mem, copy_to_user failed, then free it\n");
-			free_mem_ep(addr, memp.size, memp.task_id, tmem);
+				"mem: get slice mem - slice:%u error.\n",
+				slicep.slice);
+			return -EINVAL;
+		}
+
+		ret = alloc_task_mem(filp, slicep.task_id, slicep.size,
+				     slicep.slice, &addr, tmem);
+		if (ret)
+			return ret;
+		slicep.phy_addr = addr;
+		if (__copy_to_user(argp, &slicep, sizeof(slicep))) {
+			undo_task_mem(slicep.task_id, addr, slicep.size, tmem);
 			return -EFAULT;
 		}
 
@@ -886,21 +932,81 @@ long cb_mem_ioctl(struct file *filp,
 				"mem: free mem - mem_location error.\n");
 			return -EFAULT;
 		}
-		if (check_task_id(tmem, memp.task_id)) {
+
+		if (mutex_lock_interruptible(&tmem->mem_mutex_ep))
+			return -ERESTARTSYS;
+		task = find_task(tmem, memp.task_id);
+		if (!task) {
+			mutex_unlock(&tmem->mem_mutex_ep);
 			trans_dbg(tdev, TR_ERR,
 				"mem: free mem,id:%d is error\n", memp.task_id);
 			return -EFAULT;
 		}
+		ret = free_mem_ep(memp.phy_addr, memp.size, task, tmem);
+		mutex_unlock(&tmem->mem_mutex_ep);
+
+		if (ret) {
+			trans_dbg(tdev, TR_ERR, "mem: free memory failed\n");
+			return -EFAULT;
+		}
+		break;
+	case CB_TRANX_MEM_SET_SLICE:
+		if (copy_from_user(&slicep, argp, sizeof(slicep))) {
+			trans_dbg(tdev, TR_ERR,
+				"mem: set slice - copy_from_user failed.\n");
+			return -EFAULT;
+		}
+		if (slicep.slice > MEM_SLICE_CORE || slicep.reserved) {
+			trans_dbg(tdev, TR_ERR,
+				"mem: set slice - slice:%u error.\n", slicep.slice);
+			return -EINVAL;
+		}
 
 		if (mutex_lock_interruptible(&tmem->mem_mutex_ep))
 			return -ERESTARTSYS;
-		ret = free_mem_ep(memp.phy_addr, memp.size, memp.task_id, tmem);
+		task = find_task(tmem, slicep.task_id);
+		if (task && task->filp == filp)
+			task->slice = slicep.slice;
+		else
+			ret = -EFAULT;
 		mutex_unlock(&tmem->mem_mutex_ep);
 
-		if (ret) {
-			trans_dbg(tdev, TR_ERR, "mem: free memory failed\n");
+		if (ret)
+			trans_dbg(tdev, TR_ERR,
+				"mem: set slice, id:%d is error\n", slicep.task_id);
+		break;
+	case CB_TRANX_MEM_SET_QUOTA:
+		if (copy_from_user(&quotap, argp, sizeof(quotap))) {
+			trans_dbg(tdev, TR_ERR,
+				"mem: set quota - copy_from_user failed.\n");
 			return -EFAULT;
 		}
+		if (quotap.reserved)
+			return -EINVAL;
+
+		if (mutex_lock_interruptible(&tmem->mem_mutex_ep))
+			return -ERESTARTSYS;
+		task = find_task(tmem, quotap.task_id);
+		if (!task) {
+			ret = -EFAULT;
+		} else if (capable(CAP_SYS_ADMIN)) {
+			/* the scheduler sets the quota of any task */
+			task->quota = quotap.quota;
+		} else if (task->filp != filp) {
+			ret = -EPERM;
+		} else if (!quotap.quota ||
+			   (task->quota && quotap.quota > task->quota)) {
+			/* a task can't raise or clear its own quota */
+			ret = -EPERM;
+		} else {
+			task->quota = quotap.quota;
+		}
+		mutex_unlock(&tmem->mem_mutex_ep);
+
+		if (ret)
+			trans_dbg(tdev, TR_ERR,
+				"mem: set quota 0x%llx, id:%d error:%d\n",
+				quotap.quota, quotap.task_id, ret);
 		break;
 	case CB_TRANX_MEM_GET_TASKID:
 		id = get_task_id(tmem, filp);
@@ -912,12 +1018,11 @@ long cb_mem_ioctl(struct file *filp,
 		break;
 	case CB_TRANX_MEM_FREE_TASKID:
 		__get_user(id, (int *)argp);
-		if (check_task_id(tmem, id)) {
+		if (free_task_id(tmem, id, filp)) {
 			trans_dbg(tdev, TR_ERR,
 				"mem: free id, id:%d is error\n", id);
 			return -EFAULT;
 		}
-		free_task_id(tmem, id);
 		break;
 	default:
 		trans_dbg(tdev, TR_ERR,
@@ -17,6 +17,7 @@
 #include <linux/pci.h>
 #include <linux/module.h>
 #include <linux/aer.h>
+#include <linux/debugfs.h>
 
 #include "common.h"
 #include "encoder.h"
@@ -96,8 +97,12 @@ long trans_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		ret = edma_ioctl(filp, cmd, arg, tdev);
 	else if (cid == _IOC_NR(CB_TRANX_EDMA_PHY_TRANX))
 		ret = edma_ioctl(filp, cmd, arg, tdev);
+	else if (cid >= IOCTL_CMD_EDMA_EXT_MINNR && cid <= IOCTL_CMD_EDMA_EXT_MAXNR)
+		ret = edma_ioctl(filp, cmd, arg, tdev);
 	else if (cid >= IOCTL_CMD_MEM_MINNR && cid <= IOCTL_CMD_MEM_MAXNR)
 		ret = cb_mem_ioctl(filp, cmd, arg, tdev);
+	else if (cid >= IOCTL_CMD_MEM_EXT_MINNR && cid <= IOCTL_CMD_MEM_EXT_MAXNR)
+		ret = cb_mem_ioctl(filp, cmd, arg, tdev);
 	else if (cid >= IOCTL_CMD_VCD_MINNR && cid <= IOCTL_CMD_VCD_MAXNR)
 		ret = vc8000d_ioctl(filp, cmd, arg, tdev);
 	else if (cid >= IOCTL_CMD_VCE_MINNR && cid <= IOCTL_CMD_VCE_MAXNR)
@@ -146,6 +151,7 @@ static int trans_close(struct inode *inode, struct file *filp)
 	if (WARN_ON(!tdev))
 		return -EFAULT;
 
+	edma_close(tdev, filp);
 	cb_mem_close(tdev, filp);
 	bigsea_close(tdev, filp);
 	vce_close(tdev, filp);
@@ -162,6 +168,17 @@ static int trans_close(struct inode *inode, struct file *filp)
 	return 0;
 }
 
+/* readable when async edma jobs of the file are done */
+static __poll_t trans_poll(struct file *filp, poll_table *wait)
+{
+	struct cb_tranx_t *tdev = get_trans_dev(iminor(file_inode(filp)));
+
+	if (!tdev)
+		return POLLERR;
+
+	return edma_poll(tdev, filp, wait);
+}
+
 static int trans_open(struct inode *inode, struct file *filp)
 {
 	return 0;
@@ -201,12 +218,16 @@ static const struct file_operations trans_char_fops = {
 	.unlocked_ioctl = trans_ioctl,
 	.compat_ioctl = trans_ioctl,
 	.mmap = trans_mmap,
+	.poll = trans_poll,
 };
 
 static int modules_init(struct cb_tranx_t *data)
 {
 	struct cb_tranx_t *tdev = data;
 
+	/* the modules add their debugfs files in it, errors are ignored */
+	tdev->debugfs = debugfs_create_dir(tdev->misc_dev->name, NULL);
+
 	/* initialize pcie module first.*/
 	if (cb_pci_init(tdev)) {
 		trans_dbg(tdev, TR_ERR, "core: initialize pci failed.\n");
@@ -284,6 +305,7 @@ out_release_enc:
 out_release_pci:
 	cb_pci_release(tdev);
 out:
+	debugfs_remove_recursive(tdev->debugfs);
 	return -EFAULT;
 }
 
@@ -300,6 +322,7 @@ static void modules_release(struct cb_tranx_t *data)
 	edma_release(tdev);
 	cb_mem_release(tdev);
 	cb_pci_release(tdev);
+	debugfs_remove_recursive(tdev->debugfs);
 }
 
 
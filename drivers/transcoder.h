@@ -19,6 +19,31 @@ enum TRANS_EDMA_INT {
 	INTE_EN = 1,
 };
 
+/* completion of a ddr edma transfer, AUTO: poll when it is no larger than
+ * the edma_poll_size sysfs threshold. A poll is bounded by edma_poll_us,
+ * then the transfer waits for its interrupt.
+ */
+enum TRANS_EDMA_POLL {
+	EDMA_POLL_AUTO = 0,
+	EDMA_POLL_ON = 1,
+	EDMA_POLL_OFF = 2,
+};
+
+/*
+ * slice affinity of an ep memory allocation, in struct mem_slice_info.
+ * DEFAULT: the slice of the task, set by CB_TRANX_MEM_SET_SLICE; when the
+ * task has none, the slice of its decoder or encoder core. Before any
+ * core of the task is seen, the slices are balanced as before.
+ * CORE: the slice of a decoder or encoder core reserved by the file.
+ * When the slice is full the other one is used.
+ */
+enum TRANS_MEM_SLICE {
+	MEM_SLICE_DEFAULT = 0,
+	MEM_SLICE_0 = 1,
+	MEM_SLICE_1 = 2,
+	MEM_SLICE_CORE = 3,
+};
+
 enum TRANS_LT_STATUS {
 	LT_UNDONE = 0,
 	LT_DONE = 1,
@@ -75,6 +100,74 @@ struct trans_pcie_edma {
 	__u32 element_num_each;
 };
 
+/* edma 2D transfer info, one request for a whole strided plane */
+struct trans_pcie_edma_2d {
+	__u64 rc_addr; /* rc virtual address of the first row */
+	__u64 ep_addr; /* ep address of the first row */
+	__u32 width; /* bytes to transfer per row */
+	__u32 height; /* row count */
+	__u32 rc_stride; /* bytes between two rows in rc memory */
+	__u32 ep_stride; /* bytes between two rows in ep memory */
+	__u32 direct; /* 1:EP to RC;  0:RC to EP*/
+};
+
+/* rc buffer registered for edma, pinned until it's unregistered */
+struct trans_edma_buf {
+	__u64 rc_addr; /* rc virtual address of the buffer */
+	__u32 size; /* buffer size */
+	__u32 handle; /* returned handle, never 0 */
+};
+
+/* edma transfer on a registered rc buffer */
+struct trans_edma_buf_tranx {
+	__u32 handle; /* handle of the registered buffer */
+	__u32 offset; /* offset in the registered buffer */
+	__u32 size; /* transfer size */
+	__u32 direct; /* 1:EP to RC;  0:RC to EP*/
+	__u64 ep_addr; /* ep address */
+};
+
+/* one segment of a vectored edma transfer */
+struct trans_edma_seg {
+	__u64 rc_addr; /* rc virtual address */
+	__u64 ep_addr; /* ep address */
+	__u32 size; /* transfer size */
+	__u32 direct; /* 1:EP to RC;  0:RC to EP*/
+};
+
+/* vectored edma transfer, the segments of one direction go by one chained
+ * link table and complete with one interrupt.
+ */
+struct trans_edma_vec {
+	__u64 segs; /* user address of the struct trans_edma_seg array */
+	__u32 seg_cnt; /* segment count */
+	__u32 poll; /* enum TRANS_EDMA_POLL, AUTO: the mode of the file */
+};
+
+/* async vectored edma job, its rc pages are pinned when it's submitted */
+struct trans_edma_submit {
+	__u64 segs; /* user address of the struct trans_edma_seg array */
+	__u32 seg_cnt; /* segment count */
+	__u32 poll; /* enum TRANS_EDMA_POLL, AUTO: the mode of the file */
+	__u64 job_id; /* returned job id, never 0 */
+};
+
+/* a finished async edma job */
+struct trans_edma_done {
+	__u64 job_id;
+	__s32 status; /* 0 on success, or a negative errno */
+	__u32 reserved;
+};
+
+/* reap the finished async edma jobs, it never blocks: poll() the device
+ * fd, or the eventfd set by CB_TRANX_EDMA_ASYNC_EVENTFD, to wait for them.
+ */
+struct trans_edma_reap {
+	__u64 done; /* user address of a struct trans_edma_done array */
+	__u32 max; /* entries of the array */
+	__u32 cnt; /* returned count of finished jobs */
+};
+
 /* edma link table info */
 struct dma_link_table {
 	__u32 control; /* control configuration */
@@ -137,6 +230,28 @@ struct mem_info {
 	void *rc_kvirt;
 };
 
+/*
+ * ep memory allocation with a slice affinity. struct mem_info keeps its
+ * layout, the padding after mem_location is not initialized by old users.
+ */
+struct mem_slice_info {
+	__s32 task_id; /* task id */
+	__u32 slice; /* enum TRANS_MEM_SLICE, slice affinity */
+	__u32 size;
+	__u32 reserved; /* must be 0 */
+	__u64 phy_addr; /* physics address */
+};
+
+/*
+ * memory quota of a task id. Any task's quota can be set with
+ * CAP_SYS_ADMIN; without it, the file which got the id can only lower it.
+ */
+struct mem_quota_info {
+	__s32 task_id; /* task id */
+	__u32 reserved; /* must be 0 */
+	__u64 quota; /* bytes, 0: no quota */
+};
+
 /* ep memory used information */
 struct mem_used_info {
 	__u32 s0_used;
@@ -218,6 +333,29 @@ struct mem_used_info {
 
 #define CB_TRANX_EDMA_PHY_TRANX       _IOWR('k', 0x27, struct trans_pcie_edma *)
 
+/* edma submodule ioctl commands, extended */
+#define IOCTL_CMD_EDMA_EXT_MINNR      0x28
+#define IOCTL_CMD_EDMA_EXT_MAXNR      0x31
+#define CB_TRANX_EDMA_2D_TRANX        _IOWR('k', 0x28, struct trans_pcie_edma_2d *)
+#define CB_TRANX_EDMA_REG_BUF         _IOWR('k', 0x29, struct trans_edma_buf *)
+#define CB_TRANX_EDMA_UNREG_BUF       _IOWR('k', 0x2a, __u32 *)
+#define CB_TRANX_EDMA_BUF_TRANX       _IOWR('k', 0x2b, struct trans_edma_buf_tranx *)
+#define CB_TRANX_EDMA_VEC_TRANX       _IOWR('k', 0x2c, struct trans_edma_vec *)
+#define CB_TRANX_EDMA_ASYNC_SUBMIT    _IOWR('k', 0x2d, struct trans_edma_submit *)
+#define CB_TRANX_EDMA_ASYNC_REAP      _IOWR('k', 0x2e, struct trans_edma_reap *)
+#define CB_TRANX_EDMA_ASYNC_EVENTFD   _IOWR('k', 0x2f, __s32 *)
+#define CB_TRANX_EDMA_SET_PRIO        _IOWR('k', 0x30, __u32 *)
+#define CB_TRANX_EDMA_SET_POLL        _IOWR('k', 0x31, __u32 *)
+
+/* memory submodule ioctl commands, extended */
+#define IOCTL_CMD_MEM_EXT_MINNR       0x32
+#define IOCTL_CMD_MEM_EXT_MAXNR       0x34
+/* default slice of the allocations of task_id, size is not used */
+#define CB_TRANX_MEM_SET_SLICE        _IOWR('k', 0x32, struct mem_slice_info *)
+/* as CB_TRANX_MEM_ALLOC, from the slice asked for */
+#define CB_TRANX_MEM_ALLOC_SLICE      _IOWR('k', 0x33, struct mem_slice_info *)
+/* memory quota of task_id, see struct mem_quota_info */
+#define CB_TRANX_MEM_SET_QUOTA        _IOWR('k', 0x34, struct mem_quota_info *)
 
-#define TRANS_MAXNR	0x27
+#define TRANS_MAXNR	0x34
 #endif  /*  __TRANSCODER_H__*/
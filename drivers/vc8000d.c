@@ -1103,6 +1103,21 @@ void vcd_close(struct cb_tranx_t *tdev, struct file *filp)
 	}
 }
 
+/* the slice of a core reserved by filp, -1 if it has none */
+int vcd_core_slice(struct cb_tranx_t *tdev, struct file *filp)
+{
+	int id;
+	struct vc8000d_t *tvcd = tdev->modules[TR_MODULE_VC8000D];
+
+	/* core_0 and core_1 in slice_0, core_2 and core_3 in slice_1 */
+	for (id = 0; id < VCD_MAX_CORES; id++) {
+		if (tvcd->core[id].filp == filp)
+			return id / 2;
+	}
+
+	return -1;
+}
+
 static int check_dec_irq(struct vc8000d_t *tvcd,
 			     const struct file *filp,
 			     u32 id)
@@ -68,6 +68,7 @@ long vc8000d_ioctl(struct file *filp,
 			struct cb_tranx_t *tdev);
 int adjust_vcd_pll(struct cb_tranx_t *tdev, u32 slice_id);
 void vcd_close(struct cb_tranx_t *tdev, struct file *filp);
+int vcd_core_slice(struct cb_tranx_t *tdev, struct file *filp);
 int vc8000d_core_reset(struct cb_tranx_t *tdev, int core_id);
 irqreturn_t vcd_isr(int irq, void *data);
 
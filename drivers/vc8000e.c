@@ -332,6 +332,21 @@ void vce_close(struct cb_tranx_t *tdev, struct file *filp)
 	}
 }
 
+/* the slice of a core reserved by filp, -1 if it has none */
+int vce_core_slice(struct cb_tranx_t *tdev, struct file *filp)
+{
+	int id;
+	struct vc8000e_t *tvce = tdev->modules[TR_MODULE_VC8000E];
+
+	/* core_0 in slice_0, core_1 in slice_1 */
+	for (id = 0; id < VCE_MAX_CORES; id++) {
+		if (tvce->core[id].filp == filp)
+			return id;
+	}
+
+	return -1;
+}
+
 /* vc8000e interrupt handling function. */
 irqreturn_t vce_isr(int index, void *data)
 {
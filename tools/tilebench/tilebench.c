@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020, VeriSilicon Holdings Co., Ltd. All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Microbenchmark of the raster to 4x4 tile conversion done for FB format
+ * encoder input, compares the SIMD kernel with the plain C one and with
+ * the former per sample memcpy loop, and checks they give the same data.
+ *
+ * ./tilebench [width height [loops]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "vpi_video_enc_tile.h"
+
+typedef void (*TileFunc)(uint8_t *dst, uint32_t dst_stride,
+                         const uint8_t *src, uint32_t src_stride,
+                         uint32_t tiles, uint32_t rows, uint32_t tile_bytes);
+
+/* the conversion as trans_yuv_to_fbformat() used to do it */
+static void tile4x4_legacy(uint8_t *dst, uint32_t dst_stride,
+                           const uint8_t *src, uint32_t src_stride,
+                           uint32_t tiles, uint32_t rows, uint32_t tile_bytes)
+{
+    uint32_t x, y;
+
+    for (x = 0; x < tiles; x++) {
+        for (y = 0; y < rows; y++)
+            memcpy(dst + y % 4 * tile_bytes + dst_stride * (y / 4) +
+                       x * 4 * tile_bytes,
+                   src + y * src_stride + x * tile_bytes, tile_bytes);
+    }
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* convert one NV12 (bpc 1) or P010 (bpc 2) frame, luma then chroma */
+static void convert_frame(TileFunc func, uint8_t *dst, const uint8_t *src,
+                          uint32_t width, uint32_t height, uint32_t bpc)
+{
+    uint32_t stride     = width * 4 * bpc;
+    uint32_t src_stride = ((width + 15) & ~15) * bpc;
+
+    func(dst, stride, src, src_stride, width / 4, height, 4 * bpc);
+    func(dst + stride * height / 4, stride, src + src_stride * height,
+         src_stride, width / 4, (height / 2 + 3) / 4 * 4, 4 * bpc);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *names[] = { "legacy", "c", "simd" };
+    TileFunc funcs[]           = { tile4x4_legacy,
+                                   vpi_enc_raster_to_tile4x4_c,
+                                   vpi_enc_raster_to_tile4x4 };
+    uint32_t width  = argc > 2 ? atoi(argv[1]) : 1920;
+    uint32_t height = argc > 2 ? atoi(argv[2]) : 1080;
+    int loops       = argc > 3 ? atoi(argv[3]) : 100;
+    uint32_t bpc, size, i;
+    uint8_t *src, *dst[3];
+    int f, n, ret = 0;
+
+    for (bpc = 1; bpc <= 2; bpc++) {
+        /* room for the padded chroma rows the conversion reads */
+        size = ((width + 15) & ~15) * bpc * (height * 2 + 4);
+        src  = malloc(size);
+        for (i = 0; i < size; i++)
+            src[i] = rand();
+        for (f = 0; f < 3; f++) {
+            posix_memalign((void **)&dst[f], 64, size);
+            memset(dst[f], 0, size);
+        }
+
+        for (f = 0; f < 3; f++) {
+            double start;
+
+            convert_frame(funcs[f], dst[f], src, width, height, bpc);
+            start = now_ms();
+            for (n = 0; n < loops; n++)
+                convert_frame(funcs[f], dst[f], src, width, height, bpc);
+            printf("%s %ux%u %-6s: %8.3f ms/frame\n",
+                   bpc == 1 ? "NV12" : "P010", width, height, names[f],
+                   (now_ms() - start) / loops);
+            if (f && memcmp(dst[0], dst[f], size)) {
+                printf("  %s output differs from legacy\n", names[f]);
+                ret = 1;
+            }
+        }
+
+        free(src);
+        for (f = 0; f < 3; f++)
+            free(dst[f]);
+    }
+    return ret;
+}
@@ -62,6 +62,8 @@ typedef enum {
     /*hw downloader command*/
     VPI_CMD_HWDW_FREE_BUF,
     VPI_CMD_HWDW_SET_INDEX,
+    VPI_CMD_HWDW_SET_ASYNC,
+    VPI_CMD_HWDW_WAIT_FENCE,
 
     /*encoder command*/
     VPI_CMD_ENC_GET_EMPTY_FRAME_SLOT,
@@ -172,6 +174,11 @@ typedef struct VpiPacket {
     void *opaque;
     int64_t duration;
     int flags;
+
+    /* set by the encoder in zero_copy_pkt mode: data stays owned by the
+     * encoder until release(release_ctx, data) is called */
+    void (*release)(void *release_ctx, uint8_t *data);
+    void *release_ctx;
 } VpiPacket;
 
 typedef struct VpiCrop{
@@ -235,6 +242,28 @@ typedef struct VpiHdrInfo {
     uint32_t hdr10_avglight;
 } VpiHdrInfo;
 
+/**
+ * Per-frame ROI map for the H26x encoder, attached to VpiFrame.roi_map.
+ * One entry per block of the size given by block_unit, which must match
+ * the roi_map_block_unit encoder parameter. The map is copied when the
+ * frame is sent, so it may be reused once put_frame returns.
+ */
+typedef struct VpiRoiMap {
+    /* 0:64x64 1:32x32 2:16x16 3:8x8 */
+    int block_unit;
+    /* number of blocks per row and number of block rows */
+    int width;
+    int height;
+    /* bytes between two rows of qp and flags */
+    int stride;
+    /* qp holds absolute QPs (0..51) instead of QP deltas */
+    int absolute_qp;
+    int8_t *qp;
+    /* optional 0/1 per block, skip flag with roi map version 2 and IPCM
+     * flag with version 1, may be NULL */
+    uint8_t *flags;
+} VpiRoiMap;
+
 typedef struct VpiFrame {
     int task_id;
     int src_width;
@@ -278,6 +307,10 @@ typedef struct VpiFrame {
     uint16_t cfg_width;
     uint16_t cfg_height;
     uint8_t cfg_res;
+    /* ROI map of this frame for the H26x encoder, NULL if none */
+    VpiRoiMap *roi_map;
+    /* fence of the async hwdownload filling this frame, 0 if it's done */
+    uint64_t fence;
 } VpiFrame;
 
 typedef struct VpiSysInfo {
@@ -285,6 +318,11 @@ typedef struct VpiSysInfo {
     int sys_log_level;
     int task_id;
     int priority;
+    /*
+     * ep memory slice of the task: 0 the slice of its cores, 1 slice 0,
+     * 2 slice 1
+     */
+    int mem_slice;
 } VpiSysInfo;
 
 typedef struct VpiCtrlCmdParam {
@@ -385,8 +423,21 @@ typedef struct VpiHWUploadCfg{
     char *device;
     VpiFrame *frame;
     VpiPixsFmt format;
+    /* input planes are hugepage memory, planes whose stride is not above
+     * the EP stride are then uploaded without staging copy */
+    int hugepage_input;
 } VpiHWUploadCfg;
 
+/* data of VPI_CMD_HWDW_WAIT_FENCE, the int pointed by outdata gets
+ * 1 if the transfer is done, 0 if it's still running at the timeout,
+ * or a negative VpiRet if it failed */
+typedef struct VpiHwDwFence {
+    /* fence of VpiFrame, 0 for the last one handed out */
+    uint64_t fence;
+    /* 0 to poll, negative to wait until done */
+    int timeout_ms;
+} VpiHwDwFence;
+
 typedef struct VpiApi {
     int (*init)(VpiCtx, void *);
 
@@ -407,6 +458,9 @@ typedef struct VpiApi {
     int (*process)(VpiCtx, void *indata, void *outdata);
 
     int (*close)(VpiCtx);
+
+    /* queue several packets at once, returns the number queued */
+    int (*decode_put_packets)(VpiCtx, VpiPacket *packets, int num);
 } VpiApi;
 
 #endif
@@ -30,6 +30,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
+#include <time.h>
 
 #include "deccfg.h"
 #include "h264hwd_container.h"
@@ -61,6 +63,46 @@ static void vpi_dec_log_header_init(VpiDecCtx *vpi_ctx, VpiDecOption *dec_cfg)
 #endif
 }
 
+/* must be called with dec_thread_mutex held */
+void vpi_dec_wakeup_worker(VpiDecCtx *vpi_ctx)
+{
+    vpi_ctx->dec_work_pending = 1;
+    pthread_cond_signal(&vpi_ctx->dec_work_cond);
+}
+
+static void vpi_dec_wait_for_work(VpiDecCtx *vpi_ctx)
+{
+    struct timespec start, end, deadline;
+    int ret = 0;
+
+    pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
+    if (vpi_ctx->dec_work_pending || vpi_ctx->dec_thread_finish) {
+        vpi_ctx->dec_work_pending = 0;
+        pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    deadline.tv_nsec += DEC_WORKER_IDLE_TIMEOUT_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!vpi_ctx->dec_work_pending && !vpi_ctx->dec_thread_finish &&
+           ret != ETIMEDOUT) {
+        ret = pthread_cond_timedwait(&vpi_ctx->dec_work_cond,
+                                     &vpi_ctx->dec_thread_mutex, &deadline);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    vpi_ctx->dec_work_pending = 0;
+    vpi_ctx->dec_wakeup_number++;
+    vpi_ctx->dec_idle_time += (end.tv_sec - start.tv_sec) * 1000000LL +
+                              (end.tv_nsec - start.tv_nsec) / 1000;
+    pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
+}
+
 void *decode_process(void *param)
 {
     VpiDecCtx *vpi_ctx = (VpiDecCtx *)param;
@@ -81,7 +123,9 @@ void *decode_process(void *param)
             break;
         }
         if (ret == 0) {
-            usleep(500);
+            /* nothing to do, sleep until a packet, a frame buffer
+             * or a consumed picture is handed over by the API thread */
+            vpi_dec_wait_for_work(vpi_ctx);
         } else if (ret == -1) {
             break;
         }
@@ -94,6 +138,7 @@ static VpiRet vpi_dec_init_decoder(VpiDecCtx *vpi_ctx, void *cfg)
 {
     VpiDecOption *dec_cfg = (VpiDecOption *)cfg;
     VpiRet ret         = VPI_SUCCESS;
+    pthread_condattr_t cond_attr;
     uint32_t size, i;
 
     ret = vpi_check_out_format_for_trans(vpi_ctx, dec_cfg);
@@ -196,6 +241,13 @@ static VpiRet vpi_dec_init_decoder(VpiDecCtx *vpi_ctx, void *cfg)
                     vpi_ctx->stream_mem[i].size);
         }
     }
+    vpi_dec_buf_ring_init(&vpi_ctx->strm_buf_queue);
+    vpi_dec_buf_ring_init(&vpi_ctx->rls_strm_buf_queue);
+    vpi_dec_buf_ring_init(&vpi_ctx->frame_free_queue);
+    vpi_dec_buf_ring_init(&vpi_ctx->frame_idle_queue);
+    vpi_dec_buf_ring_init(&vpi_ctx->frame_out_queue);
+    vpi_dec_buf_ring_init(&vpi_ctx->frame_stored_free);
+    vpi_dec_buf_ring_init(&vpi_ctx->frame_stored_queue);
     for (i = 0; i < MAX_BUFFERS; i++) {
         vpi_ctx->frame_buf_list[i] = malloc(sizeof(BufLink));
         if (NULL == vpi_ctx->frame_buf_list[i]) {
@@ -206,8 +258,10 @@ static VpiRet vpi_dec_init_decoder(VpiDecCtx *vpi_ctx, void *cfg)
         vpi_ctx->frame_buf_list[i]->mem_idx = 0xFFFFFFFF;
         vpi_ctx->frame_buf_list[i]->used    = 0;
         vpi_ctx->frame_buf_list[i]->next    = NULL;
+        vpi_dec_buf_ring_push(&vpi_ctx->frame_free_queue,
+                              vpi_ctx->frame_buf_list[i]);
     }
-    vpi_ctx->frame_stored_num = 2 * MAX_BUFFERS;
+    vpi_ctx->frame_stored_num = MAX_STORED_BUFFERS;
     for (i = 0; i < vpi_ctx->frame_stored_num; i++) {
         vpi_ctx->frame_stored_list[i] = malloc(sizeof(BufLink));
         if (NULL == vpi_ctx->frame_stored_list[i]) {
@@ -218,6 +272,8 @@ static VpiRet vpi_dec_init_decoder(VpiDecCtx *vpi_ctx, void *cfg)
         vpi_ctx->frame_stored_list[i]->mem_idx = 0xFFFFFFFF;
         vpi_ctx->frame_stored_list[i]->used    = 0;
         vpi_ctx->frame_stored_list[i]->next    = NULL;
+        vpi_dec_buf_ring_push(&vpi_ctx->frame_stored_free,
+                              vpi_ctx->frame_stored_list[i]);
     }
     for (i = 0; i < 32; i++) {
         vpi_ctx->rls_strm_buf_list[i] = malloc(sizeof(BufLink));
@@ -229,9 +285,6 @@ static VpiRet vpi_dec_init_decoder(VpiDecCtx *vpi_ctx, void *cfg)
         vpi_ctx->rls_strm_buf_list[i]->next    = NULL;
         vpi_ctx->rls_strm_buf_list[i]->item    = NULL;
     }
-    vpi_ctx->strm_buf_head       = NULL;
-    vpi_ctx->frame_buf_head      = NULL;
-    vpi_ctx->rls_strm_buf_head   = NULL;
     vpi_ctx->stream_mem_index    = 0;
     vpi_ctx->rls_mem_index       = 0;
     vpi_ctx->pic_decode_number   = 1;
@@ -243,14 +296,17 @@ static VpiRet vpi_dec_init_decoder(VpiDecCtx *vpi_ctx, void *cfg)
     vpi_ctx->output_num          = 0;
     vpi_ctx->first_pts           = -1;
 
-    for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-        vpi_ctx->time_stamp_info[i].pts     = VID_NOPTS_VALUE;
-        vpi_ctx->time_stamp_info[i].pkt_dts = VID_NOPTS_VALUE;
-        vpi_ctx->time_stamp_info[i].used    = 0;
-    }
+    vpi_dec_init_pts_dts(vpi_ctx);
     vpi_ctx->waiting_for_dpb = 0;
     pthread_mutex_init(&vpi_ctx->dec_thread_mutex, NULL);
     pthread_cond_init(&vpi_ctx->dec_thread_cond, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&vpi_ctx->dec_work_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    vpi_ctx->dec_work_pending  = 0;
+    vpi_ctx->dec_wakeup_number = 0;
+    vpi_ctx->dec_idle_time     = 0;
     vpi_ctx->dec_thread_finish = 0;
     ret = pthread_create(&vpi_ctx->dec_thread_handle, NULL, decode_process,
                          vpi_ctx);
@@ -336,6 +392,83 @@ int vpi_vdec_put_packet(VpiDecCtx *vpi_ctx, void *indata)
     return ret;
 }
 
+/**
+ * vpi_vdec_put_packets
+ * Queue several packets under one lock. Consecutive small packets are
+ * packed and copied to the EP with a single eDMA transfer.
+ * @Params: vpi_ctx: decoder context
+ *          packets: packets to queue, in decoding order
+ *          num: number of packets
+ * @Return: number of packets queued, which is less than num when the
+ *          stream slots are full, negative value on error
+ */
+int vpi_vdec_put_packets(VpiDecCtx *vpi_ctx, VpiPacket *packets, int num)
+{
+    BufLink *links[MAX_STRM_BUFFERS];
+    uint32_t batch_size = 0;
+    int batch_num       = 0;
+    int queued          = 0;
+    int ret             = 0;
+    int idx;
+
+    pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
+    while (queued < num) {
+        VpiPacket *pkt = &packets[queued];
+
+        if (pkt->size > 0 && batch_num &&
+            batch_size + pkt->size > STRM_BATCH_MAX_SIZE) {
+            if (batch_num > 1) {
+                vpi_dec_load_stream_batch(vpi_ctx, links, batch_num);
+            }
+            batch_num  = 0;
+            batch_size = 0;
+        }
+
+        idx = vpi_ctx->stream_mem_index;
+        switch (vpi_ctx->dec_fmt) {
+        case Dec_H264_H10P:
+            ret = vpi_decode_h264_queue_packet(vpi_ctx, pkt);
+            break;
+        case Dec_HEVC:
+            ret = vpi_decode_hevc_queue_packet(vpi_ctx, pkt);
+            break;
+        case Dec_VP9:
+            ret = vpi_decode_vp9_queue_packet(vpi_ctx, pkt);
+            break;
+        default:
+            VPILOGW("Unknown/Not supported format %d", vpi_ctx->dec_fmt);
+            ret = VPI_ERR_SW;
+        }
+        if (ret < 0) {
+            break;
+        }
+        if (pkt->size == 0) {
+            /* EOS ends the batch whether it was queued or not */
+            queued += vpi_ctx->eos_received;
+            break;
+        }
+        if (ret == 0) {
+            /* no free stream slot */
+            break;
+        }
+
+        queued++;
+        if (pkt->size <= STRM_BATCH_MAX_SIZE) {
+            links[batch_num++] = vpi_ctx->strm_buf_list[idx];
+            batch_size += pkt->size;
+        }
+    }
+    if (batch_num > 1) {
+        vpi_dec_load_stream_batch(vpi_ctx, links, batch_num);
+    }
+    pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
+
+    if (ret < 0 && queued == 0) {
+        return ret;
+    }
+    return queued;
+}
+
 int vpi_vdec_get_frame(VpiDecCtx *vpi_ctx, void *outdata)
 {
     int ret = VPI_SUCCESS;
@@ -410,11 +543,15 @@ VpiRet vpi_vdec_close(VpiDecCtx *vpi_ctx)
         pthread_cond_signal(&vpi_ctx->dec_thread_cond);
         vpi_ctx->waiting_for_dpb = 0;
     }
+    if (vpi_ctx->init_finish == 1) {
+        vpi_dec_wakeup_worker(vpi_ctx);
+    }
     pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
 
     if (vpi_ctx->init_finish == 1) {
         pthread_join(vpi_ctx->dec_thread_handle, NULL);
         pthread_cond_destroy(&vpi_ctx->dec_thread_cond);
+        pthread_cond_destroy(&vpi_ctx->dec_work_cond);
         pthread_mutex_destroy(&vpi_ctx->dec_thread_mutex);
     }
 
@@ -432,6 +569,12 @@ VpiRet vpi_vdec_close(VpiDecCtx *vpi_ctx)
         VPILOGW("Unknown/Not supported format %d", vpi_ctx->dec_fmt);
         ret = VPI_ERR_SW;
     }
+    if (vpi_ctx->strm_batch_buf) {
+        VPILOGD("%u packets loaded in %u batches\n",
+                vpi_ctx->strm_batch_pkt_number, vpi_ctx->strm_batch_number);
+        free(vpi_ctx->strm_batch_buf);
+        vpi_ctx->strm_batch_buf = NULL;
+    }
 
     return ret;
 }
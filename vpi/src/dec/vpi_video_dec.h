@@ -94,6 +94,16 @@ extern "C" {
  */
 #define MAX_STRM_BUFFERS (MAX_ASIC_CORES + 1)
 #define MAX_PTS_DTS_DEPTH 78
+#define MAX_STORED_BUFFERS (2 * MAX_BUFFERS)
+/* capacity of a BufRing, power of two and not less than any slot array */
+#define BUF_RING_DEPTH 256
+#define STRM_POOL_DEPTH (MAX_STRM_BUFFERS + 4)
+#define STRM_POOL_MIN_SIZE (1 * 1024 * 1024)
+#define STRM_POOL_RESERVE_NUM 2
+#define STRM_BATCH_MAX_SIZE STRM_POOL_MIN_SIZE
+/* upper bound of one idle wait of the decode thread, it only matters when
+ * the decoder library has pending output that no API call will signal */
+#define DEC_WORKER_IDLE_TIMEOUT_MS 10
 
 #ifdef FB_SYSLOG_ENABLE
 #include "syslog_sink.h"
@@ -137,8 +147,28 @@ typedef struct BufLink {
     struct BufLink *next;
     int64_t pts;
     int64_t pkt_dts;
+    uint32_t strm_idx;    /* stream slot whose EP buffer holds the data */
+    uint32_t strm_offset; /* offset of the data in that buffer */
+    int strm_loaded;      /* data already copied by a batched put */
 }BufLink;
 
+/* spare EP stream buffers shared by all stream slots, allocated in
+ * power-of-two size classes so that a slot never reallocates in place */
+typedef struct StrmBufPool {
+    struct DWLLinearMem mem[STRM_POOL_DEPTH];
+    uint32_t num;
+    uint32_t alloc_number;     /* EP allocations done by the pool */
+    uint32_t hot_alloc_number; /* of which done while queueing a packet */
+    uint32_t swap_number;
+} StrmBufPool;
+
+/* fixed-capacity FIFO of BufLink slots */
+typedef struct BufRing {
+    BufLink *slot[BUF_RING_DEPTH];
+    uint32_t head;
+    uint32_t count;
+} BufRing;
+
 struct DecOutput {
     uint8_t *strm_curr_pos;
     addr_t strm_curr_bus_address;
@@ -153,13 +183,37 @@ typedef struct VpiDecPicWaitForConsume {
     uint8_t wait_for_consume;
 } VpiDecPicWaitForConsume;
 
+#define TS_HASH_BITS 7
+#define TS_HASH_SIZE (1 << TS_HASH_BITS)
+#define TS_INVALID_ID 0xFFFFFFFF
+
 typedef struct TimeStampInfo {
     int64_t pts;
     int64_t pkt_dts;
-    uint32_t decode_id;
+    uint32_t decode_id; /* TS_INVALID_ID until the packet is decoded */
+    uint32_t seq;       /* insertion order, to pick the oldest of equals */
     int used;
+    int16_t heap_pos;
 } TimeStampInfo;
 
+/* packet timestamps waiting for their picture: chained by pts, dts and
+ * decode_id, with a min-heap by decode_id to pick the eviction victim */
+typedef struct TimeStampTracker {
+    TimeStampInfo info[MAX_PTS_DTS_DEPTH];
+    int16_t free_list[MAX_PTS_DTS_DEPTH];
+    int16_t free_num;
+    int16_t pts_head[TS_HASH_SIZE];
+    int16_t dts_head[TS_HASH_SIZE];
+    int16_t id_head[TS_HASH_SIZE];
+    int16_t pts_next[MAX_PTS_DTS_DEPTH];
+    int16_t dts_next[MAX_PTS_DTS_DEPTH];
+    int16_t id_next[MAX_PTS_DTS_DEPTH];
+    int16_t heap[MAX_PTS_DTS_DEPTH];
+    int16_t heap_num;
+    uint32_t seq;
+    uint32_t evicted_num;
+} TimeStampTracker;
+
 struct VpiDecWrapper {
     void *inst;
     VpiRet (*init)(const void **inst, struct DecConfig config, const void *dwl);
@@ -250,10 +304,13 @@ typedef struct VpiDecCtx {
     uint32_t min_buffer_num;
     struct DWLLinearMem ext_buffers[MAX_BUFFERS];
     uint32_t buffer_consumed[MAX_BUFFERS];
-    BufLink *frame_buf_head;
     BufLink *frame_buf_list[MAX_BUFFERS];
-    uint32_t frame_buf_list_idx;
-    BufLink *frame_stored_list[200];
+    BufRing frame_free_queue; /* slots not holding any frame */
+    BufRing frame_idle_queue; /* frames waiting for a decoded picture */
+    BufRing frame_out_queue;  /* decoded pictures waiting for get_frame */
+    BufLink *frame_stored_list[MAX_STORED_BUFFERS];
+    BufRing frame_stored_free;
+    BufRing frame_stored_queue; /* frames still locked by consumers */
     uint32_t frame_stored_num;
     int max_frames_delay;
     int output_num;
@@ -270,13 +327,17 @@ typedef struct VpiDecCtx {
     uint32_t stream_mem_index;
     struct DWLLinearMem stream_mem[MAX_STRM_BUFFERS];
     uint32_t stream_mem_used[MAX_STRM_BUFFERS];
-    BufLink *strm_buf_head;
+    StrmBufPool strm_pool;
+    uint8_t *strm_batch_buf; /* host staging buffer of batched puts */
+    uint32_t strm_batch_number;
+    uint32_t strm_batch_pkt_number;
     BufLink *strm_buf_list[MAX_STRM_BUFFERS];
-    TimeStampInfo time_stamp_info[MAX_PTS_DTS_DEPTH];
+    BufRing strm_buf_queue;
+    TimeStampTracker ts_tracker;
     uint32_t eos_received;
     uint32_t eos_handled;
-    BufLink *rls_strm_buf_head;
     BufLink *rls_strm_buf_list[32];
+    BufRing rls_strm_buf_queue;
     uint32_t rls_mem_index;
     int eos_flush;
     int64_t last_pts;
@@ -289,6 +350,8 @@ typedef struct VpiDecCtx {
     uint32_t got_package_number;
     uint32_t last_pic_flag;
     uint32_t max_num_pics;
+    uint32_t dec_wakeup_number;
+    uint64_t dec_idle_time; /* in us */
 
     // decode status
     uint32_t pic_rdy;
@@ -307,6 +370,8 @@ typedef struct VpiDecCtx {
     pthread_cond_t dec_thread_cond;
     int waiting_for_dpb;
     int dec_thread_finish;
+    pthread_cond_t dec_work_cond;
+    int dec_work_pending;
 
     // pic info
     struct DecPicturePpu pic;
@@ -340,9 +405,11 @@ typedef struct VpiDecCtx {
 VpiRet vpi_vdec_init(VpiDecCtx *, void *);
 int vpi_vdec_decode(VpiDecCtx *, void *, void *);
 int vpi_vdec_put_packet(VpiDecCtx *, void *);
+int vpi_vdec_put_packets(VpiDecCtx *, VpiPacket *, int);
 int vpi_vdec_get_frame(VpiDecCtx *, void *);
 VpiRet vpi_vdec_control(VpiDecCtx *, void *, void *);
 VpiRet vpi_vdec_close(VpiDecCtx *);
+void vpi_dec_wakeup_worker(VpiDecCtx *vpi_ctx);
 
 #ifdef __cplusplus
 }
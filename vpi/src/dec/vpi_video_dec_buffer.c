@@ -36,33 +36,110 @@
 #include "vpi_video_dec_picture_consume.h"
 #include "vpi_video_dec_info.h"
 
-void vpi_dec_buf_list_add(BufLink **head, BufLink *list)
+void vpi_dec_buf_ring_init(BufRing *ring)
 {
-    BufLink *temp;
+    ring->head  = 0;
+    ring->count = 0;
+}
 
-    if(NULL == *head) {
-        *head = list;
-        (*head)->next = NULL;
-    } else {
-        temp = *head;
-        while(temp) {
-            if(NULL == temp->next) {
-                temp->next = list;
-                list->next = NULL;
-                return;
-            }
-            temp = temp->next;
-        }
+int vpi_dec_buf_ring_push(BufRing *ring, BufLink *link)
+{
+    if (ring->count == BUF_RING_DEPTH) {
+        return -1;
     }
+    ring->slot[(ring->head + ring->count) & (BUF_RING_DEPTH - 1)] = link;
+    ring->count++;
+    return 0;
 }
 
-BufLink* vpi_dec_buf_list_delete(BufLink *head)
+BufLink *vpi_dec_buf_ring_pop(BufRing *ring)
 {
-    if (NULL == head || NULL == head->next) {
+    BufLink *link;
+
+    if (ring->count == 0) {
         return NULL;
     }
+    link       = ring->slot[ring->head];
+    ring->head = (ring->head + 1) & (BUF_RING_DEPTH - 1);
+    ring->count--;
+    return link;
+}
 
-    return head->next;
+BufLink *vpi_dec_buf_ring_peek(BufRing *ring)
+{
+    if (ring->count == 0) {
+        return NULL;
+    }
+    return ring->slot[ring->head];
+}
+
+/**
+ *  vpi_dec_store_frame_buffer
+ *  Take a frame from the application, it is queued for the next decoded
+ *  picture and kept locked until all of its consumers are done with it.
+ *  Must be called with dec_thread_mutex held.
+ *
+ *  @Params: vpi_ctx The context of Vpi decoder
+ *  @Params: vpi_frame The frame handed in by VPI_CMD_DEC_SET_FRAME_BUFFER
+ *  @Return: 0 for success, -1 for error
+ */
+int vpi_dec_store_frame_buffer(VpiDecCtx *vpi_ctx, VpiFrame *vpi_frame)
+{
+    BufLink *buf;
+    int ret = 0;
+
+    buf = vpi_dec_buf_ring_pop(&vpi_ctx->frame_free_queue);
+    if (buf == NULL) {
+        VPILOGE("no valid frame buffer to store buffer info\n");
+        ret = -1;
+    } else {
+        buf->used = 1;
+        buf->item = vpi_frame;
+        vpi_dec_buf_ring_push(&vpi_ctx->frame_idle_queue, buf);
+    }
+    vpi_frame->locked     = 1;
+    vpi_frame->nb_outputs = 1;
+    vpi_frame->used_cnt   = 0;
+
+    buf = vpi_dec_buf_ring_pop(&vpi_ctx->frame_stored_free);
+    if (buf == NULL) {
+        VPILOGE("no valid frame buffer to store buffer info\n");
+        ret = -1;
+    } else {
+        buf->used = 1;
+        buf->item = vpi_frame;
+        vpi_dec_buf_ring_push(&vpi_ctx->frame_stored_queue, buf);
+    }
+
+    return ret;
+}
+
+/**
+ *  vpi_dec_release_stored_frames
+ *  Unlock the stored frames which have been used by all their consumers.
+ *  Must be called with dec_thread_mutex held.
+ *
+ *  @Params: vpi_ctx The context of Vpi decoder
+ */
+void vpi_dec_release_stored_frames(VpiDecCtx *vpi_ctx)
+{
+    uint32_t i, num = vpi_ctx->frame_stored_queue.count;
+    VpiFrame *vpi_frame;
+    BufLink *buf;
+
+    for (i = 0; i < num; i++) {
+        buf       = vpi_dec_buf_ring_pop(&vpi_ctx->frame_stored_queue);
+        vpi_frame = (VpiFrame *)buf->item;
+        if (vpi_frame->nb_outputs == vpi_frame->used_cnt &&
+            vpi_frame->locked == 1) {
+            vpi_frame->locked = 0;
+            buf->used         = 0;
+            buf->item         = NULL;
+            vpi_dec_buf_ring_push(&vpi_ctx->frame_stored_free, buf);
+        } else {
+            vpi_dec_buf_ring_push(&vpi_ctx->frame_stored_queue, buf);
+        }
+    }
 }
 
 int vpi_send_packet_to_decode_buffer(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet,
@@ -82,6 +159,72 @@ int vpi_send_packet_to_decode_buffer(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet,
     return ret;
 }
 
+/**
+ * vpi_dec_load_stream_batch
+ * Copy the data of several queued packets with one eDMA transfer. The
+ * packets are packed into the EP buffer of the last one, which is the
+ * last to be released since the slots are consumed in order.
+ * Called with dec_thread_mutex held, before the worker sees the packets.
+ * @Params: vpi_ctx: decoder context
+ *          links: stream slots of the packets, in queueing order
+ *          num: number of packets, total size within STRM_BATCH_MAX_SIZE
+ * @Return: 0 for success, -1 if the packets are left for the worker to copy
+ */
+int vpi_dec_load_stream_batch(VpiDecCtx *vpi_ctx, BufLink **links, int num)
+{
+    uint32_t target = links[num - 1]->mem_idx;
+    uint32_t offset = 0;
+    int i;
+
+    if (vpi_ctx->strm_batch_buf == NULL) {
+        vpi_ctx->strm_batch_buf = malloc(STRM_BATCH_MAX_SIZE);
+        if (vpi_ctx->strm_batch_buf == NULL) {
+            return -1;
+        }
+    }
+    for (i = 0; i < num; i++) {
+        memcpy(vpi_ctx->strm_batch_buf + offset, links[i]->item,
+               links[i]->item_size);
+        offset += links[i]->item_size;
+    }
+
+#ifdef NEW_MEM_ALLOC
+    if (dwl_edma_rc2ep_nolink(vpi_ctx->dwl_inst,
+                              (uint64_t)vpi_ctx->strm_batch_buf,
+                              vpi_ctx->stream_mem[target].bus_address,
+                              offset)) {
+        VPILOGE("batched stream transfer of %d bytes failed\n", offset);
+        return -1;
+    }
+#endif
+
+    offset = 0;
+    for (i = 0; i < num; i++) {
+        links[i]->strm_idx    = target;
+        links[i]->strm_offset = offset;
+        links[i]->strm_loaded = 1;
+        offset += links[i]->item_size;
+    }
+    vpi_ctx->strm_batch_number++;
+    vpi_ctx->strm_batch_pkt_number += num;
+    VPILOGD("%d packets, %d bytes loaded into stream slot %d\n", num, offset,
+            target);
+    return 0;
+}
+
+/* EP buffer view of a queued packet, as expected by the decode calls:
+ * the virtual address is the host packet data */
+struct DWLLinearMem vpi_dec_get_stream_input(VpiDecCtx *vpi_ctx,
+                                             BufLink *strm_buf)
+{
+    struct DWLLinearMem mem = vpi_ctx->stream_mem[strm_buf->strm_idx];
+
+    mem.virtual_address = (uint32_t *)strm_buf->item;
+    mem.bus_address    += strm_buf->strm_offset;
+    mem.size           -= strm_buf->strm_offset;
+    return mem;
+}
+
 int vpi_dec_get_stream_buffer_index(VpiDecCtx *vpi_ctx, int status)
 {
     int idx;
@@ -96,6 +239,183 @@ int vpi_dec_get_stream_buffer_index(VpiDecCtx *vpi_ctx, int status)
     return -1;
 }
 
+static uint32_t strm_pool_class_size(uint32_t size)
+{
+    uint32_t class_size = STRM_POOL_MIN_SIZE;
+
+    while (class_size < size && class_size < 0x80000000)
+        class_size <<= 1;
+    return class_size;
+}
+
+static int strm_pool_alloc(VpiDecCtx *vpi_ctx, uint32_t size,
+                           struct DWLLinearMem *mem)
+{
+    StrmBufPool *pool = &vpi_ctx->strm_pool;
+
+    mem->mem_type = DWL_MEM_TYPE_DPB;
+    if (DWLMallocLinear(vpi_ctx->dwl_inst, strm_pool_class_size(size), mem) !=
+        DWL_OK) {
+        VPILOGE("UNABLE TO ALLOCATE STREAM BUFFER MEMORY\n");
+        return -1;
+    }
+    pool->alloc_number++;
+    VPILOGD("stream pool alloc %d bytes\n", mem->size);
+    return 0;
+}
+
+static void strm_pool_free(VpiDecCtx *vpi_ctx, struct DWLLinearMem *mem)
+{
+    mem->virtual_address = NULL;
+    DWLFreeLinear(vpi_ctx->dwl_inst, mem);
+}
+
+/* give a buffer back to the pool, the smallest one is dropped if full */
+static void strm_pool_put(VpiDecCtx *vpi_ctx, struct DWLLinearMem *mem)
+{
+    StrmBufPool *pool = &vpi_ctx->strm_pool;
+    uint32_t i, min = 0;
+
+    if (pool->num < STRM_POOL_DEPTH) {
+        pool->mem[pool->num++] = *mem;
+        return;
+    }
+    for (i = 1; i < pool->num; i++) {
+        if (pool->mem[i].size < pool->mem[min].size)
+            min = i;
+    }
+    if (pool->mem[min].size < mem->size) {
+        strm_pool_free(vpi_ctx, &pool->mem[min]);
+        pool->mem[min] = *mem;
+    } else {
+        strm_pool_free(vpi_ctx, mem);
+    }
+}
+
+/* smallest pooled buffer which holds size bytes, -1 if none */
+static int strm_pool_best_fit(StrmBufPool *pool, uint32_t size)
+{
+    uint32_t i;
+    int best = -1;
+
+    for (i = 0; i < pool->num; i++) {
+        if (pool->mem[i].size >= size &&
+            (best == -1 || pool->mem[i].size < pool->mem[best].size))
+            best = i;
+    }
+    return best;
+}
+
+/**
+ * vpi_dec_strm_pool_reserve
+ * Make sure at least STRM_POOL_RESERVE_NUM stream buffers can hold an
+ * intra picture of this resolution, so that keyframes don't allocate
+ * EP memory when they are queued. Buffers already owned by the pool
+ * or by the stream slots are reused, e.g. after a resolution change.
+ * Called with dec_thread_mutex held, when the sequence header is parsed.
+ * @Params: vpi_ctx: decoder context
+ *          width, height: picture size from the sequence header
+ * @Return: 0 for success, -1 when EP memory can't be allocated
+ */
+int vpi_dec_strm_pool_reserve(VpiDecCtx *vpi_ctx, uint32_t width,
+                              uint32_t height)
+{
+    StrmBufPool *pool = &vpi_ctx->strm_pool;
+    struct DWLLinearMem mem;
+    uint32_t size, num = 0, i;
+
+    /* compressed intra pictures stay below one byte per luma sample */
+    size = strm_pool_class_size(width * height);
+    for (i = 0; i < vpi_ctx->allocated_buffers; i++) {
+        if (vpi_ctx->stream_mem[i].size >= size)
+            num++;
+    }
+    for (i = 0; i < pool->num; i++) {
+        if (pool->mem[i].size >= size)
+            num++;
+    }
+    while (num < STRM_POOL_RESERVE_NUM && pool->num < STRM_POOL_DEPTH) {
+        if (strm_pool_alloc(vpi_ctx, size, &mem))
+            return -1;
+        strm_pool_put(vpi_ctx, &mem);
+        num++;
+    }
+    VPILOGD("stream pool: %d buffers >= %d bytes for %dx%d\n", num, size,
+            width, height);
+    return 0;
+}
+
+/**
+ * vpi_dec_strm_pool_fit
+ * Make stream slot idx large enough for a packet of size bytes. The slot
+ * buffer is swapped with a pooled one or with an idle slot; EP memory is
+ * only allocated when neither fits, and then in a geometric size class.
+ * Called with dec_thread_mutex held, slot idx must not be queued.
+ * @Params: vpi_ctx: decoder context
+ *          idx: stream slot index
+ *          size: packet size
+ * @Return: 0 for success, -1 when EP memory can't be allocated
+ */
+int vpi_dec_strm_pool_fit(VpiDecCtx *vpi_ctx, uint32_t idx, uint32_t size)
+{
+    StrmBufPool *pool = &vpi_ctx->strm_pool;
+    struct DWLLinearMem *slot = &vpi_ctx->stream_mem[idx];
+    struct DWLLinearMem mem;
+    uint32_t i;
+    int best;
+
+    if (size <= slot->size)
+        return 0;
+
+    best = strm_pool_best_fit(pool, size);
+    if (best >= 0) {
+        mem              = pool->mem[best];
+        pool->mem[best]  = *slot;
+        *slot            = mem;
+        pool->swap_number++;
+        VPILOGD("stream slot %d takes pooled buffer of %d bytes\n", idx,
+                slot->size);
+        return 0;
+    }
+
+    for (i = 0; i < vpi_ctx->allocated_buffers; i++) {
+        if (i == idx || vpi_ctx->stream_mem_used[i] ||
+            vpi_ctx->strm_buf_list[i]->mem_idx != 0xFFFFFFFF ||
+            vpi_ctx->stream_mem[i].size < size)
+            continue;
+        mem                    = vpi_ctx->stream_mem[i];
+        vpi_ctx->stream_mem[i] = *slot;
+        *slot                  = mem;
+        pool->swap_number++;
+        VPILOGD("stream slot %d takes buffer of idle slot %d\n", idx, i);
+        return 0;
+    }
+
+    VPILOGD("packet size is too large(%d > %d @%d), re-allocing\n",
+            size, slot->size, idx);
+    if (strm_pool_alloc(vpi_ctx, size, &mem))
+        return -1;
+    pool->hot_alloc_number++;
+    strm_pool_put(vpi_ctx, slot);
+    *slot = mem;
+    return 0;
+}
+
+void vpi_dec_strm_pool_release(VpiDecCtx *vpi_ctx)
+{
+    StrmBufPool *pool = &vpi_ctx->strm_pool;
+    uint32_t i;
+
+    VPILOGD("stream pool: %d allocs, %d while queueing, %d swaps\n",
+            pool->alloc_number, pool->hot_alloc_number, pool->swap_number);
+    if (vpi_ctx->dec_inst) {
+        for (i = 0; i < pool->num; i++) {
+            strm_pool_free(vpi_ctx, &pool->mem[i]);
+        }
+    }
+    pool->num = 0;
+}
+
 static uint32_t vpi_dec_find_ext_buffer_index(VpiDecCtx *vpi_ctx, addr_t addr)
 {
     uint32_t i;
@@ -221,46 +541,278 @@ err_exit:
     return -1;
 }
 
+static uint32_t ts_hash(int64_t v)
+{
+    return (uint32_t)(((uint64_t)v * 0x9E3779B97F4A7C15ULL) >> (64 - TS_HASH_BITS));
+}
+
+static void ts_chain_add(int16_t *head, int16_t *next, uint32_t bucket, int idx)
+{
+    next[idx]    = head[bucket];
+    head[bucket] = idx;
+}
+
+static void ts_chain_del(int16_t *head, int16_t *next, uint32_t bucket, int idx)
+{
+    int16_t *link = &head[bucket];
+
+    while (*link != -1) {
+        if (*link == idx) {
+            *link = next[idx];
+            break;
+        }
+        link = &next[*link];
+    }
+    next[idx] = -1;
+}
+
+static int ts_heap_less(TimeStampTracker *ts, int a, int b)
+{
+    TimeStampInfo *x = &ts->info[ts->heap[a]];
+    TimeStampInfo *y = &ts->info[ts->heap[b]];
+
+    if (x->decode_id != y->decode_id)
+        return x->decode_id < y->decode_id;
+    return (int32_t)(x->seq - y->seq) < 0;
+}
+
+static void ts_heap_swap(TimeStampTracker *ts, int a, int b)
+{
+    int16_t tmp = ts->heap[a];
+
+    ts->heap[a] = ts->heap[b];
+    ts->heap[b] = tmp;
+    ts->info[ts->heap[a]].heap_pos = a;
+    ts->info[ts->heap[b]].heap_pos = b;
+}
+
+static void ts_heap_fix(TimeStampTracker *ts, int pos)
+{
+    int child;
+
+    while (pos > 0 && ts_heap_less(ts, pos, (pos - 1) / 2)) {
+        ts_heap_swap(ts, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+    for (;;) {
+        child = 2 * pos + 1;
+        if (child >= ts->heap_num)
+            break;
+        if (child + 1 < ts->heap_num && ts_heap_less(ts, child + 1, child))
+            child++;
+        if (!ts_heap_less(ts, child, pos))
+            break;
+        ts_heap_swap(ts, pos, child);
+        pos = child;
+    }
+}
+
+static void ts_release(TimeStampTracker *ts, int idx)
+{
+    TimeStampInfo *info = &ts->info[idx];
+    int pos             = info->heap_pos;
+
+    if (!info->used)
+        return;
+
+    if (info->pts != VID_NOPTS_VALUE)
+        ts_chain_del(ts->pts_head, ts->pts_next, ts_hash(info->pts), idx);
+    if (info->pkt_dts != VID_NOPTS_VALUE)
+        ts_chain_del(ts->dts_head, ts->dts_next, ts_hash(info->pkt_dts), idx);
+    ts_chain_del(ts->id_head, ts->id_next,
+                 info->decode_id & (TS_HASH_SIZE - 1), idx);
+
+    ts->heap_num--;
+    if (pos != ts->heap_num) {
+        ts_heap_swap(ts, pos, ts->heap_num);
+        ts_heap_fix(ts, pos);
+    }
+
+    info->used     = 0;
+    info->heap_pos = -1;
+    ts->free_list[ts->free_num++] = idx;
+}
+
+static void ts_set(TimeStampTracker *ts, int idx, int64_t pts, int64_t dts)
+{
+    TimeStampInfo *info = &ts->info[idx];
+
+    if (info->pts != VID_NOPTS_VALUE)
+        ts_chain_del(ts->pts_head, ts->pts_next, ts_hash(info->pts), idx);
+    if (info->pkt_dts != VID_NOPTS_VALUE)
+        ts_chain_del(ts->dts_head, ts->dts_next, ts_hash(info->pkt_dts), idx);
+
+    info->pts     = pts;
+    info->pkt_dts = dts;
+    if (pts != VID_NOPTS_VALUE)
+        ts_chain_add(ts->pts_head, ts->pts_next, ts_hash(pts), idx);
+    if (dts != VID_NOPTS_VALUE)
+        ts_chain_add(ts->dts_head, ts->dts_next, ts_hash(dts), idx);
+}
+
+static void ts_set_decode_id(TimeStampTracker *ts, int idx, uint32_t id)
+{
+    TimeStampInfo *info = &ts->info[idx];
+
+    ts_chain_del(ts->id_head, ts->id_next,
+                 info->decode_id & (TS_HASH_SIZE - 1), idx);
+    info->decode_id = id;
+    ts_chain_add(ts->id_head, ts->id_next, id & (TS_HASH_SIZE - 1), idx);
+    ts_heap_fix(ts, info->heap_pos);
+}
+
+/* take a free entry; when the table is full, drop the entry with the
+ * smallest decode_id, i.e. the oldest picture which never got output */
+static int ts_alloc(VpiDecCtx *vpi_ctx)
+{
+    TimeStampTracker *ts = &vpi_ctx->ts_tracker;
+    TimeStampInfo *info;
+    int idx;
+
+    if (ts->free_num == 0) {
+        idx  = ts->heap[0];
+        info = &ts->info[idx];
+        VPILOGE("No empty pos to store pts/dts, drop pts %ld, dts %ld, id %u\n",
+                info->pts, info->pkt_dts, info->decode_id);
+        ts_release(ts, idx);
+        ts->evicted_num++;
+    }
+
+    idx  = ts->free_list[--ts->free_num];
+    info = &ts->info[idx];
+    info->used      = 1;
+    info->pts       = VID_NOPTS_VALUE;
+    info->pkt_dts   = VID_NOPTS_VALUE;
+    info->decode_id = TS_INVALID_ID;
+    info->seq       = ts->seq++;
+    ts_chain_add(ts->id_head, ts->id_next,
+                 TS_INVALID_ID & (TS_HASH_SIZE - 1), idx);
+
+    info->heap_pos = ts->heap_num;
+    ts->heap[ts->heap_num++] = idx;
+    ts_heap_fix(ts, info->heap_pos);
+
+    return idx;
+}
+
+/* find the oldest live entry carrying this timestamp, prefer the ones
+ * whose picture is not decoded yet; returns -1 if none, count is the
+ * number of live entries with this timestamp */
+static int ts_find(TimeStampTracker *ts, int16_t *head, int16_t *next,
+                   int64_t v, int use_pts, int *count)
+{
+    TimeStampInfo *info, *best = NULL;
+    int idx, found = -1, num = 0;
+
+    for (idx = head[ts_hash(v)]; idx != -1; idx = next[idx]) {
+        info = &ts->info[idx];
+        if ((use_pts ? info->pts : info->pkt_dts) != v)
+            continue;
+        num++;
+        if (best == NULL ||
+            (best->decode_id != TS_INVALID_ID &&
+             info->decode_id == TS_INVALID_ID) ||
+            ((best->decode_id == TS_INVALID_ID) ==
+             (info->decode_id == TS_INVALID_ID) &&
+             (int32_t)(info->seq - best->seq) < 0)) {
+            best  = info;
+            found = idx;
+        }
+    }
+    if (count)
+        *count = num;
+    return found;
+}
+
+static int ts_find_pts(TimeStampTracker *ts, int64_t pts, int *count)
+{
+    return ts_find(ts, ts->pts_head, ts->pts_next, pts, 1, count);
+}
+
+static int ts_find_dts(TimeStampTracker *ts, int64_t dts)
+{
+    return ts_find(ts, ts->dts_head, ts->dts_next, dts, 0, NULL);
+}
+
+static int ts_find_decode_id(TimeStampTracker *ts, uint32_t id)
+{
+    TimeStampInfo *info;
+    int idx, found = -1;
+
+    for (idx = ts->id_head[id & (TS_HASH_SIZE - 1)]; idx != -1;
+         idx = ts->id_next[idx]) {
+        info = &ts->info[idx];
+        if (info->decode_id != id)
+            continue;
+        if (found == -1 || (int32_t)(info->seq - ts->info[found].seq) < 0)
+            found = idx;
+    }
+    return found;
+}
+
+/* entry of the packet being decoded, looked up by pts, or by dts when
+ * the packet has no pts */
+static int ts_find_cur_pkt(VpiDecCtx *vpi_ctx)
+{
+    TimeStampTracker *ts = &vpi_ctx->ts_tracker;
+
+    if (vpi_ctx->cur_pkt_pts != VID_NOPTS_VALUE)
+        return ts_find_pts(ts, vpi_ctx->cur_pkt_pts, NULL);
+    if (vpi_ctx->cur_pkt_dts != VID_NOPTS_VALUE)
+        return ts_find_dts(ts, vpi_ctx->cur_pkt_dts);
+    return -1;
+}
+
 static void dump_dec_pts_dts(VpiDecCtx *vpi_ctx)
 {
+    TimeStampTracker *ts = &vpi_ctx->ts_tracker;
+    int i;
+
+    VPILOGD("dec_pts_dts: %d used, %u evicted\n", ts->heap_num,
+            ts->evicted_num);
+    for (i = 0; i < ts->heap_num; i++) {
+        TimeStampInfo *info = &ts->info[ts->heap[i]];
+        VPILOGD("dec_pts_dts[%d] pts %ld, dts %ld, id %d\n", ts->heap[i],
+                info->pts, info->pkt_dts, info->decode_id);
+    }
+}
+
+void vpi_dec_init_pts_dts(VpiDecCtx *vpi_ctx)
+{
+    TimeStampTracker *ts = &vpi_ctx->ts_tracker;
     int i;
 
+    memset(ts, 0, sizeof(*ts));
+    for (i = 0; i < TS_HASH_SIZE; i++) {
+        ts->pts_head[i] = -1;
+        ts->dts_head[i] = -1;
+        ts->id_head[i]  = -1;
+    }
     for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-        VPILOGD("dec_pts_dts[%d] %s, pts %ld, dts %ld, id %d\n", i,
-            vpi_ctx->time_stamp_info[i].used ? "used" : "unused",
-            vpi_ctx->time_stamp_info[i].pts,
-            vpi_ctx->time_stamp_info[i].pkt_dts,
-            vpi_ctx->time_stamp_info[i].decode_id);
+        ts->info[i].pts      = VID_NOPTS_VALUE;
+        ts->info[i].pkt_dts  = VID_NOPTS_VALUE;
+        ts->info[i].heap_pos = -1;
+        ts->pts_next[i]      = -1;
+        ts->dts_next[i]      = -1;
+        ts->id_next[i]       = -1;
+        ts->free_list[i]     = MAX_PTS_DTS_DEPTH - 1 - i;
     }
+    ts->free_num = MAX_PTS_DTS_DEPTH;
 }
 
 int vpi_dec_set_pts_decid(VpiDecCtx *vpi_ctx)
 {
-    int i;
+    int idx;
 
     if (vpi_ctx->cur_pkt_pts == VID_NOPTS_VALUE &&
         vpi_ctx->cur_pkt_dts == VID_NOPTS_VALUE) {
         return 0;
     }
 
-    if (vpi_ctx->cur_pkt_pts != VID_NOPTS_VALUE) {
-        for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-            if (vpi_ctx->time_stamp_info[i].pts == vpi_ctx->cur_pkt_pts) {
-                vpi_ctx->time_stamp_info[i].decode_id =
-                                    vpi_ctx->pic_decode_number;
-                return 0;
-            }
-        }
-    } else {
-        if (vpi_ctx->cur_pkt_dts != VID_NOPTS_VALUE) {
-            for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-                if (vpi_ctx->time_stamp_info[i].pkt_dts == vpi_ctx->cur_pkt_dts) {
-                    vpi_ctx->time_stamp_info[i].decode_id =
-                                        vpi_ctx->pic_decode_number;
-                    return 0;
-                }
-            }
-        }
+    idx = ts_find_cur_pkt(vpi_ctx);
+    if (idx >= 0) {
+        ts_set_decode_id(&vpi_ctx->ts_tracker, idx, vpi_ctx->pic_decode_number);
+        return 0;
     }
 
     VPILOGD("Can't find matched pts %lld, dts %lld\n",
@@ -270,28 +822,17 @@ int vpi_dec_set_pts_decid(VpiDecCtx *vpi_ctx)
 
 void vpi_dec_clear_unused_pts(VpiDecCtx *vpi_ctx)
 {
-    int i;
+    int idx;
 
     if (vpi_ctx->cur_pkt_pts == VID_NOPTS_VALUE &&
         vpi_ctx->cur_pkt_dts == VID_NOPTS_VALUE) {
         return;
     }
-    if (vpi_ctx->cur_pkt_pts != VID_NOPTS_VALUE) {
-        for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-            if (vpi_ctx->time_stamp_info[i].pts == vpi_ctx->cur_pkt_pts) {
-                vpi_ctx->time_stamp_info[i].used = -1;
-                return;
-            }
-        }
-    } else {
-        if (vpi_ctx->cur_pkt_dts != VID_NOPTS_VALUE) {
-            for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-                if (vpi_ctx->time_stamp_info[i].pkt_dts == vpi_ctx->cur_pkt_dts) {
-                    vpi_ctx->time_stamp_info[i].used = -1;
-                    return;
-                }
-            }
-        }
+
+    idx = ts_find_cur_pkt(vpi_ctx);
+    if (idx >= 0) {
+        ts_release(&vpi_ctx->ts_tracker, idx);
+        return;
     }
     VPILOGD("Can't find matched pts %lld, dts %lld\n",
              vpi_ctx->cur_pkt_pts, vpi_ctx->cur_pkt_dts);
@@ -300,120 +841,47 @@ void vpi_dec_clear_unused_pts(VpiDecCtx *vpi_ctx)
 
 int vpi_dec_set_pts_dts(VpiDecCtx *vpi_ctx, VpiPacket *pkt)
 {
-    int i;
-    int empty_index;
+    TimeStampTracker *ts = &vpi_ctx->ts_tracker;
     int pn_count;
     int frame_index;
 
-    for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-        if (vpi_ctx->time_stamp_info[i].used == 0) {
-            break;
+    if (vpi_ctx->dec_fmt == Dec_VP9 && pkt->size == 1) {
+        uint8_t marker = pkt->data[0];
+        VPILOGD("marker = 0x%x\n", marker);
+        if (!(marker & 0x8)) {
+            VPILOGE("unknown case\n");
+            goto err_exit;
         }
-    }
-    if (i == MAX_PTS_DTS_DEPTH) {
-        uint32_t min_dec_id;
-        int min_index;
-
-        VPILOGE("No empty pos to store pts/dts\n");
-        min_dec_id = vpi_ctx->time_stamp_info[0].decode_id;
-        min_index = 0;
-        for (i = 1; i < MAX_PTS_DTS_DEPTH; i++) {
-            if (vpi_ctx->time_stamp_info[i].used &&
-                vpi_ctx->time_stamp_info[i].decode_id < min_dec_id) {
-                min_dec_id = vpi_ctx->time_stamp_info[i].decode_id;
-                min_index = i;
-            }
+        /* PN frame, to find pts -1 */
+        frame_index = ts_find_pts(ts, -1, &pn_count);
+        if (pn_count == 0) {
+            VPILOGE("can't find match frame\n");
+            return 0;
         }
-        i = min_index;
-        vpi_ctx->time_stamp_info[i].used = 0;
-    }
-    empty_index = i;
-
-    if (vpi_ctx->dec_fmt == Dec_VP9) {
-        if (pkt->size == 1) {
-            uint8_t marker = pkt->data[0];
-            VPILOGD("marker = 0x%x\n", marker);
-            if (marker & 0x8) {
-                /* PN frame, to find pts -1 */
-                pn_count = 0;
-                for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-                    if (vpi_ctx->time_stamp_info[i].used == 1 &&
-                        vpi_ctx->time_stamp_info[i].pts == -1) {
-                        if (pn_count == 0)
-                            frame_index = i;
-                        pn_count++;
-                    }
-                }
-                if (pn_count == 0) {
-                    VPILOGE("can't find match frame\n");
-                    return 0;
-                }
-                if (pn_count > 1) {
-                    VPILOGE("can't decide match frame\n");
-                    goto err_exit;
-                }
-                VPILOGD("frame_index = %d\n", frame_index);
-                vpi_ctx->time_stamp_info[frame_index].pts       = pkt->pts;
-                vpi_ctx->time_stamp_info[frame_index].pkt_dts   = pkt->pkt_dts;
-                //vpi_ctx->time_stamp_info[frame_index].decode_id =
-                //                               vpi_ctx->got_package_number + 1;
-                dump_dec_pts_dts(vpi_ctx);
-            } else {
-                VPILOGE("unknown case\n");
-                goto err_exit;
-            }
-        } else {
-            vpi_ctx->time_stamp_info[empty_index].used = 1;
-            if (pkt->pts == vpi_ctx->last_pts &&
-                pkt->pts != VID_NOPTS_VALUE &&
-                vpi_ctx->got_package_number != 0) {
-                /* mark before same pts as -1 wait PN frame */
-                for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-                    if (vpi_ctx->time_stamp_info[i].used == 1 &&
-                        vpi_ctx->time_stamp_info[i].pts == pkt->pts) {
-                        frame_index = i;
-                        break;
-                    }
-                }
-                if (i >= MAX_PTS_DTS_DEPTH) {
-                    VPILOGE("can't find last same pts\n");
-                    goto err_exit;
-                }
-                vpi_ctx->time_stamp_info[frame_index].pts = -1;
-                vpi_ctx->time_stamp_info[frame_index].used = 0;
-                VPILOGD("clear %d pts used\n", frame_index);
-            }
-            vpi_ctx->time_stamp_info[empty_index].pts       = pkt->pts;
-            vpi_ctx->time_stamp_info[empty_index].pkt_dts   = pkt->pkt_dts;
-            //vpi_ctx->time_stamp_info[empty_index].decode_id =
-            //                        vpi_ctx->got_package_number + 1;
-            vpi_ctx->last_pts = pkt->pts;
+        if (pn_count > 1) {
+            VPILOGE("can't decide match frame\n");
+            goto err_exit;
         }
-    } else if (vpi_ctx->dec_fmt == Dec_H264_H10P
-              || vpi_ctx->dec_fmt == Dec_HEVC) {
-        vpi_ctx->time_stamp_info[empty_index].used = 1;
+        VPILOGD("frame_index = %d\n", frame_index);
+        ts_set(ts, frame_index, pkt->pts, pkt->pkt_dts);
+        dump_dec_pts_dts(vpi_ctx);
+    } else if (vpi_ctx->dec_fmt == Dec_VP9
+               || vpi_ctx->dec_fmt == Dec_H264_H10P
+               || vpi_ctx->dec_fmt == Dec_HEVC) {
         if (pkt->pts == vpi_ctx->last_pts &&
             pkt->pts != VID_NOPTS_VALUE &&
             vpi_ctx->got_package_number != 0) {
-            for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-                if (vpi_ctx->time_stamp_info[i].used == 1 &&
-                    vpi_ctx->time_stamp_info[i].pts == pkt->pts) {
-                    frame_index = i;
-                    break;
-                }
-            }
-            if (i >= MAX_PTS_DTS_DEPTH) {
+            /* mark before same pts as -1 wait PN frame */
+            frame_index = ts_find_pts(ts, pkt->pts, NULL);
+            if (frame_index < 0) {
                 VPILOGE("can't find last same pts\n");
                 goto err_exit;
             }
-            vpi_ctx->time_stamp_info[frame_index].pts = -1;
-            vpi_ctx->time_stamp_info[frame_index].used = 0;
+            ts_release(ts, frame_index);
             VPILOGD("clear %d pts used\n", frame_index);
         }
-        vpi_ctx->time_stamp_info[empty_index].pts       = pkt->pts;
-        vpi_ctx->time_stamp_info[empty_index].pkt_dts   = pkt->pkt_dts;
-        //vpi_ctx->time_stamp_info[empty_index].decode_id =
-        //                        vpi_ctx->got_package_number + 1;
+        frame_index = ts_alloc(vpi_ctx);
+        ts_set(ts, frame_index, pkt->pts, pkt->pkt_dts);
         vpi_ctx->last_pts = pkt->pts;
     }
 
@@ -446,18 +914,13 @@ VpiRet vpi_dec_output_frame(VpiDecCtx *vpi_ctx, VpiFrame *vpi_frame,
     vpi_frame->key_frame =
         (pic->pictures[1].picture_info.pic_coding_type == DEC_PIC_TYPE_I);
 
-    for (i = 0; i < MAX_PTS_DTS_DEPTH; i++) {
-        if ((vpi_ctx->time_stamp_info[i].used == 1) &&
-            (vpi_ctx->time_stamp_info[i].decode_id ==
-            pic->pictures[0].picture_info.decode_id)) {
-            vpi_frame->pts     = vpi_ctx->time_stamp_info[i].pts;
-            vpi_frame->pkt_dts = vpi_ctx->time_stamp_info[i].pkt_dts;
-            vpi_ctx->time_stamp_info[i].used = 0;
-            break;
-        }
-    }
-
-    if (i == MAX_PTS_DTS_DEPTH) {
+    i = ts_find_decode_id(&vpi_ctx->ts_tracker,
+                          pic->pictures[0].picture_info.decode_id);
+    if (i >= 0) {
+        vpi_frame->pts     = vpi_ctx->ts_tracker.info[i].pts;
+        vpi_frame->pkt_dts = vpi_ctx->ts_tracker.info[i].pkt_dts;
+        ts_release(&vpi_ctx->ts_tracker, i);
+    } else {
         VPILOGE("Can't find valid pts info\n");
         dump_dec_pts_dts(vpi_ctx);
         vpi_frame->pts     = VID_NOPTS_VALUE;
@@ -36,13 +36,25 @@ extern "C" {
 
 #include "vpi_video_dec.h"
 
-void vpi_dec_buf_list_add(BufLink **head, BufLink *list);
-BufLink* vpi_dec_buf_list_delete(BufLink *head);
+void vpi_dec_buf_ring_init(BufRing *ring);
+int vpi_dec_buf_ring_push(BufRing *ring, BufLink *link);
+BufLink *vpi_dec_buf_ring_pop(BufRing *ring);
+BufLink *vpi_dec_buf_ring_peek(BufRing *ring);
+int vpi_dec_store_frame_buffer(VpiDecCtx *vpi_ctx, VpiFrame *vpi_frame);
+void vpi_dec_release_stored_frames(VpiDecCtx *vpi_ctx);
 int vpi_send_packet_to_decode_buffer(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet,
                                      struct DWLLinearMem stream_buffer);
+int vpi_dec_load_stream_batch(VpiDecCtx *vpi_ctx, BufLink **links, int num);
+struct DWLLinearMem vpi_dec_get_stream_input(VpiDecCtx *vpi_ctx,
+                                             BufLink *strm_buf);
 int vpi_dec_get_stream_buffer_index(VpiDecCtx *vpi_ctx, int status);
+int vpi_dec_strm_pool_reserve(VpiDecCtx *vpi_ctx, uint32_t width,
+                              uint32_t height);
+int vpi_dec_strm_pool_fit(VpiDecCtx *vpi_ctx, uint32_t idx, uint32_t size);
+void vpi_dec_strm_pool_release(VpiDecCtx *vpi_ctx);
 void vpi_dec_release_ext_buffers(VpiDecCtx *vpi_ctx);
 int vpi_dec_check_buffer_number_for_trans(VpiDecCtx *vpi_ctx);
+void vpi_dec_init_pts_dts(VpiDecCtx *vpi_ctx);
 int vpi_dec_set_pts_decid(VpiDecCtx *vpi_ctx);
 void vpi_dec_clear_unused_pts(VpiDecCtx *vpi_ctx);
 int vpi_dec_set_pts_dts(VpiDecCtx *vpi_ctx, VpiPacket *pkt);
@@ -82,6 +82,9 @@ void vpi_dec_performance_report(VpiDecCtx *vpi_ctx)
     }
 
     VPILOGI("%s\n", info_string);
+    VPILOGI(":::DEC thread: %u wakeups, %llu ms idle\n",
+            vpi_ctx->dec_wakeup_number,
+            (unsigned long long)(vpi_ctx->dec_idle_time / 1000));
     VPILOGI(":::DEC Multi-core usage statistics:\n");
 
     if (dec_statistic.total_usage == 0) {
@@ -96,6 +99,9 @@ void vpi_dec_performance_report(VpiDecCtx *vpi_ctx)
 
 #ifdef FB_SYSLOG_ENABLE
     VPI_DEC_INFO_PRINT("%s\n", info_string);
+    VPI_DEC_INFO_PRINT(":::DEC thread: %u wakeups, %llu ms idle\n",
+                       vpi_ctx->dec_wakeup_number,
+                       (unsigned long long)(vpi_ctx->dec_idle_time / 1000));
     VPI_DEC_INFO_PRINT(":::DEC Multi-core usage statistics:\n");
     for (i = 0; i < 4; i++) {
         VPI_DEC_INFO_PRINT("\tSlice[%d] Core[%d] used %6d times (%2d%%)\n",
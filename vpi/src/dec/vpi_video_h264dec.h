@@ -57,6 +57,7 @@ enum DecRet vpi_dec_h264_get_buffer_info(VpiDecInst inst,
 enum DecRet vpi_dec_h264_add_buffer(VpiDecInst inst, struct DWLLinearMem *buf);
 #endif
 
+int vpi_decode_h264_queue_packet(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet);
 int vpi_decode_h264_put_packet(VpiDecCtx *vpi_ctx, void *indata);
 int vpi_decode_h264_get_frame(VpiDecCtx *vpi_ctx, void *outdata);
 int vpi_decode_h264_dec_process(VpiDecCtx *vpi_ctx);
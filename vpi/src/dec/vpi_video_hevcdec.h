@@ -56,6 +56,7 @@ enum DecRet vpi_dec_hevc_get_buffer_info(VpiDecInst inst,
                                          struct DecBufferInfo *buf_info);
 enum DecRet vpi_dec_hevc_add_buffer(VpiDecInst inst, struct DWLLinearMem *buf);
 #endif
+int vpi_decode_hevc_queue_packet(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet);
 int vpi_decode_hevc_put_packet(VpiDecCtx *vpi_ctx, void *indata);
 int vpi_decode_hevc_get_frame(VpiDecCtx *vpi_ctx, void *outdata);
 int vpi_decode_hevc_dec_process(VpiDecCtx *vpi_ctx);
@@ -420,16 +420,19 @@ VpiRet vpi_dec_vp9_picture_consumed(VpiDecInst inst, struct DecPicturePpu pic)
     return VPI_SUCCESS;
 }
 
-int vpi_decode_vp9_put_packet(VpiDecCtx *vpi_ctx, void *indata)
+/**
+ * vpi_decode_vp9_queue_packet
+ * Queue one packet into the next stream slot, dec_thread_mutex held.
+ * @Return: packet size when queued, 0 if the slot is busy or EOS was
+ *          already received, negative value on error
+ */
+int vpi_decode_vp9_queue_packet(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet)
 {
-    VpiPacket *vpi_packet = (VpiPacket *)indata;
     int idx;
     int i;
 
-    pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
     if (vpi_packet->size == 0) {
         if (vpi_ctx->eos_received) {
-            pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
             return 0;
         }
         VPILOGD("received EOS\n");
@@ -437,28 +440,11 @@ int vpi_decode_vp9_put_packet(VpiDecCtx *vpi_ctx, void *indata)
 
     idx = vpi_ctx->stream_mem_index;
     if (vpi_ctx->strm_buf_list[idx]->mem_idx != 0xFFFFFFFF) {
-        pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
         return 0;
     }
-    if (vpi_packet->size > vpi_ctx->stream_mem[idx].size) {
-        int new_size;
-
-        VPILOGD("packet size is too large(%d > %d @%d), re-allocing\n",
-                 vpi_packet->size, vpi_ctx->stream_mem[idx].size, idx);
-        vpi_ctx->stream_mem[idx].virtual_address = NULL;
-        DWLFreeLinear(vpi_ctx->dwl_inst, &vpi_ctx->stream_mem[idx]);
-        //alloc again
-        vpi_ctx->stream_mem[idx].mem_type = DWL_MEM_TYPE_DPB;
-        new_size = NEXT_MULTIPLE(vpi_packet->size, 0x10000);
-        if(DWLMallocLinear(vpi_ctx->dwl_inst, new_size,
-                           vpi_ctx->stream_mem + idx) != DWL_OK) {
-            VPILOGE("UNABLE TO ALLOCATE STREAM BUFFER MEMORY\n");
-            Vp9DecEndOfStream(vpi_ctx->dec_inst);
-            pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
-            return VPI_ERR_NO_AP_MEM;
-        } else {
-            VPILOGD("new alloc size %d\n", new_size);
-        }
+    if (vpi_dec_strm_pool_fit(vpi_ctx, idx, vpi_packet->size)) {
+        Vp9DecEndOfStream(vpi_ctx->dec_inst);
+        return VPI_ERR_NO_AP_MEM;
     }
 
     vpi_ctx->strm_buf_list[idx]->mem_idx   = vpi_ctx->stream_mem_index;
@@ -467,12 +453,14 @@ int vpi_decode_vp9_put_packet(VpiDecCtx *vpi_ctx, void *indata)
     vpi_ctx->strm_buf_list[idx]->opaque    = vpi_packet->opaque;
     vpi_ctx->strm_buf_list[idx]->pts       = vpi_packet->pts;
     vpi_ctx->strm_buf_list[idx]->pkt_dts   = vpi_packet->pkt_dts;
-    vpi_dec_buf_list_add(&vpi_ctx->strm_buf_head, vpi_ctx->strm_buf_list[idx]);
+    vpi_ctx->strm_buf_list[idx]->strm_idx    = idx;
+    vpi_ctx->strm_buf_list[idx]->strm_offset = 0;
+    vpi_ctx->strm_buf_list[idx]->strm_loaded = 0;
+    vpi_dec_buf_ring_push(&vpi_ctx->strm_buf_queue, vpi_ctx->strm_buf_list[idx]);
 
     if (vpi_packet->size > 0) {
         VPILOGD("size %d, packet pts %ld\n", vpi_packet->size, vpi_packet->pts);
         if (vpi_dec_set_pts_dts(vpi_ctx, vpi_packet) == -1) {
-            pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
             return -1;
         }
     }
@@ -488,14 +476,26 @@ int vpi_decode_vp9_put_packet(VpiDecCtx *vpi_ctx, void *indata)
     if (vpi_packet->size == 0) {
         vpi_ctx->eos_received = 1;
     }
-    pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
+    vpi_dec_wakeup_worker(vpi_ctx);
     return vpi_packet->size;
 }
 
+int vpi_decode_vp9_put_packet(VpiDecCtx *vpi_ctx, void *indata)
+{
+    int ret;
+
+    pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
+    ret = vpi_decode_vp9_queue_packet(vpi_ctx, (VpiPacket *)indata);
+    pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
+
+    return ret;
+}
+
 int vpi_decode_vp9_get_frame(VpiDecCtx *vpi_ctx, void *outdata)
 {
     VpiFrame **out_frame;
     VpiFrame *vpi_frame = NULL;
+    BufLink *frame_buf;
     int i;
     int ret;
 
@@ -518,17 +518,9 @@ int vpi_decode_vp9_get_frame(VpiDecCtx *vpi_ctx, void *outdata)
             return 2;
         }
     }
-    for (i = 0; i < vpi_ctx->frame_stored_num; i++) {
-        if (vpi_ctx->frame_stored_list[i]->used == 1) {
-            vpi_frame = (VpiFrame *)vpi_ctx->frame_stored_list[i]->item;
-            if (vpi_frame->nb_outputs == vpi_frame->used_cnt &&
-                vpi_frame->locked == 1) {
-                vpi_frame->locked = 0;
-                vpi_ctx->frame_stored_list[i]->used = 0;
-            }
-        }
-    }
-    if (NULL == vpi_ctx->frame_buf_head) {
+    vpi_dec_release_stored_frames(vpi_ctx);
+    frame_buf = vpi_dec_buf_ring_pop(&vpi_ctx->frame_out_queue);
+    if (NULL == frame_buf) {
         if (vpi_ctx->last_pic_flag == 1) {
             ret = 2;
         } else {
@@ -538,7 +530,7 @@ int vpi_decode_vp9_get_frame(VpiDecCtx *vpi_ctx, void *outdata)
         return ret;
     }
 
-    vpi_frame  = (VpiFrame *)vpi_ctx->frame_buf_head->item;
+    vpi_frame  = (VpiFrame *)frame_buf->item;
     out_frame  = (VpiFrame **)outdata;
     *out_frame = vpi_frame;
     if (vpi_ctx->output_num == 0) {
@@ -550,17 +542,10 @@ int vpi_decode_vp9_get_frame(VpiDecCtx *vpi_ctx, void *outdata)
         vpi_ctx->frame->hdr_info.matrix_coefficients = VPICOL_SPC_UNSPECIFIED;
         vpi_ctx->output_num++;
     }
-    for (i = 0; i < MAX_BUFFERS; i++) {
-        if (vpi_ctx->frame_buf_head->mem_idx
-            == vpi_ctx->frame_buf_list[i]->mem_idx) {
-            vpi_ctx->frame_buf_list[i]->mem_idx = 0xFFFFFFFF;
-            vpi_ctx->frame_buf_list[i]->used = 0;
-            vpi_ctx->frame_buf_list[i]->item = NULL;
-            break;
-        }
-    }
-    vpi_ctx->frame_buf_head =
-        vpi_dec_buf_list_delete(vpi_ctx->frame_buf_head);
+    frame_buf->mem_idx = 0xFFFFFFFF;
+    frame_buf->used    = 0;
+    frame_buf->item    = NULL;
+    vpi_dec_buf_ring_push(&vpi_ctx->frame_free_queue, frame_buf);
     pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
 
     return 1;
@@ -569,12 +554,14 @@ int vpi_decode_vp9_get_frame(VpiDecCtx *vpi_ctx, void *outdata)
 int vpi_decode_vp9_get_used_strm_mem(VpiDecCtx *vpi_ctx, void *mem)
 {
     VpiBufRef **ref;
+    BufLink *buf;
 
     ref = (VpiBufRef **)mem;
-    if (vpi_ctx->rls_strm_buf_head) {
-        *ref = (VpiBufRef *)vpi_ctx->rls_strm_buf_head->opaque;
-        vpi_ctx->rls_strm_buf_head =
-            vpi_dec_buf_list_delete(vpi_ctx->rls_strm_buf_head);
+    pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
+    buf = vpi_dec_buf_ring_pop(&vpi_ctx->rls_strm_buf_queue);
+    pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
+    if (buf) {
+        *ref = (VpiBufRef *)buf->opaque;
         return 0;
     } else {
         *ref = NULL;
@@ -585,51 +572,23 @@ int vpi_decode_vp9_get_used_strm_mem(VpiDecCtx *vpi_ctx, void *mem)
 int vpi_decode_vp9_set_frame_buffer(VpiDecCtx *vpi_ctx, void *frame)
 {
     VpiFrame *vpi_frame = (VpiFrame *)frame;
-    int i;
     int ret = 0;
 
     pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
-    for (i = 0; i < MAX_BUFFERS; i++) {
-        if (vpi_ctx->frame_buf_list[i]->used == 0) {
-            vpi_ctx->frame_buf_list[i]->used = 1;
-            vpi_ctx->frame_buf_list[i]->item = frame;
-            break;
-        }
-    }
-    if (i == MAX_BUFFERS) {
-        VPILOGE("no valid frame buffer to store buffer info\n");
-        ret = -1;
-    }
-    vpi_frame->locked     = 1;
-    vpi_frame->nb_outputs = 1;
-    vpi_frame->used_cnt   = 0;
-    for (i = 0; i < vpi_ctx->frame_stored_num; i++) {
-        if (vpi_ctx->frame_stored_list[i]->used == 0) {
-            vpi_ctx->frame_stored_list[i]->used = 1;
-            vpi_ctx->frame_stored_list[i]->item = frame;
-            break;
-        }
-    }
-    if (i == vpi_ctx->frame_stored_num) {
-        VPILOGE("no valid frame buffer to store buffer info\n");
-        ret = -1;
-    }
+    ret = vpi_dec_store_frame_buffer(vpi_ctx, vpi_frame);
+    vpi_dec_wakeup_worker(vpi_ctx);
     pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
     return ret;
 }
 
 int vpi_decode_vp9_get_frame_buffer_request(VpiDecCtx *vpi_ctx)
 {
-    int i, ret = 1;
+    int ret = 1;
     int frame_buf_cnt = 0;
     int frame_threshold = 0;
 
     pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
-    for (i = 0; i < MAX_BUFFERS; i++) {
-        if (vpi_ctx->frame_buf_list[i]->used == 1) {
-            frame_buf_cnt++;
-        }
-    }
+    frame_buf_cnt = MAX_BUFFERS - vpi_ctx->frame_free_queue.count;
     frame_threshold = MAX_BUFFERS - 2;
     if (frame_buf_cnt > frame_threshold) {
         ret = 0;
@@ -909,6 +868,9 @@ int vpi_decode_vp9_dec_frame(VpiDecCtx *vpi_ctx, void *indata, void *outdata)
             vpi_ctx->pic_size = vpi_ctx->sequence_info.pic_width *
                                 vpi_ctx->sequence_info.pic_height;
             vpi_ctx->pic_size = (3 * vpi_ctx->pic_size) / 2;
+            /* make room for keyframes of the new sequence up front */
+            vpi_dec_strm_pool_reserve(vpi_ctx, vpi_ctx->sequence_info.pic_width,
+                                      vpi_ctx->sequence_info.pic_height);
 
             /* No data consumed when returning DEC_HDRS_RDY. */
             vpi_ctx->dec_output.data_left     = vpi_ctx->vp9_dec_input.data_len;
@@ -1164,12 +1126,13 @@ static int vpi_decode_vp9_frame_decoding(VpiDecCtx *vpi_ctx)
 {
     enum DecRet ret;
     VpiRet vpi_ret;
+    BufLink *strm_buf = vpi_dec_buf_ring_peek(&vpi_ctx->strm_buf_queue);
 
     do {
         vpi_ctx->vp9_dec_input.pic_id = vpi_ctx->pic_decode_number;
 
         ret = vp9_decode_process(vpi_ctx, vpi_ctx->dec_inst,
-                                 vpi_ctx->stream_mem[vpi_ctx->strm_buf_head->mem_idx],
+                                 vpi_dec_get_stream_input(vpi_ctx, strm_buf),
                                  &vpi_ctx->dec_output,
                                  vpi_ctx->vp9_dec_input.stream,
                                  vpi_ctx->vp9_dec_input.data_len,
@@ -1230,6 +1193,9 @@ static int vpi_decode_vp9_frame_decoding(VpiDecCtx *vpi_ctx)
             vpi_ctx->pic_size = vpi_ctx->sequence_info.pic_width *
                                 vpi_ctx->sequence_info.pic_height;
             vpi_ctx->pic_size = (3 * vpi_ctx->pic_size) / 2;
+            /* make room for keyframes of the new sequence up front */
+            vpi_dec_strm_pool_reserve(vpi_ctx, vpi_ctx->sequence_info.pic_width,
+                                      vpi_ctx->sequence_info.pic_height);
 
             /* No data consumed when returning DEC_HDRS_RDY. */
             vpi_ctx->dec_output.data_left     = vpi_ctx->vp9_dec_input.data_len;
@@ -1298,30 +1264,27 @@ static int vpi_decode_vp9_frame_decoding(VpiDecCtx *vpi_ctx)
 int vpi_decode_vp9_dec_process(VpiDecCtx *vpi_ctx)
 {
     VpiFrame *vpi_frame        = NULL;
+    BufLink *strm_buf          = NULL;
+    struct DWLLinearMem strm_mem;
+    BufLink *frame_buf         = NULL;
     VpiPacket vpi_packet       = {0};
     int ret;
     int i;
 
     pthread_mutex_lock(&vpi_ctx->dec_thread_mutex);
-    if (NULL == vpi_ctx->strm_buf_head && 0 == vpi_ctx->eos_received) {
+    strm_buf = vpi_dec_buf_ring_peek(&vpi_ctx->strm_buf_queue);
+    if (NULL == strm_buf && 0 == vpi_ctx->eos_received) {
         pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
         return 0;
     }
 
     if (vpi_ctx->eos_received == 1) {
-        if (vpi_ctx->strm_buf_head && vpi_ctx->strm_buf_head->item_size == 0) {
+        if (strm_buf && strm_buf->item_size == 0) {
             // The last frame packet
             Vp9DecEndOfStream(vpi_ctx->dec_inst);
-            vpi_ctx->stream_mem_used[vpi_ctx->strm_buf_head->mem_idx] = 0;
-            for (i = 0; i < vpi_ctx->allocated_buffers; i++) {
-                if (vpi_ctx->strm_buf_list[i]->mem_idx ==
-                    vpi_ctx->strm_buf_head->mem_idx) {
-                    vpi_ctx->strm_buf_list[i]->mem_idx = 0xFFFFFFFF;
-                    break;
-                }
-            }
-            vpi_ctx->strm_buf_head =
-                vpi_dec_buf_list_delete(vpi_ctx->strm_buf_head);
+            vpi_ctx->stream_mem_used[strm_buf->mem_idx] = 0;
+            strm_buf->mem_idx = 0xFFFFFFFF;
+            vpi_dec_buf_ring_pop(&vpi_ctx->strm_buf_queue);
             vpi_ctx->eos_handled = 1;
         }
         if (vpi_ctx->eos_handled == 1) {
@@ -1333,26 +1296,19 @@ int vpi_decode_vp9_dec_process(VpiDecCtx *vpi_ctx)
                         vpi_ctx->pic.pictures[i].pic_width,
                         vpi_ctx->pic.pictures[i].pic_height);
                 }
-                for (i = 0; i < MAX_BUFFERS; i++) {
-                    if (vpi_ctx->frame_buf_list[i]->used == 1 &&
-                        vpi_ctx->frame_buf_list[i]->mem_idx == 0xFFFFFFFF) {
-                        vpi_ctx->frame_buf_list[i]->mem_idx = i;
-                        break;
-                    }
-                }
-                if (i == MAX_BUFFERS) {
+                frame_buf = vpi_dec_buf_ring_pop(&vpi_ctx->frame_idle_queue);
+                if (frame_buf == NULL) {
                     // This case should not happen
                     VPILOGE("All frame buffer used out\n");
                     pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
                     return -1;
                 }
-                vpi_frame = (VpiFrame *)vpi_ctx->frame_buf_list[i]->item;
+                vpi_frame = (VpiFrame *)frame_buf->item;
                 vpi_frame->used_cnt = 0;
                 vpi_frame->nb_outputs = 1;
                 vpi_ctx->pic_rdy = 1;
                 vpi_dec_output_frame(vpi_ctx, vpi_frame, &vpi_ctx->pic);
-                vpi_dec_buf_list_add(&vpi_ctx->frame_buf_head,
-                    vpi_ctx->frame_buf_list[i]);
+                vpi_dec_buf_ring_push(&vpi_ctx->frame_out_queue, frame_buf);
                 vpi_ctx->pic_display_number++;
                 VPILOGD("******** %d got frame :data[0]=%p,data[1]=%p, pts %ld\n",
                     vpi_ctx->pic_display_number, vpi_frame->data[0],
@@ -1365,25 +1321,26 @@ int vpi_decode_vp9_dec_process(VpiDecCtx *vpi_ctx)
 
             }
             pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
-            return 0;
+            /* keep draining while pictures are coming out */
+            return ret == DEC_PIC_RDY ? 1 : 0;
         }
     }
 
-    vpi_packet.data = (uint8_t *)vpi_ctx->strm_buf_head->item;
-    vpi_packet.size = vpi_ctx->strm_buf_head->item_size;
-    vpi_send_packet_to_decode_buffer(vpi_ctx, &vpi_packet,
-                        vpi_ctx->stream_mem[vpi_ctx->strm_buf_head->mem_idx]);
-    vpi_ctx->stream_mem[vpi_ctx->strm_buf_head->mem_idx].virtual_address =
-        (uint32_t *)vpi_packet.data;
+    vpi_packet.data = (uint8_t *)strm_buf->item;
+    vpi_packet.size = strm_buf->item_size;
+    if (!strm_buf->strm_loaded) {
+        vpi_send_packet_to_decode_buffer(vpi_ctx, &vpi_packet,
+                            vpi_ctx->stream_mem[strm_buf->mem_idx]);
+    }
+    strm_mem = vpi_dec_get_stream_input(vpi_ctx, strm_buf);
 
     vpi_ctx->vp9_dec_input.stream =
-        (uint8_t *)vpi_ctx->stream_mem[vpi_ctx->strm_buf_head->mem_idx]
-            .virtual_address;
+        (uint8_t *)strm_mem.virtual_address;
     vpi_ctx->vp9_dec_input.stream_bus_address =
-        vpi_ctx->stream_mem[vpi_ctx->strm_buf_head->mem_idx].bus_address;
-    vpi_ctx->vp9_dec_input.data_len = vpi_ctx->strm_buf_head->item_size;
-    vpi_ctx->cur_pkt_pts = vpi_ctx->strm_buf_head->pts;
-    vpi_ctx->cur_pkt_dts = vpi_ctx->strm_buf_head->pkt_dts;
+        strm_mem.bus_address;
+    vpi_ctx->vp9_dec_input.data_len = strm_buf->item_size;
+    vpi_ctx->cur_pkt_pts = strm_buf->pts;
+    vpi_ctx->cur_pkt_dts = strm_buf->pkt_dts;
     VPILOGD("decoding stream size %d\n", vpi_ctx->vp9_dec_input.data_len);
     if (vpi_ctx->enc_type != VPI_ENC_NONE) {
         if (vpi_dec_check_buffer_number_for_trans(vpi_ctx) == -1) {
@@ -1402,26 +1359,19 @@ int vpi_decode_vp9_dec_process(VpiDecCtx *vpi_ctx)
     if (vpi_ctx->dec_output.data_left == 0) {
         int idx = vpi_ctx->rls_mem_index;
 
-        vpi_ctx->stream_mem_used[vpi_ctx->strm_buf_head->mem_idx] = 0;
-        VPILOGD("release stream_mem_index %d\n", vpi_ctx->strm_buf_head->mem_idx);
+        vpi_ctx->stream_mem_used[strm_buf->mem_idx] = 0;
+        VPILOGD("release stream_mem_index %d\n", strm_buf->mem_idx);
         vpi_ctx->rls_strm_buf_list[idx]->mem_idx = vpi_ctx->rls_mem_index;
-        vpi_ctx->rls_strm_buf_list[idx]->item    = vpi_ctx->strm_buf_head->item;
-        vpi_ctx->rls_strm_buf_list[idx]->opaque  = vpi_ctx->strm_buf_head->opaque;
-        vpi_dec_buf_list_add(&vpi_ctx->rls_strm_buf_head,
-                             vpi_ctx->rls_strm_buf_list[idx]);
+        vpi_ctx->rls_strm_buf_list[idx]->item    = strm_buf->item;
+        vpi_ctx->rls_strm_buf_list[idx]->opaque  = strm_buf->opaque;
+        vpi_dec_buf_ring_push(&vpi_ctx->rls_strm_buf_queue,
+                              vpi_ctx->rls_strm_buf_list[idx]);
         vpi_ctx->rls_mem_index++;
         if (vpi_ctx->rls_mem_index == 32) {
             vpi_ctx->rls_mem_index = 0;
         }
-        for (i = 0; i < vpi_ctx->allocated_buffers; i++) {
-            if (vpi_ctx->strm_buf_list[i]->mem_idx ==
-                vpi_ctx->strm_buf_head->mem_idx) {
-                vpi_ctx->strm_buf_list[i]->mem_idx = 0xFFFFFFFF;
-                break;
-            }
-        }
-        vpi_ctx->strm_buf_head =
-                vpi_dec_buf_list_delete(vpi_ctx->strm_buf_head);
+        strm_buf->mem_idx = 0xFFFFFFFF;
+        vpi_dec_buf_ring_pop(&vpi_ctx->strm_buf_queue);
         ret = 0;
     } else {
         ret = -1;
@@ -1444,26 +1394,19 @@ int vpi_decode_vp9_dec_process(VpiDecCtx *vpi_ctx)
                     vpi_ctx->pic.pictures[i].pic_height);
         }
 
-        for (i = 0; i < MAX_BUFFERS; i++) {
-            if (vpi_ctx->frame_buf_list[i]->used == 1 &&
-                vpi_ctx->frame_buf_list[i]->mem_idx == 0xFFFFFFFF) {
-                vpi_ctx->frame_buf_list[i]->mem_idx = i;
-                break;
-            }
-        }
-        if (i == MAX_BUFFERS) {
+        frame_buf = vpi_dec_buf_ring_pop(&vpi_ctx->frame_idle_queue);
+        if (frame_buf == NULL) {
             // This case should not happen
             VPILOGE("All frame buffer used out\n");
             pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
             return -1;
         }
-        vpi_frame = (VpiFrame *)vpi_ctx->frame_buf_list[i]->item;
+        vpi_frame = (VpiFrame *)frame_buf->item;
         vpi_ctx->pic_rdy = 1;
         vpi_frame->nb_outputs = 1;
         vpi_frame->used_cnt = 0;
         vpi_dec_output_frame(vpi_ctx, vpi_frame, &vpi_ctx->pic);
-        vpi_dec_buf_list_add(&vpi_ctx->frame_buf_head,
-            vpi_ctx->frame_buf_list[i]);
+        vpi_dec_buf_ring_push(&vpi_ctx->frame_out_queue, frame_buf);
         vpi_ctx->pic_display_number++;
         VPILOGD("******** %d got frame :data[0]=%p,data[1]=%p, pts %ld\n",
             vpi_ctx->pic_display_number,
@@ -1565,6 +1508,7 @@ void vpi_decode_vp9_picture_consume(VpiDecCtx *vpi_ctx, void *data)
         pthread_cond_signal(&vpi_ctx->dec_thread_cond);
         vpi_ctx->waiting_for_dpb = 0;
     }
+    vpi_dec_wakeup_worker(vpi_ctx);
     pthread_mutex_unlock(&vpi_ctx->dec_thread_mutex);
 }
 
@@ -1698,6 +1642,7 @@ int vpi_decode_vp9_close(VpiDecCtx *vpi_ctx)
     }
     vpi_ctx->last_pic_flag = 1;
 
+    vpi_dec_strm_pool_release(vpi_ctx);
     for (i = 0; i < vpi_ctx->allocated_buffers; i++) {
         if (vpi_ctx->stream_mem[i].mem_type == DWL_MEM_TYPE_DPB) {
             vpi_ctx->stream_mem[i].virtual_address = NULL;
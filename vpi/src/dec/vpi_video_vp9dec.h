@@ -55,6 +55,7 @@ void vpi_decode_vp9_picture_consume(VpiDecCtx *vpi_ctx, void *data);
 VpiRet vpi_decode_vp9_init(VpiDecCtx *vpi_ctx);
 VpiRet vpi_decode_vp9_control(VpiDecCtx *vpi_ctx, void *indata, void *outdata);
 int vpi_decode_vp9_close(VpiDecCtx *vpi_ctx);
+int vpi_decode_vp9_queue_packet(VpiDecCtx *vpi_ctx, VpiPacket *vpi_packet);
 int vpi_decode_vp9_put_packet(VpiDecCtx *vpi_ctx, void *indata);
 int vpi_decode_vp9_get_frame(VpiDecCtx *vpi_ctx, void *outdata);
 int vpi_decode_vp9_dec_process(VpiDecCtx *vpi_ctx);
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2020, VeriSilicon Holdings Co., Ltd. All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "vpi_video_enc_roi.h"
+
+/* how a map entry turns into a hardware map value */
+typedef struct RoiCoder {
+    int8_t min;
+    int8_t max;
+    uint8_t negate;
+    uint8_t shift;
+    uint8_t bits;
+} RoiCoder;
+
+static int roi_coder_init(RoiCoder *coder, uint32_t version, int absolute_qp)
+{
+    memset(coder, 0, sizeof(*coder));
+    if (version == 0) {
+        /* 4 bit -qp delta */
+        if (absolute_qp)
+            return -1;
+        coder->min    = -15;
+        coder->max    = 0;
+        coder->negate = 1;
+    } else if (version == 1 || version == 2) {
+        /* 6 bit -qp delta or absolute qp, tagged by version */
+        coder->min    = absolute_qp ? 0 : -31;
+        coder->max    = absolute_qp ? 51 : 32;
+        coder->negate = !absolute_qp;
+        if (version == 1) {
+            coder->shift = 1;
+            coder->bits  = absolute_qp ? 1 : 0;
+        } else {
+            coder->bits = absolute_qp ? 0 : 0x40;
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static void roi_encode_c(uint8_t *dst, const int8_t *qp, const uint8_t *flags,
+                         uint32_t num, const RoiCoder *coder)
+{
+    uint32_t i;
+    int v;
+
+    for (i = 0; i < num; i++) {
+        v = qp[i] < coder->min ? coder->min :
+            qp[i] > coder->max ? coder->max : qp[i];
+        if (coder->negate)
+            v = -v;
+        v = ((v & 0x3f) << coder->shift) | coder->bits;
+        if (flags && flags[i])
+            v |= 0x80;
+        dst[i] = v;
+    }
+}
+
+#if defined(__SSE2__)
+/* SSE2 has no signed byte min/max, clip in the biased unsigned domain */
+static uint32_t roi_encode_simd(uint8_t *dst, const int8_t *qp,
+                                const uint8_t *flags, uint32_t num,
+                                const RoiCoder *coder)
+{
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i vmin = _mm_set1_epi8((char)(coder->min ^ 0x80));
+    const __m128i vmax = _mm_set1_epi8((char)(coder->max ^ 0x80));
+    const __m128i mask = _mm_set1_epi8(0x3f);
+    const __m128i bits = _mm_set1_epi8(coder->bits);
+    const __m128i flag = _mm_set1_epi8((char)0x80);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i;
+
+    for (i = 0; i + 16 <= num; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(qp + i));
+
+        v = _mm_xor_si128(v, bias);
+        v = _mm_min_epu8(_mm_max_epu8(v, vmin), vmax);
+        v = _mm_xor_si128(v, bias);
+        if (coder->negate)
+            v = _mm_sub_epi8(zero, v);
+        v = _mm_and_si128(v, mask);
+        if (coder->shift)
+            v = _mm_add_epi8(v, v);
+        v = _mm_or_si128(v, bits);
+        if (flags) {
+            __m128i f = _mm_loadu_si128((const __m128i *)(flags + i));
+            v = _mm_or_si128(v, _mm_andnot_si128(_mm_cmpeq_epi8(f, zero),
+                                                 flag));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    return i;
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+static uint32_t roi_encode_simd(uint8_t *dst, const int8_t *qp,
+                                const uint8_t *flags, uint32_t num,
+                                const RoiCoder *coder)
+{
+    const int8x16_t vmin = vdupq_n_s8(coder->min);
+    const int8x16_t vmax = vdupq_n_s8(coder->max);
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    const uint8x16_t bits = vdupq_n_u8(coder->bits);
+    const uint8x16_t flag = vdupq_n_u8(0x80);
+    uint32_t i;
+
+    for (i = 0; i + 16 <= num; i += 16) {
+        int8x16_t s = vminq_s8(vmaxq_s8(vld1q_s8(qp + i), vmin), vmax);
+        uint8x16_t v;
+
+        if (coder->negate)
+            s = vnegq_s8(s);
+        v = vandq_u8(vreinterpretq_u8_s8(s), mask);
+        if (coder->shift)
+            v = vshlq_n_u8(v, 1);
+        v = vorrq_u8(v, bits);
+        if (flags) {
+            uint8x16_t f = vld1q_u8(flags + i);
+            v = vorrq_u8(v, vandq_u8(vtstq_u8(f, f), flag));
+        }
+        vst1q_u8(dst + i, v);
+    }
+    return i;
+}
+#else
+static uint32_t roi_encode_simd(uint8_t *dst, const int8_t *qp,
+                                const uint8_t *flags, uint32_t num,
+                                const RoiCoder *coder)
+{
+    return 0;
+}
+#endif
+
+/* copy one row of 8x8 block values into every CTB of a CTB row */
+static void roi_scatter_row(uint8_t *dst, const uint8_t *line,
+                            uint32_t ctbs, uint32_t chunk, uint32_t ctb_bytes)
+{
+    uint32_t x;
+
+    switch (chunk) {
+    case 8:
+        for (x = 0; x < ctbs; x++)
+            memcpy(dst + x * ctb_bytes, line + x * 8, 8);
+        break;
+    case 4:
+        for (x = 0; x < ctbs; x++)
+            memcpy(dst + x * ctb_bytes, line + x * 4, 4);
+        break;
+    case 2:
+        for (x = 0; x < ctbs; x++)
+            memcpy(dst + x * ctb_bytes, line + x * 2, 2);
+        break;
+    default:
+        for (x = 0; x < ctbs; x++)
+            memcpy(dst + x * ctb_bytes, line + x * chunk, chunk);
+        break;
+    }
+}
+
+uint32_t vpi_enc_roi_map_size(const VpiEncRoiLayout *layout)
+{
+    uint32_t blks_per_ctb = layout->ctb_size / 8;
+    uint32_t ctb_bytes    = blks_per_ctb * blks_per_ctb;
+
+    if (layout->version == 0)
+        ctb_bytes /= 2;
+    return layout->ctb_per_row * layout->ctb_per_column * ctb_bytes;
+}
+
+int vpi_enc_pack_roi_map(uint8_t *dst, const VpiEncRoiLayout *layout,
+                         const VpiRoiMap *map)
+{
+    uint32_t blks_per_ctb = layout->ctb_size / 8;
+    uint32_t blks_w       = layout->ctb_per_row * blks_per_ctb;
+    uint32_t blks_h       = layout->ctb_per_column * blks_per_ctb;
+    uint32_t blks_per_unit, width, height, chunk, ctb_bytes, ctb_row_stride;
+    uint8_t values[ROI_MAX_ROW_BLOCKS];
+    uint8_t line[ROI_MAX_ROW_BLOCKS + 8];
+    const uint8_t *flags;
+    RoiCoder coder;
+    uint32_t x, y, by, last, i;
+
+    if (map->block_unit < 0 || map->block_unit > 3 || !map->qp ||
+        blks_w > ROI_MAX_ROW_BLOCKS ||
+        roi_coder_init(&coder, layout->version, map->absolute_qp))
+        return -1;
+
+    blks_per_unit = 1 << (3 - map->block_unit);
+    width         = (blks_w + blks_per_unit - 1) / blks_per_unit;
+    height        = (blks_h + blks_per_unit - 1) / blks_per_unit;
+    if (map->width < width || map->height < height || map->stride < width)
+        return -1;
+
+    chunk          = layout->version == 0 ? blks_per_ctb / 2 : blks_per_ctb;
+    ctb_bytes      = blks_per_ctb * chunk;
+    ctb_row_stride = layout->ctb_per_row * ctb_bytes;
+    flags          = layout->version ? map->flags : NULL;
+
+    for (y = 0; y < height; y++) {
+        const int8_t *qp_row = map->qp + y * map->stride;
+        const uint8_t *flag_row = flags ? flags + y * map->stride : NULL;
+
+        i = roi_encode_simd(values, qp_row, flag_row, width, &coder);
+        roi_encode_c(values + i, qp_row + i, flag_row ? flag_row + i : NULL,
+                     width - i, &coder);
+
+        /* one value per 8x8 block */
+        if (blks_per_unit == 1) {
+            memcpy(line, values, width);
+        } else {
+            for (x = 0; x < width; x++)
+                memset(line + x * blks_per_unit, values[x], blks_per_unit);
+        }
+        /* version 0 packs two blocks per byte, the left one in bits 0..3 */
+        if (layout->version == 0) {
+            for (x = 0; x < blks_w / 2; x++)
+                line[x] = (line[2 * x] & 0x0f) | (line[2 * x + 1] << 4);
+        }
+
+        last = (y + 1) * blks_per_unit;
+        if (last > blks_h)
+            last = blks_h;
+        for (by = y * blks_per_unit; by < last; by++)
+            roi_scatter_row(dst + by / blks_per_ctb * ctb_row_stride +
+                                by % blks_per_ctb * chunk,
+                            line, layout->ctb_per_row, chunk, ctb_bytes);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020, VeriSilicon Holdings Co., Ltd. All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __VPI_VIDEO_ENC_ROI_H__
+#define __VPI_VIDEO_ENC_ROI_H__
+
+#include <stdint.h>
+#include "vpi_types.h"
+
+/* widest picture a ROI map can be packed for, in 8x8 blocks */
+#define ROI_MAX_ROW_BLOCKS 1024
+
+/**
+ * Geometry and format of the hardware ROI map: 8x8 blocks grouped per
+ * CTB, CTBs in raster order. Version 0 stores a 4 bit QP delta per block,
+ * version 1 and 2 one byte per block with bit 7 as IPCM/skip flag.
+ */
+typedef struct VpiEncRoiLayout {
+    uint32_t ctb_per_row;
+    uint32_t ctb_per_column;
+    uint32_t ctb_size;
+    uint32_t version;
+} VpiEncRoiLayout;
+
+/**
+ * vpi_enc_roi_map_size
+ * Get the number of bytes vpi_enc_pack_roi_map() writes for a layout
+ * @Params: layout: hardware ROI map layout
+ */
+uint32_t vpi_enc_roi_map_size(const VpiEncRoiLayout *layout);
+
+/**
+ * vpi_enc_pack_roi_map
+ * Pack an in-memory ROI map into the hardware ROI map layout, giving the
+ * same memory as the roi_map_delta_qp_file/skip_map_file parsers do.
+ * @Params: dst: hardware ROI map, vpi_enc_roi_map_size() bytes
+ *          layout: hardware ROI map layout
+ *          map: ROI map of the frame
+ * @Return: 0 on success, -1 if the map does not fit the layout
+ */
+int vpi_enc_pack_roi_map(uint8_t *dst, const VpiEncRoiLayout *layout,
+                         const VpiRoiMap *map);
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2020, VeriSilicon Holdings Co., Ltd. All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "vpi_video_enc_tile.h"
+
+static void tile4x4_rows_c(uint8_t *dst, const uint8_t *src,
+                           uint32_t src_stride, uint32_t first_tile,
+                           uint32_t tiles, uint32_t rows, uint32_t tile_bytes)
+{
+    uint32_t x, y;
+
+    for (y = 0; y < rows; y++) {
+        const uint8_t *s = src + y * src_stride + first_tile * tile_bytes;
+        uint8_t *d       = dst + (first_tile * 4 + y) * tile_bytes;
+
+        for (x = first_tile; x < tiles; x++) {
+            memcpy(d, s, tile_bytes);
+            s += tile_bytes;
+            d += 4 * tile_bytes;
+        }
+    }
+}
+
+void vpi_enc_raster_to_tile4x4_c(uint8_t *dst, uint32_t dst_stride,
+                                 const uint8_t *src, uint32_t src_stride,
+                                 uint32_t tiles, uint32_t rows,
+                                 uint32_t tile_bytes)
+{
+    uint32_t y;
+
+    for (y = 0; y < rows; y += 4) {
+        tile4x4_rows_c(dst, src, src_stride, 0, tiles,
+                       rows - y < 4 ? rows - y : 4, tile_bytes);
+        dst += dst_stride;
+        src += 4 * src_stride;
+    }
+}
+
+#if defined(__SSE2__)
+/* one group of 4 full rows, returns the number of tiles done */
+static uint32_t tile4x4_rows_simd(uint8_t *dst, const uint8_t *src,
+                                  uint32_t src_stride, uint32_t tiles,
+                                  uint32_t tile_bytes)
+{
+    const uint8_t *s0 = src;
+    const uint8_t *s1 = src + src_stride;
+    const uint8_t *s2 = src + 2 * src_stride;
+    const uint8_t *s3 = src + 3 * src_stride;
+    /* 16 bytes of each row make 64 bytes of tiles */
+    uint32_t step     = 16 / tile_bytes;
+    uint32_t x;
+    int stream        = ((uintptr_t)dst & 15) == 0;
+
+    for (x = 0; x + step <= tiles; x += step) {
+        __m128i r0 = _mm_loadu_si128((const __m128i *)s0);
+        __m128i r1 = _mm_loadu_si128((const __m128i *)s1);
+        __m128i r2 = _mm_loadu_si128((const __m128i *)s2);
+        __m128i r3 = _mm_loadu_si128((const __m128i *)s3);
+        __m128i o0, o1, o2, o3;
+
+        if (tile_bytes == 4) {
+            __m128i a = _mm_unpacklo_epi32(r0, r1);
+            __m128i b = _mm_unpacklo_epi32(r2, r3);
+            __m128i c = _mm_unpackhi_epi32(r0, r1);
+            __m128i d = _mm_unpackhi_epi32(r2, r3);
+
+            o0 = _mm_unpacklo_epi64(a, b);
+            o1 = _mm_unpackhi_epi64(a, b);
+            o2 = _mm_unpacklo_epi64(c, d);
+            o3 = _mm_unpackhi_epi64(c, d);
+        } else {
+            o0 = _mm_unpacklo_epi64(r0, r1);
+            o1 = _mm_unpacklo_epi64(r2, r3);
+            o2 = _mm_unpackhi_epi64(r0, r1);
+            o3 = _mm_unpackhi_epi64(r2, r3);
+        }
+        if (stream) {
+            /* the tiles are only read back by the eDMA */
+            _mm_stream_si128((__m128i *)dst, o0);
+            _mm_stream_si128((__m128i *)dst + 1, o1);
+            _mm_stream_si128((__m128i *)dst + 2, o2);
+            _mm_stream_si128((__m128i *)dst + 3, o3);
+        } else {
+            _mm_storeu_si128((__m128i *)dst, o0);
+            _mm_storeu_si128((__m128i *)dst + 1, o1);
+            _mm_storeu_si128((__m128i *)dst + 2, o2);
+            _mm_storeu_si128((__m128i *)dst + 3, o3);
+        }
+        s0 += 16;
+        s1 += 16;
+        s2 += 16;
+        s3 += 16;
+        dst += 64;
+    }
+    return x;
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+static uint32_t tile4x4_rows_simd(uint8_t *dst, const uint8_t *src,
+                                  uint32_t src_stride, uint32_t tiles,
+                                  uint32_t tile_bytes)
+{
+    const uint8_t *s0 = src;
+    const uint8_t *s1 = src + src_stride;
+    const uint8_t *s2 = src + 2 * src_stride;
+    const uint8_t *s3 = src + 3 * src_stride;
+    uint32_t step     = 16 / tile_bytes;
+    uint32_t x;
+
+    /* an interleaving store of the 4 rows writes the tiles directly */
+    for (x = 0; x + step <= tiles; x += step) {
+        if (tile_bytes == 4) {
+            uint32x4x4_t r;
+
+            r.val[0] = vreinterpretq_u32_u8(vld1q_u8(s0));
+            r.val[1] = vreinterpretq_u32_u8(vld1q_u8(s1));
+            r.val[2] = vreinterpretq_u32_u8(vld1q_u8(s2));
+            r.val[3] = vreinterpretq_u32_u8(vld1q_u8(s3));
+            vst4q_u32((uint32_t *)dst, r);
+        } else {
+            uint64x2x4_t r;
+
+            r.val[0] = vreinterpretq_u64_u8(vld1q_u8(s0));
+            r.val[1] = vreinterpretq_u64_u8(vld1q_u8(s1));
+            r.val[2] = vreinterpretq_u64_u8(vld1q_u8(s2));
+            r.val[3] = vreinterpretq_u64_u8(vld1q_u8(s3));
+            vst4q_u64((uint64_t *)dst, r);
+        }
+        s0 += 16;
+        s1 += 16;
+        s2 += 16;
+        s3 += 16;
+        dst += 64;
+    }
+    return x;
+}
+#else
+static uint32_t tile4x4_rows_simd(uint8_t *dst, const uint8_t *src,
+                                  uint32_t src_stride, uint32_t tiles,
+                                  uint32_t tile_bytes)
+{
+    return 0;
+}
+#endif
+
+void vpi_enc_raster_to_tile4x4(uint8_t *dst, uint32_t dst_stride,
+                               const uint8_t *src, uint32_t src_stride,
+                               uint32_t tiles, uint32_t rows,
+                               uint32_t tile_bytes)
+{
+    uint32_t y, done;
+
+    if (tile_bytes != 4 && tile_bytes != 8) {
+        vpi_enc_raster_to_tile4x4_c(dst, dst_stride, src, src_stride, tiles,
+                                    rows, tile_bytes);
+        return;
+    }
+
+    for (y = 0; y + 4 <= rows; y += 4) {
+        done = tile4x4_rows_simd(dst, src, src_stride, tiles, tile_bytes);
+        if (done < tiles) {
+            tile4x4_rows_c(dst, src, src_stride, done, tiles, 4, tile_bytes);
+        }
+        dst += dst_stride;
+        src += 4 * src_stride;
+    }
+    if (y < rows) {
+        tile4x4_rows_c(dst, src, src_stride, 0, tiles, rows - y, tile_bytes);
+    }
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2020, VeriSilicon Holdings Co., Ltd. All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __VPI_VIDEO_ENC_TILE_H__
+#define __VPI_VIDEO_ENC_TILE_H__
+
+#include <stdint.h>
+
+/**
+ * vpi_enc_raster_to_tile4x4
+ * Convert a raster plane into the 4x4 tiled layout of the encoder FB
+ * input: every 4 rows become one tile row where tile n holds the 4
+ * samples at column 4n of the 4 rows, one after the other.
+ * @Params: dst: tiled output, dst_stride bytes per tile row
+ *          src: raster input, src_stride bytes per row
+ *          tiles: number of 4 sample wide tiles per row
+ *          rows: number of raster rows
+ *          tile_bytes: bytes of 4 samples, 4 for 8 bit and 8 for P010
+ */
+void vpi_enc_raster_to_tile4x4(uint8_t *dst, uint32_t dst_stride,
+                               const uint8_t *src, uint32_t src_stride,
+                               uint32_t tiles, uint32_t rows,
+                               uint32_t tile_bytes);
+
+/* plain C version, reference for the SIMD one */
+void vpi_enc_raster_to_tile4x4_c(uint8_t *dst, uint32_t dst_stride,
+                                 const uint8_t *src, uint32_t src_stride,
+                                 uint32_t tiles, uint32_t rows,
+                                 uint32_t tile_bytes);
+
+#endif
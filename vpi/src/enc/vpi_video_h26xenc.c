@@ -30,6 +30,8 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/time.h>
 #include "instance.h"
 #include "dectypes.h"
@@ -313,6 +315,28 @@ static VpiRet h26x_enc_open_encoder(VpiH26xEncCtx *enc_ctx, VPIH26xEncOptions *o
     }
 
     encoder = *p_enc;
+
+    /* the flags of per-frame ROI maps drive the IPCM map (version 1) or
+     * the skip map (version 2) */
+    if (options->roi_map) {
+        i32 roi_map_version =
+            ((struct vcenc_instance *)encoder)->asic.regs.asicCfg.roiMapVersion;
+
+        if (roi_map_version == 3)
+            roi_map_version = options->roi_qp_delta_ver;
+        if (roi_map_version > 2) {
+            VPILOGE("per-frame ROI map not supported by ROI map version %d\n",
+                    roi_map_version);
+            return VPI_ERR_ENCODER_OPITION;
+        }
+        if (options->roi_map == 2) {
+            if (roi_map_version == 1)
+                options->ipcm_map_enable = 1;
+            else if (roi_map_version == 2)
+                options->skip_map_enable = 1;
+        }
+    }
+
     /* Encoder setup: coding control */
     if ((ret = VCEncGetCodingCtrl(encoder, &coding_cfg)) != VCENC_OK) {
         VPILOGE("VCEncGetCodingCtrl failed\n");
@@ -1536,6 +1560,8 @@ static VpiRet h26x_enc_send_pic(VpiH26xEncCtx *enc_ctx, int poc_need,
                     }
                     pic_data =
                         (struct DecPicture *)&pic_ppu->pictures[enc_ctx->pp_index];
+                    cfg->frame_roi_map =
+                        p_trans->roi_map.qp ? &p_trans->roi_map : NULL;
                     p_trans->in_pass_one_queue = 1;
                     p_trans->used              = 1;
                     pthread_mutex_unlock(&p_trans->pic_mutex);
@@ -1755,8 +1781,21 @@ static VpiRet h26x_enc_process_frame(VpiH26xEncCtx *enc_ctx,
         VPILOGI("src size %d, dst size %d\n",
                  out_buffer->outbuf_mem->size, outstrm_buf->outbuf_mem->size);
         VPILOGI("pkt_size %d\n", pkt_size);
-        ret = EWLTransDataEP2RC(cfg->ewl, out_buffer->outbuf_mem,
-                                outstrm_buf->outbuf_mem, pkt_size);
+        outstrm_buf->stream_offset = 0;
+        if (options->zero_copy_pkt && outstrm_buf->header_size &&
+            !outstrm_buf->resend_header) {
+            /* leave room to write the header in front of the stream */
+            EWLLinearMem_t dst = *outstrm_buf->outbuf_mem;
+
+            outstrm_buf->stream_offset = outstrm_buf->header_size;
+            dst.rc_busAddress += outstrm_buf->header_size;
+            dst.size          -= outstrm_buf->header_size;
+            ret = EWLTransDataEP2RC(cfg->ewl, out_buffer->outbuf_mem, &dst,
+                                    outstrm_buf->stream_size);
+        } else {
+            ret = EWLTransDataEP2RC(cfg->ewl, out_buffer->outbuf_mem,
+                                    outstrm_buf->outbuf_mem, pkt_size);
+        }
         if (ret) {
             VPILOGE("copy failed, ret %d\n", ret);
             VPILOGD("pkt_size %d\n", pkt_size);
@@ -2586,18 +2625,22 @@ VpiRet h26x_enc_frame_process(VpiH26xEncCtx *ctx)
     int i = 0;
     u32 new_fps_numer = 0, new_fps_demon = 0;
 
+    ctx->h26xe_thd_idle = 0;
     if (ctx->flush_state == VPIH26X_FLUSH_ERROR
        || ctx->flush_state == VPIH26X_FLUSH_ENCEND) {
+           ctx->h26xe_thd_idle = 1;
            return VPI_SUCCESS;
     }
 
     if ((ctx->inject_frm_cnt < ctx->hold_buf_num)
        && ctx->force_idr
        && ctx->eos_received == 0) {
+        ctx->h26xe_thd_idle = 1;
         return VPI_SUCCESS;
     }
 
     if (ctx->got_frame != 1 && ctx->eos_received == 0 && options->low_delay) {
+        ctx->h26xe_thd_idle = 1;
         return VPI_SUCCESS;
     }
 
@@ -2622,6 +2665,9 @@ VpiRet h26x_enc_frame_process(VpiH26xEncCtx *ctx)
                     ctx->flush_state = VPIH26X_FLUSH_FINISH;
                     ctx->fps_change_fist_frame = 0;
                 }
+            } else if (ctx->trans_flush_pic == HANTRO_TRUE) {
+                /* the next picture has not been put yet */
+                ctx->h26xe_thd_idle = 1;
             }
             break;
 
@@ -2674,6 +2720,46 @@ error:
     return VPI_ERR_ENCODE;
 }
 
+/* must be called with h26xe_thd_mutex held */
+static void h26x_enc_wakeup_worker(VpiH26xEncCtx *enc_ctx)
+{
+    enc_ctx->h26xe_work_pending = 1;
+    pthread_cond_signal(&enc_ctx->h26xe_work_cond);
+}
+
+static void h26x_enc_wait_for_work(VpiH26xEncCtx *enc_ctx)
+{
+    struct timespec start, end, deadline;
+    int ret = 0;
+
+    pthread_mutex_lock(&enc_ctx->h26xe_thd_mutex);
+    if (enc_ctx->h26xe_work_pending || enc_ctx->h26xe_thd_end) {
+        enc_ctx->h26xe_work_pending = 0;
+        pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    deadline.tv_nsec += H26XE_WORKER_IDLE_TIMEOUT_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!enc_ctx->h26xe_work_pending && !enc_ctx->h26xe_thd_end &&
+           ret != ETIMEDOUT) {
+        ret = pthread_cond_timedwait(&enc_ctx->h26xe_work_cond,
+                                     &enc_ctx->h26xe_thd_mutex, &deadline);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    enc_ctx->h26xe_work_pending = 0;
+    enc_ctx->h26xe_wakeup_number++;
+    enc_ctx->h26xe_idle_time += (end.tv_sec - start.tv_sec) * 1000000LL +
+                                (end.tv_nsec - start.tv_nsec) / 1000;
+    pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
+}
+
 void *h26x_encode_process(void *arg)
 {
     VpiH26xEncCtx *enc_ctx = (VpiH26xEncCtx *)arg;
@@ -2683,7 +2769,11 @@ void *h26x_encode_process(void *arg)
     while (!enc_ctx->h26xe_thd_end) {
         ret = h26x_enc_frame_process(enc_ctx);
         if (ret == 0) {
-            usleep(500);
+            /* only block when nothing could be done, a new frame, EOS
+             * or a consumed packet will wake us up */
+            if (enc_ctx->h26xe_thd_idle) {
+                h26x_enc_wait_for_work(enc_ctx);
+            }
         } else if (ret == -1) {
             break;
         }
@@ -2705,6 +2795,7 @@ VpiRet vpi_h26xe_init(VpiH26xEncCtx *enc_ctx, VpiH26xEncCfg *enc_cfg)
     VpiRet ret               = VPI_SUCCESS;
     i32 i   = 0;
     int max_frames_delay;
+    pthread_condattr_t cond_attr;
 
     VCEncOut *enc_out            = (VCEncOut *)&enc_ctx->enc_out;
     VCEncInst *hantro_encoder    = &enc_ctx->hantro_encoder;
@@ -2967,6 +3058,14 @@ VpiRet vpi_h26xe_init(VpiH26xEncCtx *enc_ctx, VpiH26xEncCfg *enc_cfg)
         pthread_mutex_init(&enc_ctx->pic_wait_list[i].pic_mutex, NULL);
     }
     pthread_cond_init(&enc_ctx->h26xe_thd_cond, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&enc_ctx->h26xe_work_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    enc_ctx->h26xe_work_pending  = 0;
+    enc_ctx->h26xe_thd_idle      = 0;
+    enc_ctx->h26xe_wakeup_number = 0;
+    enc_ctx->h26xe_idle_time     = 0;
     enc_ctx->h26xe_thd_end = 0;
     ret = pthread_create(&enc_ctx->h26xe_thd_handle, NULL, h26x_encode_process,
                          enc_ctx);
@@ -3028,6 +3127,63 @@ int vpi_h26xe_ctrl(VpiH26xEncCtx *enc_ctx, void *indata, void *outdata)
     return ret;
 }
 
+/**
+ *  h26x_enc_copy_roi_map
+ *  Keep a copy of the ROI map of an input frame until the frame is encoded
+ *
+ *  @Params: enc_ctx The context of Vpi H26x encoder
+ *  @Params: trans_pic The wait list slot of the frame
+ *  @Params: map The ROI map of the frame, NULL if none
+ *  @Return: 0 on success, -1 for an invalid map or on allocation failure
+ */
+static int h26x_enc_copy_roi_map(VpiH26xEncCtx *enc_ctx,
+                                 VpiEncH26xPic *trans_pic, const VpiRoiMap *map)
+{
+    VPIH26xEncOptions *options = &enc_ctx->options;
+    u32 plane, size;
+    int y;
+
+    trans_pic->roi_map.qp = NULL;
+    if (map == NULL || !options->roi_map) {
+        return 0;
+    }
+
+    if (map->block_unit != options->roi_map_delta_qp_block_unit ||
+        map->qp == NULL || map->width <= 0 || map->height <= 0 ||
+        map->stride < map->width) {
+        VPILOGE("invalid ROI map: block unit %d (expect %d), %dx%d stride %d\n",
+                map->block_unit, options->roi_map_delta_qp_block_unit,
+                map->width, map->height, map->stride);
+        return -1;
+    }
+
+    plane = map->width * map->height;
+    size  = map->flags ? plane * 2 : plane;
+    if (size > trans_pic->roi_map_buf_size) {
+        free(trans_pic->roi_map_buf);
+        trans_pic->roi_map_buf      = malloc(size);
+        trans_pic->roi_map_buf_size = trans_pic->roi_map_buf ? size : 0;
+        if (trans_pic->roi_map_buf == NULL) {
+            VPILOGE("failed to allocate ROI map of %u bytes\n", size);
+            return -1;
+        }
+    }
+
+    for (y = 0; y < map->height; y++) {
+        memcpy(trans_pic->roi_map_buf + y * map->width,
+               map->qp + y * map->stride, map->width);
+        if (map->flags)
+            memcpy(trans_pic->roi_map_buf + plane + y * map->width,
+                   map->flags + y * map->stride, map->width);
+    }
+    trans_pic->roi_map        = *map;
+    trans_pic->roi_map.stride = map->width;
+    trans_pic->roi_map.qp     = (int8_t *)trans_pic->roi_map_buf;
+    trans_pic->roi_map.flags  = map->flags ? trans_pic->roi_map_buf + plane :
+                                             NULL;
+    return 0;
+}
+
 VpiRet vpi_h26xe_put_frame(VpiH26xEncCtx *enc_ctx, void *indata)
 {
     VPIH26xEncOptions *options = &enc_ctx->options;
@@ -3103,6 +3259,10 @@ VpiRet vpi_h26xe_put_frame(VpiH26xEncCtx *enc_ctx, void *indata)
             }
         }
 
+        if (h26x_enc_copy_roi_map(enc_ctx, trans_pic, frame->roi_map)) {
+            return -1;
+        }
+
         if (options->low_delay) {
             pthread_mutex_lock(&enc_ctx->h26xe_thd_mutex);
             enc_ctx->got_frame++;
@@ -3168,9 +3328,40 @@ VpiRet vpi_h26xe_put_frame(VpiH26xEncCtx *enc_ctx, void *indata)
         }
     }
 
+    pthread_mutex_lock(&enc_ctx->h26xe_thd_mutex);
+    h26x_enc_wakeup_worker(enc_ctx);
+    pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
+
     return 0;
 }
 
+/**
+ *  h26x_enc_release_packet
+ *  Give a zero copy packet's output buffer back to the encoder, installed
+ *  as VpiPacket.release. Must be called before the encoder is closed.
+ *
+ *  @Params: release_ctx The context of Vpi H26x encoder
+ *  @Params: data The data pointer of the released packet
+ */
+static void h26x_enc_release_packet(void *release_ctx, uint8_t *data)
+{
+    VpiH26xEncCtx *enc_ctx = (VpiH26xEncCtx *)release_ctx;
+    int i;
+
+    pthread_mutex_lock(&enc_ctx->h26xe_thd_mutex);
+    for (i = 0; i < enc_ctx->outstrm_num; i++) {
+        if (enc_ctx->outstream_mem[i] == (void *)data) {
+            enc_ctx->stream_buf_list[i]->used = 0;
+            h26x_enc_wakeup_worker(enc_ctx);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
+    if (i == enc_ctx->outstrm_num) {
+        VPILOGE("released packet %p is not an encoder buffer\n", data);
+    }
+}
+
 VpiRet vpi_h26xe_get_packet(VpiH26xEncCtx *enc_ctx, void *outdata)
 {
     VpiRet ret               = VPI_SUCCESS;
@@ -3187,7 +3378,25 @@ VpiRet vpi_h26xe_get_packet(VpiH26xEncCtx *enc_ctx, void *outdata)
             h26x_enc_buf_list_delete(enc_ctx->stream_buf_head);
     pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
     out_buffer = (VpiEncOutData *)buf->item;
-    if (vpi_packet->size != 0) {
+    vpi_packet->release     = NULL;
+    vpi_packet->release_ctx = NULL;
+    if (options->zero_copy_pkt) {
+        uint8_t *rc_buf = (uint8_t *)out_buffer->outbuf_mem->rc_busAddress;
+
+        vpi_packet->size = out_buffer->resend_header ?
+                           out_buffer->stream_size :
+                           (out_buffer->stream_size + out_buffer->header_size);
+        if (out_buffer->header_size != 0 &&
+            (out_buffer->stream_offset || out_buffer->resend_header)) {
+            memcpy(rc_buf, out_buffer->header_data, out_buffer->header_size);
+        }
+        if (out_buffer->stream_offset) {
+            out_buffer->header_size = 0;
+        }
+        vpi_packet->data        = rc_buf;
+        vpi_packet->release     = h26x_enc_release_packet;
+        vpi_packet->release_ctx = enc_ctx;
+    } else if (vpi_packet->size != 0) {
         packet_mem.rc_busAddress = (ptr_t)vpi_packet->data;
         packet_mem.size          = vpi_packet->size;
 
@@ -3274,7 +3483,12 @@ VpiRet vpi_h26xe_get_packet(VpiH26xEncCtx *enc_ctx, void *outdata)
                 cfg->average_square_of_error);
     }
 
-    buf->used = 0;
+    if (!options->zero_copy_pkt) {
+        pthread_mutex_lock(&enc_ctx->h26xe_thd_mutex);
+        buf->used = 0;
+        h26x_enc_wakeup_worker(enc_ctx);
+        pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
+    }
     return ret;
 }
 /**
@@ -3291,12 +3505,19 @@ VpiRet vpi_h26xe_close(VpiH26xEncCtx *enc_ctx)
     VPIH26xEncCfg *vpi_h26xe_cfg = &enc_ctx->vpi_h26xe_cfg;
     int i;
 
+    pthread_mutex_lock(&enc_ctx->h26xe_thd_mutex);
     enc_ctx->h26xe_thd_end = 1;
+    h26x_enc_wakeup_worker(enc_ctx);
+    pthread_mutex_unlock(&enc_ctx->h26xe_thd_mutex);
 
     h26x_enc_report(enc_ctx);
     if (enc_ctx != NULL) {
         if (enc_ctx->hantro_encoder != NULL) {
             pthread_join(enc_ctx->h26xe_thd_handle, NULL);
+            VPILOGI("h26x enc thread: %u wakeups, %llu ms idle\n",
+                    enc_ctx->h26xe_wakeup_number,
+                    (unsigned long long)enc_ctx->h26xe_idle_time / 1000);
+            pthread_cond_destroy(&enc_ctx->h26xe_work_cond);
             pthread_mutex_destroy(&enc_ctx->h26xe_thd_mutex);
             for (i = 0; i < MAX_WAIT_DEPTH; i++) {
                 pthread_mutex_destroy(&enc_ctx->pic_wait_list[i].pic_mutex);
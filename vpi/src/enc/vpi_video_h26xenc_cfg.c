@@ -66,6 +66,8 @@ static int h26x_enc_get_options(VpiH26xEncCtx *vpi_h26xe_ctx)
     if (options->lookahead_depth == DEFAULT)
         options->lookahead_depth = 0;
 
+    if (options->roi_map)
+        options->roi_map_delta_qp_enable = 1;
     if (options->lookahead_depth) {
         options->roi_map_delta_qp_enable = 1;
         options->roi_map_delta_qp_block_unit =
@@ -2103,6 +2105,9 @@ void h26x_enc_free_res(VpiH26xEncCtx *enc_ctx, VCEncInst enc)
             free(trans_pic->pic);
             trans_pic->pic = NULL;
         }
+        free(trans_pic->roi_map_buf);
+        trans_pic->roi_map_buf      = NULL;
+        trans_pic->roi_map_buf_size = 0;
     }
 
     if (enc_ctx->header_data) {
@@ -67,6 +67,9 @@
 
 #define DEFAULT_OUT_STRM_BUF_SIZE 0x200000
 
+/* upper bound of one idle wait of the encoding thread */
+#define H26XE_WORKER_IDLE_TIMEOUT_MS 10
+
 #define RESOLUTION_CHANGE_FLAG      1
 #define FPS_CHANGE_FLAG             2
 #define RESOLUTION_NEXT_CHANGE_FLAG 4
@@ -80,6 +83,10 @@ typedef struct {
     int new_flag;
     VpiFrame *pic;
     pthread_mutex_t pic_mutex;
+    /* copy of the frame's ROI map, qp is NULL if it has none */
+    VpiRoiMap roi_map;
+    u8 *roi_map_buf;
+    u32 roi_map_buf_size;
 } VpiEncH26xPic;
 
 typedef struct H26xEncBufLink {
@@ -187,6 +194,10 @@ typedef struct {
     EWLLinearMem_t transform_mem_factory[MAX_DELAY_NUM];
     EWLLinearMem_t roimap_cu_ctrl_infomem_factory[MAX_DELAY_NUM];
     EWLLinearMem_t roimap_cu_ctrl_indexmem_factory[MAX_DELAY_NUM];
+    /* ROI map of the frame being encoded, and which ROI map buffers
+     * still hold an earlier frame's map */
+    VpiRoiMap *frame_roi_map;
+    u8 roi_map_dirty[MAX_DELAY_NUM];
 
     EWLLinearMem_t scaled_picture_mem;
     float sum_square_of_error;
@@ -302,6 +313,7 @@ typedef struct {
   int poc_encoded;
   bool end_data;
   bool resend_header; /* resend header flag */
+  int stream_offset;  /* stream bytes start here in outbuf_mem (zero copy) */
   int64_t pts;
   int64_t dts;
 
@@ -359,6 +371,11 @@ typedef struct {
     pthread_mutex_t h26xe_thd_mutex;
     pthread_cond_t h26xe_thd_cond;
     int h26xe_thd_end;
+    pthread_cond_t h26xe_work_cond;
+    int h26xe_work_pending;
+    int h26xe_thd_idle;
+    u32 h26xe_wakeup_number;
+    u64 h26xe_idle_time; /* in us */
     VpiEncOutData enc_pkt[MAX_OUT_BUF_NUM];
 
     /* For idr passthrough */
@@ -608,6 +608,33 @@ VPIH26xParamsDef h26x_enc_param_table[] = {
       { .i64 = 0 },
       OPT_FLAG_VCE | OPT_FLAG_MULTI | OPT_FLAG_EN,
       "[VC8000E] enable low delay" },
+    { "zero_copy_pkt",
+      COM_SHORT,
+      TYPE_INT,
+      0,
+      1,
+      OFFSETM_VCE(zero_copy_pkt),
+      { .i64 = 0 },
+      OPT_FLAG_VCE | OPT_FLAG_MULTI | OPT_FLAG_EN,
+      "zero copy output packets, released by pkt->release" },
+    { "roi_map",
+      COM_SHORT,
+      TYPE_INT,
+      0,
+      2,
+      OFFSETM_VCE(roi_map),
+      { .i64 = 0 },
+      OPT_FLAG_VCE | OPT_FLAG_MULTI | OPT_FLAG_EN,
+      "[VC8000E] per-frame ROI map, 0: off 1: QP map 2: QP map and IPCM/skip flags" },
+    { "roi_map_block_unit",
+      COM_SHORT,
+      TYPE_INT,
+      0,
+      3,
+      OFFSETM_VCE(roi_map_delta_qp_block_unit),
+      { .i64 = 0 },
+      OPT_FLAG_VCE | OPT_FLAG_MULTI | OPT_FLAG_EN,
+      "[VC8000E] ROI map block size, 0: 64x64 1: 32x32 2: 16x16 3: 8x8" },
     { NULL },
 };
 
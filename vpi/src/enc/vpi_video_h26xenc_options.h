@@ -407,6 +407,12 @@ typedef struct {
     char *pic_rc_path;
 
     u32 low_delay;
+
+    /* hand out packets pointing at the output hugepages */
+    u32 zero_copy_pkt;
+
+    /* per-frame ROI maps from VpiFrame.roi_map, 2 also uses their flags */
+    u32 roi_map;
 } VPIH26xEncOptions;
 
 #define NOCARE (-255)
@@ -64,6 +64,8 @@
 #include "vpi_log.h"
 #include "vpi_video_h26xenc_options.h"
 #include "vpi_video_h26xenc_utils.h"
+#include "vpi_video_enc_tile.h"
+#include "vpi_video_enc_roi.h"
 
 #define MAX_LINE_LENGTH_BLOCK 512 * 8
 #define ENC_TB_INFO_PRINT(fmt, ...)                                            \
@@ -817,6 +819,56 @@ static int copy_flags_map_2_memory(VPIH26xEncOptions *options, VCEncInst enc,
     return 0;
 }
 
+/* pack the ROI map sent with the frame, or clear the map buffer if the
+ * frame has none but an earlier frame left its map there */
+static i32 copy_frame_roi_map_2_memory(VPIH26xEncOptions *options,
+                                       VCEncInst enc,
+                                       VPIH26xEncCfg *vpi_h26xe_cfg)
+{
+    EWLLinearMem_t *mem = vpi_h26xe_cfg->roi_map_delta_qp_mem;
+    u32 index = mem - vpi_h26xe_cfg->roi_map_delta_qpmem_factory;
+    VpiRoiMap *map = vpi_h26xe_cfg->frame_roi_map;
+    VpiEncRoiLayout layout;
+    u32 size;
+#ifdef USE_OLD_DRV
+    u8 *memory = (u8 *)mem->virtualAddress;
+#else
+    u8 *memory = (u8 *)mem->rc_virtualAddress;
+#endif
+
+    layout.ctb_per_row =
+        (options->width + options->max_cu_size - 1) / options->max_cu_size;
+    layout.ctb_per_column =
+        (options->height + options->max_cu_size - 1) / options->max_cu_size;
+    layout.ctb_size = options->max_cu_size;
+    layout.version =
+        ((struct vcenc_instance *)enc)->asic.regs.asicCfg.roiMapVersion;
+    if (layout.version == 3)
+        layout.version = options->roi_qp_delta_ver;
+    size = vpi_enc_roi_map_size(&layout);
+
+    if (map == NULL) {
+        if (!vpi_h26xe_cfg->roi_map_dirty[index])
+            return OK;
+        memset(memory, 0, size);
+        vpi_h26xe_cfg->roi_map_dirty[index] = 0;
+    } else {
+        if (vpi_enc_pack_roi_map(memory, &layout, map)) {
+            VPILOGE("ROI map %dx%d does not cover %dx%d with block unit %d\n",
+                    map->width, map->height, options->width, options->height,
+                    map->block_unit);
+            return NOK;
+        }
+        vpi_h26xe_cfg->roi_map_dirty[index] = 1;
+    }
+
+#ifndef USE_OLD_DRV
+    if (EWLTransDataRC2EP(vpi_h26xe_cfg->ewl, mem, mem, size))
+        return NOK;
+#endif
+    return OK;
+}
+
 float get_pixel_width_inbyte(VCEncPictureType type)
 {
     switch (type) {
@@ -1197,7 +1249,6 @@ static void trans_yuv_to_fbformat(VPIH26xEncCfg *tb,
                                   VPIH26xEncOptions *options, i32 *ret)
 {
     u8 *transform_buf;
-    u32 x, y;
     VCEncIn *p_enc_in = &(tb->enc_in);
 #ifdef USE_OLD_DRV
     transform_buf = (u8 *)tb->transform_mem->virtualAddress;
@@ -1221,32 +1272,22 @@ static void trans_yuv_to_fbformat(VPIH26xEncCfg *tb,
         u32 stride =
             (options->lum_width_src * 4 * byte_per_compt + alignment - 1) &
             (~(alignment - 1));
+        u32 src_stride =
+            ((options->lum_width_src + 15) & (~15)) * byte_per_compt;
 
         /*luma*/
-        for (x = 0; x < options->lum_width_src / 4; x++) {
-            for (y = 0; y < options->lum_height_src; y++)
-                memcpy(transform_buf + y % 4 * 4 * byte_per_compt +
-                           stride * (y / 4) + x * 16 * byte_per_compt,
-                       tb->lum +
-                           y * ((options->lum_width_src + 15) & (~15)) *
-                               byte_per_compt +
-                           x * 4 * byte_per_compt,
-                       4 * byte_per_compt);
-        }
+        vpi_enc_raster_to_tile4x4(transform_buf, stride, tb->lum, src_stride,
+                                  options->lum_width_src / 4,
+                                  options->lum_height_src,
+                                  4 * byte_per_compt);
 
         transform_buf += stride * options->lum_height_src / 4;
 
         /*chroma*/
-        for (x = 0; x < options->lum_width_src / 4; x++) {
-            for (y = 0; y < ((options->lum_height_src / 2) + 3) / 4 * 4; y++)
-                memcpy(transform_buf + y % 4 * 4 * byte_per_compt +
-                           stride * (y / 4) + x * 16 * byte_per_compt,
-                       tb->cb +
-                           y * ((options->lum_width_src + 15) & (~15)) *
-                               byte_per_compt +
-                           x * 4 * byte_per_compt,
-                       4 * byte_per_compt);
-        }
+        vpi_enc_raster_to_tile4x4(transform_buf, stride, tb->cb, src_stride,
+                                  options->lum_width_src / 4,
+                                  ((options->lum_height_src / 2) + 3) / 4 * 4,
+                                  4 * byte_per_compt);
     }
 
     {
@@ -3517,6 +3558,11 @@ i32 setup_roi_map_buffer(VPIH26xEncCfg *tb, VPIH26xEncOptions *options,
             return NOK;
     }
 
+    if (options->roi_map && !tb->roi_map_file) {
+        if (copy_frame_roi_map_2_memory(options, encoder, tb))
+            return NOK;
+    }
+
     if (tb->ipcm_map_file || tb->skip_map_file) {
         if (copy_flags_map_2_memory(options, encoder, tb))
             return NOK;
@@ -3722,7 +3768,7 @@ int h26x_enc_get_pic_buffer(VpiH26xEncCtx *ctx, void *outdata)
         return -1;
     }
     if (trans_pic->pic == NULL) {
-        trans_pic->pic = malloc(sizeof(VpiFrame));
+        trans_pic->pic = calloc(1, sizeof(VpiFrame));
     }
     *frame = trans_pic->pic;
     return 0;
@@ -29,6 +29,8 @@
 
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include "cwl.h"
 #include "dectypes.h"
@@ -117,6 +119,7 @@ int vpi_encode_vp9_enc_process(VpiEncVp9Ctx *ctx)
     int idx;
 
     pthread_mutex_lock(&ctx->enc_thread_mutex);
+    ctx->enc_thread_idle = 0;
     if (input_limit < 4)  input_limit = 4;
 
     ctx->pic_tobe_free  = 0;
@@ -151,6 +154,7 @@ int vpi_encode_vp9_enc_process(VpiEncVp9Ctx *ctx)
                 enc_in->end_of_sequence = 1;
             } else {
                 VPILOGD("Input is NULL, wait new frame comein\n");
+                ctx->enc_thread_idle = 1;
                 pthread_mutex_unlock(&ctx->enc_thread_mutex);
                 return VPI_SUCCESS;
             }
@@ -232,6 +236,7 @@ int vpi_encode_vp9_enc_process(VpiEncVp9Ctx *ctx)
     idx = vp9enc_get_empty_stream_buffer(ctx);
     if (idx == -1) {
         VPILOGE("Can't find empty stream buffer, return\n");
+        ctx->enc_thread_idle = 1;
         pthread_mutex_unlock(&ctx->enc_thread_mutex);
         return VPI_SUCCESS;
     }
@@ -372,6 +377,46 @@ error:
     return VPI_ERR_ENCODE;
 }
 
+/* must be called with enc_thread_mutex held */
+static void vp9enc_wakeup_worker(VpiEncVp9Ctx *ctx)
+{
+    ctx->enc_work_pending = 1;
+    pthread_cond_signal(&ctx->enc_work_cond);
+}
+
+static void vp9enc_wait_for_work(VpiEncVp9Ctx *ctx)
+{
+    struct timespec start, end, deadline;
+    int ret = 0;
+
+    pthread_mutex_lock(&ctx->enc_thread_mutex);
+    if (ctx->enc_work_pending || ctx->enc_thread_finish) {
+        ctx->enc_work_pending = 0;
+        pthread_mutex_unlock(&ctx->enc_thread_mutex);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    deadline.tv_nsec += VP9ENC_WORKER_IDLE_TIMEOUT_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (!ctx->enc_work_pending && !ctx->enc_thread_finish &&
+           ret != ETIMEDOUT) {
+        ret = pthread_cond_timedwait(&ctx->enc_work_cond,
+                                     &ctx->enc_thread_mutex, &deadline);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ctx->enc_work_pending = 0;
+    ctx->enc_wakeup_number++;
+    ctx->enc_idle_time += (end.tv_sec - start.tv_sec) * 1000000LL +
+                          (end.tv_nsec - start.tv_nsec) / 1000;
+    pthread_mutex_unlock(&ctx->enc_thread_mutex);
+}
+
 void *vpi_venc_vp9_process(void *param)
 {
     VpiEncVp9Ctx *ctx = (VpiEncVp9Ctx *)param;
@@ -380,7 +425,10 @@ void *vpi_venc_vp9_process(void *param)
     while (!ctx->enc_thread_finish) {
         ret = vpi_encode_vp9_enc_process(ctx);
         if (ret == 0) {
-            usleep(500);
+            /* waiting for an input frame or a free stream buffer */
+            if (ctx->enc_thread_idle) {
+                vp9enc_wait_for_work(ctx);
+            }
         } else if (ret == -1) {
             break;
         }
@@ -397,6 +445,7 @@ VpiRet vpi_venc_vp9_init(VpiEncVp9Ctx *ctx, void *cfg)
     VpiEncParamSet *para_set  = vpi_setting->param_list;
     int num = sizeof(vp9enc_options) / sizeof(VpiEncSetting);
     int ret = 0, i = 0;
+    pthread_condattr_t cond_attr;
 
     if (ctx == NULL || cfg == NULL) {
         VPILOGE("vpi_venc_vp9_init parameters error\n");
@@ -459,6 +508,14 @@ VpiRet vpi_venc_vp9_init(VpiEncVp9Ctx *ctx, void *cfg)
 
     pthread_mutex_init(&ctx->enc_thread_mutex, NULL);
     pthread_cond_init(&ctx->enc_thread_cond, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctx->enc_work_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    ctx->enc_work_pending  = 0;
+    ctx->enc_thread_idle   = 0;
+    ctx->enc_wakeup_number = 0;
+    ctx->enc_idle_time     = 0;
     ctx->enc_thread_finish = 0;
     ret = pthread_create(&ctx->enc_thread_handle, NULL, vpi_venc_vp9_process, ctx);
     if (ret) {
@@ -799,6 +856,7 @@ VpiRet vpi_venc_vp9_put_frame(VpiEncVp9Ctx *ctx, void *indata)
         }
     }
 
+    vp9enc_wakeup_worker(ctx);
     pthread_mutex_unlock(&ctx->enc_thread_mutex);
     return VPI_SUCCESS;
 }
@@ -826,6 +884,7 @@ VpiRet vpi_venc_vp9_get_packet(VpiEncVp9Ctx *ctx, void *outdata)
                            VPI_PKT_FLAG_KEY : 0;
         buf->used = 0;
         buf->show = 0;
+        vp9enc_wakeup_worker(ctx);
         pthread_mutex_unlock(&ctx->enc_thread_mutex);
         return VPI_SUCCESS;
     }
@@ -856,6 +915,7 @@ VpiRet vpi_venc_vp9_get_packet(VpiEncVp9Ctx *ctx, void *outdata)
         return VPI_ERR_SW;
     }
     vp9enc_superframe(ctx, pkt);
+    vp9enc_wakeup_worker(ctx);
     pthread_mutex_unlock(&ctx->enc_thread_mutex);
     return VPI_SUCCESS;
 }
@@ -874,11 +934,17 @@ int vpi_venc_vp9_close(VpiEncVp9Ctx *ctx)
         return VPI_SUCCESS;
     }
 
+    pthread_mutex_lock(&ctx->enc_thread_mutex);
     ctx->enc_thread_finish = 1;
+    vp9enc_wakeup_worker(ctx);
+    pthread_mutex_unlock(&ctx->enc_thread_mutex);
 
     pthread_join(ctx->enc_thread_handle, NULL);
+    VPILOGI("vp9 enc thread: %u wakeups, %llu ms idle\n",
+            ctx->enc_wakeup_number, ctx->enc_idle_time / 1000);
     pthread_mutex_destroy(&ctx->enc_thread_mutex);
     pthread_cond_destroy(&ctx->enc_thread_cond);
+    pthread_cond_destroy(&ctx->enc_work_cond);
 
     if (ctx->encoder_is_open == true) {
         vp9enc_print_total(ctx);
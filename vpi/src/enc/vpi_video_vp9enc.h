@@ -48,6 +48,9 @@ typedef const void *VpiEncVp9Inst;
 
 #define SUPERFRAME_HEADER_SIZE 10     // 2 + 2 * frame_size(4bytes)
 
+/* upper bound of one idle wait of the encoding thread */
+#define VP9ENC_WORKER_IDLE_TIMEOUT_MS 10
+
 typedef struct {
     int state;
     int used;
@@ -302,6 +305,11 @@ typedef struct {
     int enc_thread_finish;
     int encode_end;
     int waiting_for_pkt;
+    pthread_cond_t enc_work_cond;
+    int enc_work_pending;
+    int enc_thread_idle;
+    unsigned int enc_wakeup_number;
+    unsigned long long enc_idle_time; /* in us */
 
     /*Input VpiFrame queue*/
     VpiEncVp9Pic pic_wait_list[MAX_WAIT_DEPTH];
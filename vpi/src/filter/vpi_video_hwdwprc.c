@@ -27,23 +27,390 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
 #include "dectypes.h"
 #include "hugepage_api.h"
 
 #include "vpi_types.h"
 #include "vpi_log.h"
+#include "vpi_video_prc.h"
 #include "vpi_video_hwdwprc.h"
 
+/* drop the buffer at index i, the last one takes its place */
+static void hwdw_pool_remove(VpiPrcCtx *vpi_ctx, int i)
+{
+    VpiHwDwPool *pool = &vpi_ctx->hwdw_pool;
+
+    vpi_prc_edma_unreg_buf(vpi_ctx, pool->bufs[i].handle);
+    fbtrans_free_huge_pages(pool->bufs[i].addr, pool->bufs[i].size);
+    pool->bufs[i] = pool->bufs[--pool->nb_bufs];
+}
+
+/* allocate and register a buffer of size into the pool, return its index
+ * or -1 */
+static int hwdw_pool_alloc(VpiPrcCtx *vpi_ctx, uint32_t size)
+{
+    VpiHwDwPool *pool = &vpi_ctx->hwdw_pool;
+    VpiHwDwBuf *bufs;
+    void *addr;
+    int max_bufs;
+
+    if (pool->nb_bufs == pool->max_bufs) {
+        max_bufs = pool->max_bufs ? pool->max_bufs * 2 : HWDW_POOL_IDLE_MAX;
+        bufs     = realloc(pool->bufs, max_bufs * sizeof(VpiHwDwBuf));
+        if (bufs == NULL)
+            return -1;
+        pool->bufs     = bufs;
+        pool->max_bufs = max_bufs;
+    }
+
+    addr = fbtrans_get_huge_pages(size);
+    if (addr == NULL)
+        return -1;
+    pool->bufs[pool->nb_bufs].addr = addr;
+    pool->bufs[pool->nb_bufs].size = size;
+    pool->bufs[pool->nb_bufs].used = 0;
+    pool->bufs[pool->nb_bufs].handle =
+        vpi_prc_edma_reg_buf(vpi_ctx, addr, size);
+
+    return pool->nb_bufs++;
+}
+
+/**
+ * hwdw_pool_set_geometry
+ * Set the plane sizes of the output frames. On the first frame or a
+ * resolution change, the idle buffers of other sizes are freed and
+ * HWDW_POOL_PREALLOC frames of the new sizes are allocated. Buffers still
+ * held by the APP are freed when they come back.
+ */
+static void hwdw_pool_set_geometry(VpiPrcCtx *vpi_ctx, uint32_t y_size,
+                                   uint32_t uv_size)
+{
+    VpiHwDwPool *pool = &vpi_ctx->hwdw_pool;
+    int i;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->y_size == y_size && pool->uv_size == uv_size) {
+        pthread_mutex_unlock(&pool->mutex);
+        return;
+    }
+    VPILOGD("hwdownload pool geometry %d/%d -> %d/%d\n", pool->y_size,
+            pool->uv_size, y_size, uv_size);
+
+    for (i = pool->nb_bufs - 1; i >= 0; i--) {
+        if (!pool->bufs[i].used)
+            hwdw_pool_remove(vpi_ctx, i);
+    }
+    pool->y_size  = y_size;
+    pool->uv_size = uv_size;
+    for (i = 0; i < HWDW_POOL_PREALLOC; i++) {
+        hwdw_pool_alloc(vpi_ctx, y_size);
+        hwdw_pool_alloc(vpi_ctx, uv_size);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/* get an idle buffer of size and its eDMA handle, allocate one if there
+ * is none */
+static void *hwdw_pool_get(VpiPrcCtx *vpi_ctx, uint32_t size,
+                           uint32_t *handle)
+{
+    VpiHwDwPool *pool = &vpi_ctx->hwdw_pool;
+    void *addr = NULL;
+    int i;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (i = 0; i < pool->nb_bufs; i++) {
+        if (!pool->bufs[i].used && pool->bufs[i].size == size) {
+            pool->hits++;
+            break;
+        }
+    }
+    if (i == pool->nb_bufs) {
+        pool->misses++;
+        i = hwdw_pool_alloc(vpi_ctx, size);
+    }
+    if (i >= 0) {
+        pool->bufs[i].used = 1;
+        addr    = pool->bufs[i].addr;
+        *handle = pool->bufs[i].handle;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return addr;
+}
+
+/**
+ * hwdw_pool_put
+ * Give a buffer back to the pool. It is kept for reuse if it fits the
+ * current geometry and less than HWDW_POOL_IDLE_MAX buffers are idle,
+ * otherwise it is freed.
+ * @Return: 0 on success, -1 if addr is not a buffer of the pool
+ */
+static int hwdw_pool_put(VpiPrcCtx *vpi_ctx, void *addr)
+{
+    VpiHwDwPool *pool = &vpi_ctx->hwdw_pool;
+    int i, idle = 0, found = -1;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (i = 0; i < pool->nb_bufs; i++) {
+        if (pool->bufs[i].addr == addr)
+            found = i;
+        else if (!pool->bufs[i].used)
+            idle++;
+    }
+    if (found >= 0) {
+        if (idle < HWDW_POOL_IDLE_MAX &&
+            (pool->bufs[found].size == pool->y_size ||
+             pool->bufs[found].size == pool->uv_size)) {
+            pool->bufs[found].used = 0;
+        } else {
+            hwdw_pool_remove(vpi_ctx, found);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return found >= 0 ? 0 : -1;
+}
+
+static void hwdw_set_plane(VpiHwDwPlane *plane, void *dst, uint64_t src,
+                           uint32_t width, uint32_t rows, uint32_t dst_stride,
+                           uint32_t src_stride)
+{
+    plane->dst        = (uint64_t)dst;
+    plane->src        = src;
+    plane->width      = width;
+    plane->rows       = rows;
+    plane->dst_stride = dst_stride;
+    plane->src_stride = src_stride;
+}
+
+/* the decoder picture is released once every output has taken it */
+static void hwdw_release_input(VpiFrame *in_frame)
+{
+    pthread_mutex_lock(&in_frame->frame_mutex);
+    in_frame->used_cnt++;
+    pthread_mutex_unlock(&in_frame->frame_mutex);
+    if (in_frame->used_cnt == in_frame->nb_outputs) {
+        pthread_mutex_destroy(&in_frame->frame_mutex);
+    }
+}
+
+static int hwdw_run_job(VpiPrcCtx *vpi_ctx, VpiHwDwJob *job)
+{
+    VpiHwDwPlane *plane;
+    VpiEdmaSeg segs[2];
+    int i, ret = 0, vec = 1;
+
+    /* contiguous planes not in registered buffers go by one request */
+    for (i = 0; i < 2; i++) {
+        plane = &job->plane[i];
+        if (plane->handle || plane->rows != 1)
+            vec = 0;
+        segs[i].rc_addr = plane->dst;
+        segs[i].ep_addr = plane->src;
+        segs[i].size    = plane->width;
+        segs[i].direct  = EP2RC;
+    }
+    if (vec) {
+        ret = vpi_prc_edma_vec(vpi_ctx, segs, 2);
+        VPILOGD("dma planes from EP:0x%llx/0x%llx, %d/%d bytes\n",
+                (unsigned long long)segs[0].ep_addr,
+                (unsigned long long)segs[1].ep_addr, segs[0].size,
+                segs[1].size);
+    }
+
+    for (i = 0; i < 2 && ret == 0 && !vec; i++) {
+        plane = &job->plane[i];
+        if (plane->handle && plane->rows == 1) {
+            ret = vpi_prc_edma_buf_xfer(vpi_ctx, EP2RC, plane->handle, 0,
+                                        plane->src, plane->width);
+        } else {
+            ret = vpi_prc_edma_2d(vpi_ctx, EP2RC, plane->dst, plane->src,
+                                  plane->width, plane->rows, plane->dst_stride,
+                                  plane->src_stride);
+        }
+        VPILOGD("dma plane %d from EP:0x%llx to RC:0x%llx, %dx%d\n", i,
+                (unsigned long long)plane->src,
+                (unsigned long long)plane->dst, plane->width, plane->rows);
+    }
+    if (ret) {
+        VPILOGE("hwdownload transfer failed %d, fence %llu\n", ret,
+                (unsigned long long)job->fence);
+    }
+    hwdw_release_input((VpiFrame *)job->in_frame);
+
+    return ret;
+}
+
+static void *hwdw_async_process(void *arg)
+{
+    VpiPrcCtx *vpi_ctx   = (VpiPrcCtx *)arg;
+    VpiHwDwAsync *async = &vpi_ctx->hwdw_async;
+    VpiHwDwJob *job;
+    int ret;
+
+    pthread_mutex_lock(&async->mutex);
+    while (1) {
+        while (!async->nb_jobs && !async->exit)
+            pthread_cond_wait(&async->job_cond, &async->mutex);
+        /* the queued jobs are finished before exit */
+        if (!async->nb_jobs)
+            break;
+        job = &async->jobs[async->job_out];
+        pthread_mutex_unlock(&async->mutex);
+
+        ret = hwdw_run_job(vpi_ctx, job);
+
+        pthread_mutex_lock(&async->mutex);
+        async->result[job->fence % HWDW_FENCE_HISTORY] =
+            ret ? VPI_ERR_DEVICE : VPI_SUCCESS;
+        async->done_fence = job->fence;
+        async->job_out    = (async->job_out + 1) % HWDW_ASYNC_DEPTH_MAX;
+        async->nb_jobs--;
+        pthread_cond_broadcast(&async->done_cond);
+    }
+    pthread_mutex_unlock(&async->mutex);
+
+    return NULL;
+}
+
+/**
+ * hwdw_async_submit
+ * Queue a download in async mode, waiting while depth transfers are
+ * already in flight.
+ * @Return: the fence of the download, 0 if async mode is off
+ */
+static uint64_t hwdw_async_submit(VpiHwDwAsync *async, VpiHwDwJob *job)
+{
+    uint64_t fence = 0;
+
+    pthread_mutex_lock(&async->mutex);
+    if (async->depth) {
+        while (async->nb_jobs >= async->depth)
+            pthread_cond_wait(&async->done_cond, &async->mutex);
+        fence      = ++async->last_fence;
+        job->fence = fence;
+        async->jobs[async->job_in] = *job;
+        async->job_in = (async->job_in + 1) % HWDW_ASYNC_DEPTH_MAX;
+        async->nb_jobs++;
+        pthread_cond_signal(&async->job_cond);
+    }
+    pthread_mutex_unlock(&async->mutex);
+
+    return fence;
+}
+
+/* set the transfers in flight, 0 back to the synchronous mode */
+static int hwdw_async_set_depth(VpiPrcCtx *vpi_ctx, int depth)
+{
+    VpiHwDwAsync *async = &vpi_ctx->hwdw_async;
+    int ret = 0;
+
+    if (depth < 0)
+        depth = 0;
+    if (depth > HWDW_ASYNC_DEPTH_MAX)
+        depth = HWDW_ASYNC_DEPTH_MAX;
+
+    pthread_mutex_lock(&async->mutex);
+    /* the queued downloads are done before the mode changes */
+    while (async->nb_jobs)
+        pthread_cond_wait(&async->done_cond, &async->mutex);
+    if (depth && !async->thread_created) {
+        ret = pthread_create(&async->thread, NULL, hwdw_async_process,
+                             vpi_ctx);
+        if (ret) {
+            VPILOGE("create hwdownload thread failed %d\n", ret);
+            depth = 0;
+        } else {
+            async->thread_created = 1;
+        }
+    }
+    async->depth = depth;
+    pthread_mutex_unlock(&async->mutex);
+
+    VPILOGD("hwdownload async depth %d\n", depth);
+    return ret;
+}
+
+/**
+ * hwdw_async_wait
+ * Wait for or poll the download of a fence.
+ * @Return: 1 if it's done, 0 if it's still running at the timeout,
+ *          a negative VpiRet if it failed
+ */
+static int hwdw_async_wait(VpiHwDwAsync *async, VpiHwDwFence *req)
+{
+    struct timespec deadline;
+    uint64_t fence;
+    int status;
+
+    pthread_mutex_lock(&async->mutex);
+    fence = req->fence ? req->fence : async->last_fence;
+    if (fence > async->last_fence) {
+        pthread_mutex_unlock(&async->mutex);
+        VPILOGE("hwdownload fence %llu is not handed out\n",
+                (unsigned long long)fence);
+        return VPI_ERR_SW;
+    }
+
+    if (req->timeout_ms > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += req->timeout_ms / 1000;
+        deadline.tv_nsec += (req->timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    while (async->done_fence < fence && req->timeout_ms != 0) {
+        if (req->timeout_ms < 0) {
+            pthread_cond_wait(&async->done_cond, &async->mutex);
+        } else if (pthread_cond_timedwait(&async->done_cond, &async->mutex,
+                                          &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    if (async->done_fence < fence) {
+        status = 0;
+    } else if (async->done_fence < fence + HWDW_FENCE_HISTORY &&
+               async->result[fence % HWDW_FENCE_HISTORY]) {
+        status = async->result[fence % HWDW_FENCE_HISTORY];
+    } else {
+        status = 1;
+    }
+    pthread_mutex_unlock(&async->mutex);
+
+    return status;
+}
+
 VpiRet vpi_prc_hwdw_init(VpiPrcCtx *vpi_ctx, void *cfg)
 {
     char *device = (char *)cfg;
+    VpiHwDwAsync *async = &vpi_ctx->hwdw_async;
+    pthread_condattr_t cond_attr;
 
-    vpi_ctx->edma_handle = TRANS_EDMA_init(device);
-    if (vpi_ctx->edma_handle == NULL) {
+    if (vpi_prc_edma_open(vpi_ctx, device) != VPI_SUCCESS) {
         VPILOGE("hwdownload edma_handle init failed!\n");
         return VPI_ERR_DEVICE;
     }
 
+    pthread_mutex_init(&vpi_ctx->hwdw_pool.mutex, NULL);
+    vpi_ctx->hwdw_pool.inited = 1;
+
+    pthread_mutex_init(&async->mutex, NULL);
+    pthread_cond_init(&async->job_cond, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&async->done_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    async->inited = 1;
+
     return VPI_SUCCESS;
 }
 
@@ -57,9 +424,8 @@ VpiRet vpi_prc_hwdw_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
     addr_t bus_address_lum = 0, bus_address_chroma = 0;
     uint32_t y_size, uv_size;
     uint32_t linesize[2];
-    int i;
-    uint64_t dst_addr;
     uint32_t uv_height;
+    VpiHwDwJob job;
 
     pic      = (struct DecPicturePpu *)in_frame->data[0];
     pic_info = &pic->pictures[vpi_ctx->pp_index];
@@ -81,6 +447,11 @@ VpiRet vpi_prc_hwdw_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
     y_size      = pic_info->pic_width * pic_info->pic_height * (pix_width / 8);
     uv_size = pic_info->pic_width * pic_info->pic_height * (pix_width / 8) / 2;
 
+    bus_address_lum    = pic_info->luma.bus_address;
+    bus_address_chroma = pic_info->chroma.bus_address;
+    memset(&job, 0, sizeof(job));
+    job.in_frame = in_frame;
+
     if (out_frame->linesize[0] == 0 && out_frame->linesize[1] == 0) {
         // use hwdownload_vpe
         out_frame->width  = pic_info->pic_width;
@@ -95,24 +466,27 @@ VpiRet vpi_prc_hwdw_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
         out_frame->linesize[1] = linesize[1];
         out_frame->src_width   = y_size;
         out_frame->src_height  = uv_size;
-        out_frame->data[0]     = fbtrans_get_huge_pages(y_size);
+        hwdw_pool_set_geometry(vpi_ctx, y_size, uv_size);
+        out_frame->data[0] =
+            hwdw_pool_get(vpi_ctx, y_size, &job.plane[0].handle);
         if (out_frame->data[0] == NULL) {
             VPILOGE("No memory available for the frame buffer\n");
             return VPI_ERR_NO_AP_MEM;
         }
 
-        out_frame->data[1] = fbtrans_get_huge_pages(uv_size);
+        out_frame->data[1] =
+            hwdw_pool_get(vpi_ctx, uv_size, &job.plane[1].handle);
         if (out_frame->data[1] == NULL) {
             VPILOGE("No memory available for the frame buffer\n");
+            hwdw_pool_put(vpi_ctx, out_frame->data[0]);
+            out_frame->data[0] = NULL;
             return VPI_ERR_NO_AP_MEM;
         }
 
-        bus_address_lum    = pic_info->luma.bus_address;
-        bus_address_chroma = pic_info->chroma.bus_address;
-        TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle, bus_address_lum,
-                                 (uint64_t)out_frame->data[0], y_size);
-        TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle, bus_address_chroma,
-                                 (uint64_t)out_frame->data[1], uv_size);
+        hwdw_set_plane(&job.plane[0], out_frame->data[0], bus_address_lum,
+                       y_size, 1, y_size, y_size);
+        hwdw_set_plane(&job.plane[1], out_frame->data[1], bus_address_chroma,
+                       uv_size, 1, uv_size, uv_size);
     } else {
         // use hwdownload
         if (out_frame->linesize[0] < linesize[0] ||
@@ -126,47 +500,28 @@ VpiRet vpi_prc_hwdw_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
 
         if (out_frame->linesize[0] == linesize[0] &&
             out_frame->linesize[1] == linesize[1]) {
-            bus_address_lum    = pic_info->luma.bus_address;
-            bus_address_chroma = pic_info->chroma.bus_address;
-            TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle, bus_address_lum,
-                                     (uint64_t)out_frame->data[0], y_size);
-            TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle, bus_address_chroma,
-                                     (uint64_t)out_frame->data[1], uv_size);
+            hwdw_set_plane(&job.plane[0], out_frame->data[0], bus_address_lum,
+                           y_size, 1, y_size, y_size);
+            hwdw_set_plane(&job.plane[1], out_frame->data[1],
+                           bus_address_chroma, uv_size, 1, uv_size, uv_size);
         } else {
-            for (i = 0; i < pic_info->pic_height; i++) {
-                bus_address_lum = pic_info->luma.bus_address + i * linesize[0];
-                dst_addr =
-                    (uint64_t)out_frame->data[0] + i * out_frame->linesize[0];
-                TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle, bus_address_lum,
-                                         dst_addr, linesize[0]);
-            }
+            // one 2D transfer per plane from the SDK stride to the APP's
             uv_height = (pic_info->pic_height + 1) / 2;
-            for (i = 0; i < uv_height; i++) {
-                bus_address_chroma =
-                    pic_info->chroma.bus_address + i * linesize[1];
-                dst_addr =
-                    (uint64_t)out_frame->data[1] + i * out_frame->linesize[1];
-                TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle,
-                                         bus_address_chroma, dst_addr,
-                                         linesize[1]);
-            }
+            hwdw_set_plane(&job.plane[0], out_frame->data[0], bus_address_lum,
+                           linesize[0], pic_info->pic_height,
+                           out_frame->linesize[0], linesize[0]);
+            hwdw_set_plane(&job.plane[1], out_frame->data[1],
+                           bus_address_chroma, linesize[1], uv_height,
+                           out_frame->linesize[1], linesize[1]);
         }
     }
 
-    pthread_mutex_lock(&in_frame->frame_mutex);
-    in_frame->used_cnt++;
-    pthread_mutex_unlock(&in_frame->frame_mutex);
-    if (in_frame->used_cnt == in_frame->nb_outputs) {
-        pthread_mutex_destroy(&in_frame->frame_mutex);
-    }
-
     VPILOGD("linesize %d %d\n", out_frame->linesize[0], out_frame->linesize[1]);
 
-    VPILOGD("in %s:%d, dma get luma data from EP:%p to RC:%p \n", __FUNCTION__,
-            __LINE__, (void *)bus_address_lum, out_frame->data[0]);
-    VPILOGD("in %s:%d, dma get chroma data from EP:%p to RC:%p \n",
-            __FUNCTION__, __LINE__, (void *)bus_address_chroma,
-            out_frame->data[1]);
+    out_frame->fence = hwdw_async_submit(&vpi_ctx->hwdw_async, &job);
+    if (out_frame->fence == 0 && hwdw_run_job(vpi_ctx, &job)) {
+        return VPI_ERR_DEVICE;
+    }
 
     return VPI_SUCCESS;
 }
@@ -177,12 +532,23 @@ VpiRet vpi_prc_hwdw_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
 
     switch (in_param->cmd) {
     case VPI_CMD_HWDW_FREE_BUF:
-        fbtrans_free_huge_pages(in_param->data, 8 * 1024);
+        if (hwdw_pool_put(vpi_ctx, in_param->data)) {
+            fbtrans_free_huge_pages(in_param->data, 8 * 1024);
+        }
         break;
     case VPI_CMD_HWDW_SET_INDEX: {
         vpi_ctx->pp_index = *(int *)in_param->data;
         break;
     }
+    case VPI_CMD_HWDW_SET_ASYNC:
+        if (hwdw_async_set_depth(vpi_ctx, *(int *)in_param->data)) {
+            return VPI_ERR_SYSTEM;
+        }
+        break;
+    case VPI_CMD_HWDW_WAIT_FENCE:
+        *(int *)outdata = hwdw_async_wait(&vpi_ctx->hwdw_async,
+                                          (VpiHwDwFence *)in_param->data);
+        break;
     default:
         break;
     }
@@ -192,10 +558,43 @@ VpiRet vpi_prc_hwdw_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
 
 VpiRet vpi_prc_hwdw_close(VpiPrcCtx *vpi_ctx)
 {
-    if (vpi_ctx->edma_handle) {
-        TRANS_EDMA_release(vpi_ctx->edma_handle);
-        vpi_ctx->edma_handle = NULL;
+    VpiHwDwPool *pool   = &vpi_ctx->hwdw_pool;
+    VpiHwDwAsync *async = &vpi_ctx->hwdw_async;
+    int i, held = 0;
+
+    if (async->inited) {
+        if (async->thread_created) {
+            pthread_mutex_lock(&async->mutex);
+            async->exit = 1;
+            pthread_cond_signal(&async->job_cond);
+            pthread_mutex_unlock(&async->mutex);
+            pthread_join(async->thread, NULL);
+            async->thread_created = 0;
+        }
+        pthread_cond_destroy(&async->job_cond);
+        pthread_cond_destroy(&async->done_cond);
+        pthread_mutex_destroy(&async->mutex);
+        async->inited = 0;
     }
 
+    if (pool->inited) {
+        /* buffers the APP still holds are left to it */
+        for (i = pool->nb_bufs - 1; i >= 0; i--) {
+            if (pool->bufs[i].used)
+                held++;
+            else
+                hwdw_pool_remove(vpi_ctx, i);
+        }
+        VPILOGI("hwdownload pool: %u hits, %u misses, %d buffers held\n",
+                pool->hits, pool->misses, held);
+        free(pool->bufs);
+        pool->bufs   = NULL;
+        pool->inited = 0;
+        pthread_mutex_destroy(&pool->mutex);
+    }
+
+    /* the driver drops the registration of the held buffers on close */
+    vpi_prc_edma_close(vpi_ctx);
+
     return VPI_SUCCESS;
 }
@@ -34,12 +34,81 @@
 extern "C" {
 #endif
 
-#include "vpi_video_prc.h"
+#include <stdint.h>
+#include <pthread.h>
 
-VpiRet vpi_prc_hwdw_init(VpiPrcCtx *vpi_ctx, void *cfg);
-VpiRet vpi_prc_hwdw_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
-VpiRet vpi_prc_hwdw_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
-VpiRet vpi_prc_hwdw_close(VpiPrcCtx *vpi_ctx);
+/* max idle output buffers kept by the hwdownload pool */
+#define HWDW_POOL_IDLE_MAX 16
+/* frames preallocated when the pool geometry is set */
+#define HWDW_POOL_PREALLOC 4
+
+typedef struct {
+    void *addr;
+    uint32_t size;
+    int used;
+    /* eDMA handle of the registered buffer, 0 if it's not registered */
+    uint32_t handle;
+} VpiHwDwBuf;
+
+/* hugepage output buffers of hwdownload_vpe, recycled by
+ * VPI_CMD_HWDW_FREE_BUF and looked up by size */
+typedef struct VpiHwDwPool {
+    pthread_mutex_t mutex;
+    int inited;
+    /* plane sizes of the current geometry */
+    uint32_t y_size;
+    uint32_t uv_size;
+    /* every buffer handed out or idle */
+    VpiHwDwBuf *bufs;
+    int nb_bufs;
+    int max_bufs;
+    uint32_t hits;
+    uint32_t misses;
+} VpiHwDwPool;
+
+/* max transfers in flight in async mode */
+#define HWDW_ASYNC_DEPTH_MAX 16
+/* results kept for the latest fences, older fences report success */
+#define HWDW_FENCE_HISTORY 64
+
+/* one plane of a download, rows of width bytes */
+typedef struct {
+    uint64_t dst;
+    uint64_t src;
+    uint32_t width;
+    uint32_t rows;
+    uint32_t dst_stride;
+    uint32_t src_stride;
+    /* eDMA handle of a pool buffer at dst */
+    uint32_t handle;
+} VpiHwDwPlane;
+
+typedef struct {
+    uint64_t fence;
+    void *in_frame;
+    VpiHwDwPlane plane[2];
+} VpiHwDwJob;
+
+/* async hwdownload, the transfers run in order on one thread */
+typedef struct VpiHwDwAsync {
+    int inited;
+    /* transfers allowed in flight, 0 for the synchronous mode */
+    int depth;
+    int exit;
+    int thread_created;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t job_cond;
+    pthread_cond_t done_cond;
+    VpiHwDwJob jobs[HWDW_ASYNC_DEPTH_MAX];
+    int job_in;
+    int job_out;
+    int nb_jobs;
+    /* last fence handed out, and the fence all transfers are done up to */
+    uint64_t last_fence;
+    uint64_t done_fence;
+    int result[HWDW_FENCE_HISTORY];
+} VpiHwDwAsync;
 
 #ifdef __cplusplus
 }
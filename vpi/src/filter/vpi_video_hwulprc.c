@@ -31,6 +31,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 
 #include "dectypes.h"
@@ -329,6 +332,7 @@ static void  mwl_pic_consume_flush(VpiPrcHwUlCtx *ctx)
             ctx->pic_list[i].state = 0;
         }
     }
+    pthread_cond_broadcast(&ctx->pic_cond);
     pthread_mutex_unlock(&ctx->hw_upload_mutex);
 }
 
@@ -351,6 +355,7 @@ static void vpi_mwl_pic_consume(VpiPrcHwUlCtx *ctx, void *in_data)
                 free(picture);
                 ctx->pic_list[i].state = 0;
                 frame->data[0] = NULL;
+                pthread_cond_signal(&ctx->pic_cond);
                 break;
             }
         }
@@ -358,6 +363,183 @@ static void vpi_mwl_pic_consume(VpiPrcHwUlCtx *ctx, void *in_data)
     pthread_mutex_unlock(&ctx->hw_upload_mutex);
 }
 
+/* wait for a free picture, polling the pictures released by used_cnt */
+static int hwul_wait_empty_pic(VpiPrcHwUlCtx *ctx)
+{
+    struct timespec deadline;
+    int i;
+
+    while (1) {
+        mwl_pic_consume(ctx);
+
+        pthread_mutex_lock(&ctx->hw_upload_mutex);
+        for (i = 0; i < ctx->mwl_nums; i++) {
+            if (ctx->pic_list[i].state == 0) {
+                pthread_mutex_unlock(&ctx->hw_upload_mutex);
+                return i;
+            }
+        }
+        VPILOGD("can't find empty pic\n");
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += HWUL_PIC_WAIT_TIMEOUT_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&ctx->pic_cond, &ctx->hw_upload_mutex,
+                               &deadline);
+        pthread_mutex_unlock(&ctx->hw_upload_mutex);
+    }
+}
+
+static void *hwul_dma_process(void *arg)
+{
+    VpiPrcCtx *vpi_ctx = (VpiPrcCtx *)arg;
+    VpiPrcHwUlCtx *ctx = &(vpi_ctx->hwul_ctx);
+    VpiHwUlStage *stage;
+    int ret;
+
+    pthread_mutex_lock(&ctx->dma_mutex);
+    while (1) {
+        stage = &ctx->stage[ctx->stage_out];
+        while (!stage->pending && !ctx->dma_exit)
+            pthread_cond_wait(&ctx->dma_cond, &ctx->dma_mutex);
+        if (!stage->pending)
+            break;
+        pthread_mutex_unlock(&ctx->dma_mutex);
+
+        if (stage->src == stage->buf && stage->handle && stage->rows == 1) {
+            ret = vpi_prc_edma_buf_xfer(vpi_ctx, RC2EP, stage->handle, 0,
+                                        stage->ep_addr, stage->width);
+        } else {
+            ret = vpi_prc_edma_2d(vpi_ctx, RC2EP, (uint64_t)stage->src,
+                                  stage->ep_addr, stage->width, stage->rows,
+                                  stage->src_stride, stage->ep_stride);
+        }
+        if (ret) {
+            VPILOGE("hwupload eDMA failed. ret %d, ep_addr 0x%llx, "
+                    "%dx%d stride %d/%d\n",
+                    ret, (unsigned long long)stage->ep_addr, stage->width,
+                    stage->rows, stage->src_stride, stage->ep_stride);
+        }
+
+        pthread_mutex_lock(&ctx->dma_mutex);
+        if (ret && !ctx->dma_error)
+            ctx->dma_error = ret;
+        stage->pending = 0;
+        ctx->stage_out = (ctx->stage_out + 1) % HWUL_STAGE_NUM;
+        pthread_cond_broadcast(&ctx->stage_cond);
+    }
+    pthread_mutex_unlock(&ctx->dma_mutex);
+
+    return NULL;
+}
+
+/* get the next staging buffer once its last transfer is done */
+static VpiHwUlStage *hwul_get_stage(VpiPrcHwUlCtx *ctx)
+{
+    VpiHwUlStage *stage;
+
+    pthread_mutex_lock(&ctx->dma_mutex);
+    stage = &ctx->stage[ctx->stage_in];
+    while (stage->pending)
+        pthread_cond_wait(&ctx->stage_cond, &ctx->dma_mutex);
+    pthread_mutex_unlock(&ctx->dma_mutex);
+
+    return stage;
+}
+
+static void hwul_submit_stage(VpiPrcHwUlCtx *ctx, VpiHwUlStage *stage,
+                              uint8_t *src, uint64_t ep_addr, uint32_t width,
+                              uint32_t rows, uint32_t src_stride,
+                              uint32_t ep_stride)
+{
+    pthread_mutex_lock(&ctx->dma_mutex);
+    stage->src        = src;
+    stage->ep_addr    = ep_addr;
+    stage->width      = width;
+    stage->rows       = rows;
+    stage->src_stride = src_stride;
+    stage->ep_stride  = ep_stride;
+    stage->pending    = 1;
+    ctx->stage_in  = (ctx->stage_in + 1) % HWUL_STAGE_NUM;
+    pthread_cond_signal(&ctx->dma_cond);
+    pthread_mutex_unlock(&ctx->dma_mutex);
+}
+
+/* wait for all submitted transfers, return the first error of them */
+static int hwul_wait_stages(VpiPrcHwUlCtx *ctx)
+{
+    int i, ret;
+
+    pthread_mutex_lock(&ctx->dma_mutex);
+    for (i = 0; i < HWUL_STAGE_NUM; i++) {
+        while (ctx->stage[i].pending)
+            pthread_cond_wait(&ctx->stage_cond, &ctx->dma_mutex);
+    }
+    ret            = ctx->dma_error;
+    ctx->dma_error = 0;
+    pthread_mutex_unlock(&ctx->dma_mutex);
+
+    return ret;
+}
+
+/**
+ * hwul_upload_plane
+ * Upload one plane to EP memory. The rows are copied to the EP stride
+ * into the staging buffers in turn, every filled buffer is handed to the
+ * eDMA thread. Rows of size beyond the input rows are sent as zeros.
+ * A hugepage input plane is sent without copy by one 2D transfer, when its
+ * stride is not above the EP stride.
+ * @Params: src: input plane, src_stride bytes per row, rows rows
+ *          stride: EP stride of the plane
+ *          size: bytes of the plane in EP memory
+ *          ep_addr: EP address of the plane
+ * @Return: 0 on success, -1 if a row does not fit a staging buffer
+ */
+static int hwul_upload_plane(VpiPrcHwUlCtx *ctx, uint8_t *src,
+                             uint32_t src_stride, uint32_t rows,
+                             uint32_t stride, uint32_t size, uint64_t ep_addr)
+{
+    uint32_t stage_rows = ctx->stage_size / stride;
+    uint32_t total_rows = size / stride;
+    uint32_t i, r, n, copy_rows;
+    VpiHwUlStage *stage;
+
+    /* only the alignment rows after the picture may be left unsent */
+    if (ctx->hugepage_input && src_stride <= stride &&
+        size <= ((rows + 7) / 8) * 8 * stride) {
+        hwul_submit_stage(ctx, hwul_get_stage(ctx), src, ep_addr, src_stride,
+                          rows, src_stride, stride);
+        ctx->direct_number++;
+        return 0;
+    }
+
+    if (stage_rows == 0 || src_stride > stride) {
+        VPILOGE("stride %d/%d doesn't fit staging buffer of %d bytes\n",
+                src_stride, stride, ctx->stage_size);
+        return -1;
+    }
+
+    for (i = 0; i < total_rows; i += n) {
+        n         = total_rows - i < stage_rows ? total_rows - i : stage_rows;
+        copy_rows = i >= rows ? 0 : rows - i < n ? rows - i : n;
+        stage     = hwul_get_stage(ctx);
+        for (r = 0; r < copy_rows; r++) {
+            memcpy(stage->buf + r * stride, src + (i + r) * src_stride,
+                   src_stride);
+        }
+        if (copy_rows < n) {
+            memset(stage->buf + copy_rows * stride, 0,
+                   (n - copy_rows) * stride);
+        }
+        hwul_submit_stage(ctx, stage, stage->buf, ep_addr + i * stride,
+                          n * stride, 1, n * stride, n * stride);
+    }
+
+    return 0;
+}
+
 VpiRet vpi_prc_hwul_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
 {
     VpiPrcHwUlCtx *ctx = &(vpi_ctx->hwul_ctx);
@@ -367,8 +549,6 @@ VpiRet vpi_prc_hwul_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
     unsigned long linesize32_y, linesize32_uv;
     uint32_t y_size,uv_size;
     int idx, ret;
-    uint8_t *addr_offset = NULL;
-    unsigned int i;
     struct DecPicturePpu *pic;
 
     mwl_pic_consume(ctx);
@@ -380,16 +560,7 @@ VpiRet vpi_prc_hwul_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
     }
     pthread_mutex_unlock(&ctx->hw_upload_mutex);
 
-    do {
-        idx = vpi_prc_get_empty_pic(ctx);
-        if (idx == -1) {
-            VPILOGD("can't find empty pic\n");
-            usleep(500);
-            mwl_pic_consume(ctx);
-        } else {
-            break;
-        }
-    } while (1);
+    idx = hwul_wait_empty_pic(ctx);
 
     pic = (struct DecPicturePpu *)ctx->pic_list[idx].pic_ppu;
     memset(pic, 0, sizeof(struct DecPicturePpu));
@@ -422,41 +593,24 @@ VpiRet vpi_prc_hwul_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata)
             in_frame->linesize[1], in_frame->linesize[2],
             linesize32_y, linesize32_uv);
 
-    //copy Y lines to hugepage buffer, then rc to ep
-    for (i = 0; i < in_frame->src_height; i++) {
-        addr_offset = ctx->p_hugepage_buf_y + i*linesize32_y;
-        memcpy(addr_offset, in_frame->data[0]+i*in_frame->linesize[0],
-               in_frame->linesize[0]);
-    }
-
-    ret = TRANS_EDMA_RC2EP_nonlink(vpi_ctx->edma_handle,
-                                   (u64)ctx->p_hugepage_buf_y,
-                                   pic->pictures[0].luma.bus_address, y_size);
-    if (ret) {
-        VPILOGE("TRANS_EDMA_RC2EP_nonlink failed. ret %d,"
-                "luma.bus_address %p, y_size %d\n",
-                ret, pic->pictures[0].luma.bus_address, y_size);
+    //copy Y and UV lines through the staging buffers, then rc to ep.
+    //NV12 and P010le chroma: 1 plane, UV
+    ret = hwul_upload_plane(ctx, in_frame->data[0], in_frame->linesize[0],
+                            in_frame->src_height, linesize32_y, y_size,
+                            pic->pictures[0].luma.bus_address);
+    if (ret == 0 && ctx->format != VPI_FMT_UYVY) {
+        ret = hwul_upload_plane(ctx, in_frame->data[1], in_frame->linesize[1],
+                                in_frame->src_height / 2, linesize32_uv,
+                                uv_size, pic->pictures[0].chroma.bus_address);
+    }
+    if (hwul_wait_stages(ctx) || ret) {
+        VPILOGE("upload failed, luma.bus_address %p, y_size %d,"
+                "chroma.bus_address %p, uv_size %d\n",
+                pic->pictures[0].luma.bus_address, y_size,
+                pic->pictures[0].chroma.bus_address, uv_size);
         return -1;
     }
-    if (ctx->format != VPI_FMT_UYVY) {
-        //copy UV lines to hugepage buffer, then rc to ep.
-        //NV12 and P010le chroma: 1 plane, UV
-        for (i = 0; i < in_frame->src_height/2; i++) {
-            memcpy(ctx->p_hugepage_buf_uv+i*linesize32_uv,
-                    in_frame->data[1]+i*in_frame->linesize[1],
-                    in_frame->linesize[1]);
-        }
-        ret = TRANS_EDMA_RC2EP_nonlink(vpi_ctx->edma_handle,
-                                       (u64)ctx->p_hugepage_buf_uv,
-                                       pic->pictures[0].chroma.bus_address,
-                                       uv_size);
-        if (ret) {
-            VPILOGE("TRANS_EDMA_RC2EP_nonlink failed. ret %d,"
-                    "chroma.bus_address %p, uv_size %d\n",
-                    ret, pic->pictures[0].chroma.bus_address, uv_size);
-            return -1;
-        }
-    }
+    ctx->frame_number++;
 
     ctx->pic_list[idx].state = 1;
     ctx->pic_list[idx].pic   = out_frame;
@@ -474,13 +628,14 @@ VpiRet vpi_prc_hwul_init(VpiPrcCtx *vpi_ctx, void *cfg)
     VpiHWUploadCfg *vpi_cfg = (VpiHWUploadCfg *)cfg;
     VpiFrame *frame = vpi_cfg->frame;
     uint32_t align_width, align_height;
+    pthread_condattr_t cond_attr;
     int i;
 
-    vpi_ctx->edma_handle = TRANS_EDMA_init(vpi_cfg->device);
-    if (vpi_ctx->edma_handle == NULL) {
+    if (vpi_prc_edma_open(vpi_ctx, vpi_cfg->device) != VPI_SUCCESS) {
         VPILOGE("hwupload edma_handle init failed!\n");
         return VPI_ERR_DEVICE;
     }
+    vpi_prc_edma_set_prio(vpi_ctx, vpi_cfg->priority);
 
     frame->raw_format          = vpi_cfg->format;
     frame->pic_info[0].enabled = 1;
@@ -521,6 +676,7 @@ VpiRet vpi_prc_hwul_init(VpiPrcCtx *vpi_ctx, void *cfg)
     frame->flag |= HWUPLOAD_FLAG;
     ctx->frame   = frame;
     ctx->format  = vpi_cfg->format;
+    ctx->hugepage_input = vpi_cfg->hugepage_input;
 
     //malloc EP buffer
     MWLInitParam mwlParam = {DWL_CLIENT_TYPE_ST_PP,
@@ -545,10 +701,20 @@ VpiRet vpi_prc_hwul_init(VpiPrcCtx *vpi_ctx, void *cfg)
         VPI_FMT_UYVY == vpi_cfg->format)
         ctx->i_hugepage_size_y *= 2;
 
-    ctx->p_hugepage_buf_y   = fbtrans_get_huge_pages(ctx->i_hugepage_size_y);
     if(VPI_FMT_UYVY != vpi_cfg->format) {
         ctx->i_hugepage_size_uv = ctx->i_hugepage_size_y/2;
-        ctx->p_hugepage_buf_uv  = fbtrans_get_huge_pages(ctx->i_hugepage_size_uv);
+    }
+
+    ctx->stage_size = ctx->i_hugepage_size_y / HWUL_STAGE_SPLIT;
+    for (i = 0; i < HWUL_STAGE_NUM; i++) {
+        ctx->stage[i].buf = fbtrans_get_huge_pages(ctx->stage_size);
+        if (ctx->stage[i].buf == NULL) {
+            VPILOGE("failed to get staging buffer of %d bytes\n",
+                    ctx->stage_size);
+            return -1;
+        }
+        ctx->stage[i].handle =
+            vpi_prc_edma_reg_buf(vpi_ctx, ctx->stage[i].buf, ctx->stage_size);
     }
 
     ctx->mwl_item_size  = ctx->i_hugepage_size_y + ctx->i_hugepage_size_uv;
@@ -569,6 +735,19 @@ VpiRet vpi_prc_hwul_init(VpiPrcCtx *vpi_ctx, void *cfg)
         ctx->pic_list[i].pic_ppu = malloc(sizeof(struct DecPicturePpu));
     }
     pthread_mutex_init(&ctx->hw_upload_mutex, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ctx->pic_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    pthread_mutex_init(&ctx->dma_mutex, NULL);
+    pthread_cond_init(&ctx->dma_cond, NULL);
+    pthread_cond_init(&ctx->stage_cond, NULL);
+    if (pthread_create(&ctx->dma_thread, NULL, hwul_dma_process, vpi_ctx)) {
+        VPILOGE("failed to create hwupload eDMA thread\n");
+        return -1;
+    }
+    ctx->dma_thread_created = 1;
 
     return VPI_SUCCESS;
 }
@@ -603,11 +782,26 @@ VpiRet vpi_prc_hwul_close(VpiPrcCtx *vpi_ctx)
 
     mwl_pic_consume_flush(ctx);
 
-    if (vpi_ctx->edma_handle) {
-        TRANS_EDMA_release(vpi_ctx->edma_handle);
-        vpi_ctx->edma_handle = NULL;
+    if (ctx->dma_thread_created) {
+        pthread_mutex_lock(&ctx->dma_mutex);
+        ctx->dma_exit = 1;
+        pthread_cond_signal(&ctx->dma_cond);
+        pthread_mutex_unlock(&ctx->dma_mutex);
+        pthread_join(ctx->dma_thread, NULL);
+        ctx->dma_thread_created = 0;
+        pthread_cond_destroy(&ctx->dma_cond);
+        pthread_cond_destroy(&ctx->stage_cond);
+        pthread_mutex_destroy(&ctx->dma_mutex);
+        VPILOGI("hwupload: %u frames, %u planes uploaded without copy\n",
+                ctx->frame_number, ctx->direct_number);
     }
 
+    for (i = 0; i < HWUL_STAGE_NUM; i++) {
+        vpi_prc_edma_unreg_buf(vpi_ctx, ctx->stage[i].handle);
+        ctx->stage[i].handle = 0;
+    }
+    vpi_prc_edma_close(vpi_ctx);
+
     if(ctx->mwl){
         for(i = 0; i < ctx->mwl_nums; i++)
             mwl_free_linear(ctx->mwl, &(ctx->pic_list[i].mwl_mem));
@@ -618,16 +812,14 @@ VpiRet vpi_prc_hwul_close(VpiPrcCtx *vpi_ctx)
         free(ctx->pic_list[i].pic_ppu);
     }
 
+    pthread_cond_destroy(&ctx->pic_cond);
     pthread_mutex_destroy(&ctx->hw_upload_mutex);
 
-    if(ctx->p_hugepage_buf_y != NULL){
-        fbtrans_free_huge_pages(ctx->p_hugepage_buf_y, ctx->i_hugepage_size_y);
-        ctx->p_hugepage_buf_y = NULL;
-    }
-    if(ctx->p_hugepage_buf_uv != NULL){
-        fbtrans_free_huge_pages(ctx->p_hugepage_buf_uv,
-                                ctx->i_hugepage_size_uv);
-        ctx->p_hugepage_buf_uv = NULL;
+    for (i = 0; i < HWUL_STAGE_NUM; i++) {
+        if (ctx->stage[i].buf != NULL) {
+            fbtrans_free_huge_pages(ctx->stage[i].buf, ctx->stage_size);
+            ctx->stage[i].buf = NULL;
+        }
     }
     return VPI_SUCCESS;
 }
\ No newline at end of file
@@ -39,6 +39,15 @@ extern "C" {
 
 #define MWL_BUF_DEPTH 68
 
+/* staging buffers used in turn, so the copy into one overlaps the eDMA
+ * out of the other */
+#define HWUL_STAGE_NUM 2
+/* one staging buffer holds this fraction of the luma plane */
+#define HWUL_STAGE_SPLIT 4
+/* upper bound of one wait for a free picture, pictures released through
+ * used_cnt are only found by polling */
+#define HWUL_PIC_WAIT_TIMEOUT_MS 10
+
 typedef struct {
     int state;
     VpiFrame *pic;
@@ -46,25 +55,57 @@ typedef struct {
     struct DWLLinearMem mwl_mem;
 } VpiHwUlPic;
 
+typedef struct {
+    /* hugepage staging buffer, and its eDMA handle if it's registered */
+    uint8_t *buf;
+    uint32_t handle;
+    /* transfer waiting for the eDMA thread, src is buf or an input plane,
+     * rows of width bytes with src_stride/ep_stride bytes between them */
+    int pending;
+    uint8_t *src;
+    uint64_t ep_addr;
+    uint32_t width;
+    uint32_t rows;
+    uint32_t src_stride;
+    uint32_t ep_stride;
+} VpiHwUlStage;
+
 typedef struct VpiPrcHwUlCtx {
     void *mwl;
 
     int mwl_nums_init;
     u32 mwl_item_size;
 
-    uint8_t *p_hugepage_buf_y;
-    uint8_t *p_hugepage_buf_uv;
     uint32_t i_hugepage_size_y;
     uint32_t i_hugepage_size_uv;
 
     VpiFrame *frame;
     VpiPixsFmt format;
+    int hugepage_input;
 
     int mwl_nums;
 
     pthread_mutex_t hw_upload_mutex;
+    /* signaled when a picture of pic_list gets free */
+    pthread_cond_t pic_cond;
 
     VpiHwUlPic pic_list[MWL_BUF_DEPTH];
+
+    /* eDMA thread draining the staging buffers in order */
+    VpiHwUlStage stage[HWUL_STAGE_NUM];
+    uint32_t stage_size;
+    int stage_in;
+    int stage_out;
+    int dma_error;
+    int dma_exit;
+    int dma_thread_created;
+    pthread_t dma_thread;
+    pthread_mutex_t dma_mutex;
+    pthread_cond_t dma_cond;
+    pthread_cond_t stage_cond;
+
+    uint32_t frame_number;
+    uint32_t direct_number;
 }VpiPrcHwUlCtx;
 
 
@@ -13,6 +13,14 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+#include "transcoder.h"
+#include "trans_fd_api.h"
+
 #include "vpi_log.h"
 #include "vpi_video_prc.h"
 #include "vpi_video_hwdwprc.h"
@@ -112,3 +120,240 @@ int vpi_vprc_close(VpiPrcCtx *vpi_ctx)
 
     return ret;
 }
+
+/**
+ * vpi_prc_edma_open
+ * Get the eDMA handle of the device, and open the device for the 2D eDMA
+ * transfer. Without the device fd, vpi_prc_edma_2d goes row by row.
+ * @Params: device: transcoder device name
+ * @Return: VPI_SUCCESS, or VPI_ERR_DEVICE if the eDMA can't be used
+ */
+VpiRet vpi_prc_edma_open(VpiPrcCtx *vpi_ctx, const char *device)
+{
+    vpi_ctx->edma_fd     = -1;
+    vpi_ctx->edma_no_vec = 0;
+    vpi_ctx->edma_handle = TRANS_EDMA_init((char *)device);
+    if (vpi_ctx->edma_handle == NULL) {
+        return VPI_ERR_DEVICE;
+    }
+
+    vpi_ctx->edma_fd = TranscodeOpenFD(device, O_RDWR | O_SYNC);
+    if (vpi_ctx->edma_fd == -1) {
+        VPILOGI("open %s failed, 2D eDMA goes row by row\n", device);
+    }
+
+    return VPI_SUCCESS;
+}
+
+void vpi_prc_edma_close(VpiPrcCtx *vpi_ctx)
+{
+    if (vpi_ctx->edma_fd > 0) {
+        TranscodeCloseFD(vpi_ctx->edma_fd);
+    }
+    vpi_ctx->edma_fd = -1;
+
+    if (vpi_ctx->edma_handle) {
+        TRANS_EDMA_release(vpi_ctx->edma_handle);
+        vpi_ctx->edma_handle = NULL;
+    }
+}
+
+/**
+ * vpi_prc_edma_2d
+ * Transfer height rows of width bytes between RC memory and EP memory,
+ * the rows are rc_stride bytes apart in RC memory and ep_stride bytes apart
+ * in EP memory. The driver sends them with one link table; a driver without
+ * CB_TRANX_EDMA_2D_TRANX gets one transfer per row instead.
+ * @Params: direct: RC2EP or EP2RC
+ *          rc_addr: RC virtual address of the first row
+ *          ep_addr: EP address of the first row
+ * @Return: 0 on success, others on failure
+ */
+int vpi_prc_edma_2d(VpiPrcCtx *vpi_ctx, uint32_t direct, uint64_t rc_addr,
+                    uint64_t ep_addr, uint32_t width, uint32_t height,
+                    uint32_t rc_stride, uint32_t ep_stride)
+{
+    struct trans_pcie_edma_2d edma_2d;
+    uint32_t i;
+    int ret = 0;
+
+    if (height == 1 || (rc_stride == width && ep_stride == width)) {
+        if (direct == RC2EP) {
+            return TRANS_EDMA_RC2EP_nonlink(vpi_ctx->edma_handle, rc_addr,
+                                            ep_addr, width * height);
+        }
+        return TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle, ep_addr,
+                                        rc_addr, width * height);
+    }
+
+    if (vpi_ctx->edma_fd > 0) {
+        edma_2d.rc_addr   = rc_addr;
+        edma_2d.ep_addr   = ep_addr;
+        edma_2d.width     = width;
+        edma_2d.height    = height;
+        edma_2d.rc_stride = rc_stride;
+        edma_2d.ep_stride = ep_stride;
+        edma_2d.direct    = direct;
+        if (ioctl(vpi_ctx->edma_fd, CB_TRANX_EDMA_2D_TRANX, &edma_2d) == 0) {
+            return 0;
+        }
+        if (errno != ENOTTY) {
+            VPILOGE("2D eDMA failed, errno %d, %dx%d stride %d/%d\n", errno,
+                    width, height, rc_stride, ep_stride);
+            return -1;
+        }
+        VPILOGI("driver has no 2D eDMA, transfer row by row\n");
+        TranscodeCloseFD(vpi_ctx->edma_fd);
+        vpi_ctx->edma_fd = -1;
+    }
+
+    for (i = 0; i < height && ret == 0; i++) {
+        if (direct == RC2EP) {
+            ret = TRANS_EDMA_RC2EP_nonlink(vpi_ctx->edma_handle,
+                                           rc_addr + (uint64_t)i * rc_stride,
+                                           ep_addr + (uint64_t)i * ep_stride,
+                                           width);
+        } else {
+            ret = TRANS_EDMA_EP2RC_nonlink(vpi_ctx->edma_handle,
+                                           ep_addr + (uint64_t)i * ep_stride,
+                                           rc_addr + (uint64_t)i * rc_stride,
+                                           width);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * vpi_prc_edma_set_prio
+ * Set the task priority of the eDMA transfers on the device fd, a LIVE
+ * transfer gets a free channel before the VOD ones.
+ * @Params: priority: TASK_LIVE or TASK_VOD
+ */
+void vpi_prc_edma_set_prio(VpiPrcCtx *vpi_ctx, int priority)
+{
+    uint32_t prio = priority == TASK_VOD ? TASK_VOD : TASK_LIVE;
+
+    if (vpi_ctx->edma_fd <= 0) {
+        return;
+    }
+
+    if (ioctl(vpi_ctx->edma_fd, CB_TRANX_EDMA_SET_PRIO, &prio) &&
+        errno != ENOTTY) {
+        VPILOGE("set eDMA priority %d failed, errno %d\n", priority, errno);
+    }
+}
+
+/**
+ * vpi_prc_edma_vec
+ * Transfer several segments with one ioctl. The driver chains the segments
+ * of each direction into one link table with one completion; a driver
+ * without CB_TRANX_EDMA_VEC_TRANX gets one transfer per segment instead.
+ * @Params: segs: up to VPI_EDMA_SEG_MAX segments, RC addresses are virtual
+ * @Return: 0 on success, others on failure
+ */
+int vpi_prc_edma_vec(VpiPrcCtx *vpi_ctx, const VpiEdmaSeg *segs, int seg_cnt)
+{
+    struct trans_edma_seg edma_segs[VPI_EDMA_SEG_MAX];
+    struct trans_edma_vec edma_vec;
+    int i, ret = 0;
+
+    if (seg_cnt <= 0 || seg_cnt > VPI_EDMA_SEG_MAX) {
+        VPILOGE("invalid eDMA segment count %d\n", seg_cnt);
+        return -1;
+    }
+
+    if (seg_cnt > 1 && vpi_ctx->edma_fd > 0 && !vpi_ctx->edma_no_vec) {
+        for (i = 0; i < seg_cnt; i++) {
+            edma_segs[i].rc_addr = segs[i].rc_addr;
+            edma_segs[i].ep_addr = segs[i].ep_addr;
+            edma_segs[i].size    = segs[i].size;
+            edma_segs[i].direct  = segs[i].direct;
+        }
+        memset(&edma_vec, 0, sizeof(edma_vec));
+        edma_vec.segs    = (uint64_t)edma_segs;
+        edma_vec.seg_cnt = seg_cnt;
+        if (ioctl(vpi_ctx->edma_fd, CB_TRANX_EDMA_VEC_TRANX, &edma_vec) == 0) {
+            return 0;
+        }
+        if (errno != ENOTTY) {
+            VPILOGE("vectored eDMA failed, errno %d, %d segments\n", errno,
+                    seg_cnt);
+            return -1;
+        }
+        VPILOGI("driver has no vectored eDMA, transfer by segment\n");
+        vpi_ctx->edma_no_vec = 1;
+    }
+
+    for (i = 0; i < seg_cnt && ret == 0; i++) {
+        ret = vpi_prc_edma_2d(vpi_ctx, segs[i].direct, segs[i].rc_addr,
+                              segs[i].ep_addr, segs[i].size, 1, segs[i].size,
+                              segs[i].size);
+    }
+
+    return ret;
+}
+
+/**
+ * vpi_prc_edma_reg_buf
+ * Register a buffer reused for eDMA, the driver keeps its pages pinned and
+ * mapped, so vpi_prc_edma_buf_xfer on it skips the page pinning.
+ * @Params: addr, size: the buffer
+ * @Return: handle of the buffer, 0 if it's not registered
+ */
+uint32_t vpi_prc_edma_reg_buf(VpiPrcCtx *vpi_ctx, void *addr, uint32_t size)
+{
+    struct trans_edma_buf edma_buf;
+
+    if (vpi_ctx->edma_fd <= 0 || addr == NULL) {
+        return 0;
+    }
+
+    edma_buf.rc_addr = (uint64_t)addr;
+    edma_buf.size    = size;
+    edma_buf.handle  = 0;
+    if (ioctl(vpi_ctx->edma_fd, CB_TRANX_EDMA_REG_BUF, &edma_buf)) {
+        VPILOGD("register eDMA buffer %p failed, errno %d\n", addr, errno);
+        return 0;
+    }
+
+    return edma_buf.handle;
+}
+
+void vpi_prc_edma_unreg_buf(VpiPrcCtx *vpi_ctx, uint32_t handle)
+{
+    if (vpi_ctx->edma_fd <= 0 || handle == 0) {
+        return;
+    }
+
+    if (ioctl(vpi_ctx->edma_fd, CB_TRANX_EDMA_UNREG_BUF, &handle)) {
+        VPILOGE("unregister eDMA buffer %d failed, errno %d\n", handle,
+                errno);
+    }
+}
+
+/**
+ * vpi_prc_edma_buf_xfer
+ * Transfer size bytes at offset of a registered buffer to or from ep_addr.
+ * @Params: direct: RC2EP or EP2RC
+ *          handle: from vpi_prc_edma_reg_buf
+ * @Return: 0 on success, others on failure
+ */
+int vpi_prc_edma_buf_xfer(VpiPrcCtx *vpi_ctx, uint32_t direct, uint32_t handle,
+                          uint32_t offset, uint64_t ep_addr, uint32_t size)
+{
+    struct trans_edma_buf_tranx edma_buf_tranx;
+
+    edma_buf_tranx.handle  = handle;
+    edma_buf_tranx.offset  = offset;
+    edma_buf_tranx.size    = size;
+    edma_buf_tranx.direct  = direct;
+    edma_buf_tranx.ep_addr = ep_addr;
+    if (ioctl(vpi_ctx->edma_fd, CB_TRANX_EDMA_BUF_TRANX, &edma_buf_tranx)) {
+        VPILOGE("eDMA on buffer %d failed, errno %d, offset %d size %d\n",
+                handle, errno, offset, size);
+        return -1;
+    }
+
+    return 0;
+}
@@ -40,6 +40,7 @@ extern "C" {
 #include "trans_edma_api.h"
 #include "vpi_video_pp.h"
 #include "vpi_video_hwulprc.h"
+#include "vpi_video_hwdwprc.h"
 
 typedef enum FilterType {
     FILTER_NULL,
@@ -49,16 +50,35 @@ typedef enum FilterType {
     FILTER_HW_UPLOAD
 } FilterType;
 
+/* max segments of one vpi_prc_edma_vec call */
+#define VPI_EDMA_SEG_MAX 64
+
+/* one segment of a vectored eDMA transfer */
+typedef struct {
+    uint64_t rc_addr;
+    uint64_t ep_addr;
+    uint32_t size;
+    uint32_t direct;
+} VpiEdmaSeg;
+
 typedef struct VpiPrcCtx {
     FilterType filter_type;
 
     /*hwdownload/hwupload*/
     EDMA_HANDLE edma_handle;
+    /* device fd for the 2D eDMA transfer, -1 if the driver has none */
+    int edma_fd;
+    /* set if the driver has no vectored eDMA */
+    int edma_no_vec;
     int pp_index;
 
     /*pp filter*/
     VpiPPFilter ppfilter;
 
+    /*hwdownload*/
+    VpiHwDwPool hwdw_pool;
+    VpiHwDwAsync hwdw_async;
+
     /*hwupload*/
     VpiPrcHwUlCtx hwul_ctx;
 } VpiPrcCtx;
@@ -68,11 +88,28 @@ VpiRet vpi_vprc_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
 VpiRet vpi_vprc_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
 int vpi_vprc_close(VpiPrcCtx *vpi_ctx);
 
+VpiRet vpi_prc_edma_open(VpiPrcCtx *vpi_ctx, const char *device);
+void vpi_prc_edma_close(VpiPrcCtx *vpi_ctx);
+int vpi_prc_edma_2d(VpiPrcCtx *vpi_ctx, uint32_t direct, uint64_t rc_addr,
+                    uint64_t ep_addr, uint32_t width, uint32_t height,
+                    uint32_t rc_stride, uint32_t ep_stride);
+uint32_t vpi_prc_edma_reg_buf(VpiPrcCtx *vpi_ctx, void *addr, uint32_t size);
+void vpi_prc_edma_unreg_buf(VpiPrcCtx *vpi_ctx, uint32_t handle);
+int vpi_prc_edma_buf_xfer(VpiPrcCtx *vpi_ctx, uint32_t direct, uint32_t handle,
+                          uint32_t offset, uint64_t ep_addr, uint32_t size);
+int vpi_prc_edma_vec(VpiPrcCtx *vpi_ctx, const VpiEdmaSeg *segs, int seg_cnt);
+void vpi_prc_edma_set_prio(VpiPrcCtx *vpi_ctx, int priority);
+
 VpiRet vpi_prc_pp_init(VpiPrcCtx *vpi_ctx, void *cfg);
 VpiRet vpi_prc_pp_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
 VpiRet vpi_prc_pp_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
 VpiRet vpi_prc_pp_close(VpiPrcCtx *ctx);
 
+VpiRet vpi_prc_hwdw_init(VpiPrcCtx *vpi_ctx, void *cfg);
+VpiRet vpi_prc_hwdw_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
+VpiRet vpi_prc_hwdw_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
+VpiRet vpi_prc_hwdw_close(VpiPrcCtx *vpi_ctx);
+
 VpiRet vpi_prc_hwul_init(VpiPrcCtx *vpi_ctx, void *cfg);
 VpiRet vpi_prc_hwul_process(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
 VpiRet vpi_prc_hwul_control(VpiPrcCtx *vpi_ctx, void *indata, void *outdata);
@@ -277,6 +277,35 @@ static VpiRet vpi_decode_put_packet(VpiCtx vpe_ctx, void *indata)
     return ret;
 }
 
+static int vpi_decode_put_packets(VpiCtx vpe_ctx, VpiPacket *packets, int num)
+{
+    VpeVpiCtx *vpe_vpi_ctx = (VpeVpiCtx *)vpe_ctx;
+    VpiDecCtx *dec_ctx     = (VpiDecCtx *)vpe_vpi_ctx->ctx;
+    int ret                = VPI_SUCCESS;
+
+    switch (vpe_vpi_ctx->plugin) {
+    case H264DEC_VPE:
+    case HEVCDEC_VPE:
+    case VP9DEC_VPE:
+        ret = vpi_vdec_put_packets(dec_ctx, packets, num);
+        break;
+    case H26XENC_VPE:
+    case VP9ENC_VPE:
+    case PP_VPE:
+    case SPLITER_VPE:
+    case HWDOWNLOAD_VPE:
+    case HWUPLOAD_VPE:
+        VPILOGE("decode_put_packets function is not in current pluging %d",
+                vpe_vpi_ctx->plugin);
+        ret = VPI_ERR_SW;
+        break;
+    default:
+        break;
+    }
+
+    return ret;
+}
+
 static int vpi_decode_get_frame(VpiCtx vpe_ctx, void *outdata)
 {
     VpeVpiCtx *vpe_vpi_ctx = (VpeVpiCtx *)vpe_ctx;
@@ -621,6 +650,7 @@ static VpiApi vpe_api = {
     vpi_control,
     vpi_process,
     vpi_close,
+    vpi_decode_put_packets,
 };
 
 static VpiRet log_init(LogLevel log_level)
@@ -702,7 +732,7 @@ void vpi_freep(void *arg)
 
 VpiRet vpi_get_sys_info_struct(VpiSysInfo **sys_info)
 {
-    *sys_info = malloc(sizeof(VpiSysInfo));
+    *sys_info = calloc(1, sizeof(VpiSysInfo));
     if (*sys_info == NULL) {
         VPILOGE("Can't allocate sys info struct for APP\n");
         return VPI_ERR_NO_AP_MEM;
@@ -745,6 +775,18 @@ VpiRet vpi_create(VpiCtx *ctx, VpiApi **vpi, int fd, VpiPlugin plugin)
                         return VPI_ERR_SW;
                     }
                     vpi_dev_info->task_id = vpi_hw_ctx[i]->task_id;
+                    if (vpi_dev_info->mem_slice) {
+                        /* DPB, PP and encoder buffers: not the cores' slice */
+                        struct mem_slice_info slice = { 0 };
+
+                        slice.task_id = vpi_hw_ctx[i]->task_id;
+                        slice.slice   = vpi_dev_info->mem_slice;
+                        if (ioctl(vpi_hw_ctx[i]->hw_context,
+                                  CB_TRANX_MEM_SET_SLICE, &slice) < 0) {
+                            VPILOGE("set memory slice %d failed!\n",
+                                    vpi_dev_info->mem_slice);
+                        }
+                    }
                     vpi_hw_ctx[i]->priority  = vpi_dev_info->priority;
                     for (j = 0; j < MAX_DEVICE_NUM; j++) {
                         if (vpi_dev_ctx[j] && vpi_dev_ctx[j]->fd == fd) {